@@ -0,0 +1,263 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Compressed animation clips, joint transforms are kept     *
+*      quantized in memory and decoded with SIMD while sampling. *
+*      rotations: smallest three, 48 bit (3 x uint16)            *
+*      translation and scale: 16 bit per component, quantized    *
+*      in the range of each joint's min max over the clip.       *
+*   Be Aware:                                                    *
+*      keys are uniformly sampled with frameRate, each frame is  *
+*      one contiguous block of uint16 streams (SoA over joints)  *
+*      so sampling touches only two blocks.                      *
+*      rotation error is below 0.0001 per component.             *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "Quantization.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Format                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// streams of one frame, each stream has numJoints uint16
+enum ClipStream : int
+{
+    ClipStream_RotationA, // 15 bit component, high bit is high bit of largest component index
+    ClipStream_RotationB, // 15 bit component, high bit is low bit of largest component index
+    ClipStream_RotationC, // 15 bit component
+    ClipStream_TranslationX, ClipStream_TranslationY, ClipStream_TranslationZ,
+    ClipStream_ScaleX, ClipStream_ScaleY, ClipStream_ScaleZ // only if clip has scale
+};
+
+// per joint dequantization ranges, each has numJoints floats, value = min + quantized * step
+enum ClipRange : int
+{
+    ClipRange_TranslationMin  = 0, // x, y, z
+    ClipRange_TranslationStep = 3,
+    ClipRange_ScaleMin        = 6,
+    ClipRange_ScaleStep       = 9,
+    ClipRange_Count           = 12
+};
+
+struct CompressedClip
+{
+    uint16* stream; // stream[(frame * numStreams + ClipStream) * numJoints + joint]
+    float*  ranges; // ranges[ClipRange * numJoints + joint]
+    int numJoints;
+    int numFrames;
+    int numStreams; // 6 without scale, 9 with scale
+    float frameRate;
+};
+
+purefn float ClipDuration(const CompressedClip& clip) {
+    return float(MAX(clip.numFrames - 1, 0)) / clip.frameRate;
+}
+
+purefn uint64 ClipMemorySize(const CompressedClip& clip) {
+    return uint64(clip.numFrames) * clip.numStreams * clip.numJoints * sizeof(uint16) +
+           uint64(ClipRange_Count) * clip.numJoints * sizeof(float);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Rotation                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// smallest three with 15 bits per component, index of the largest component is in high bits of a and b
+
+inline void ClipEncodeRotation(uint16 out[3], const float q[4])
+{
+    float invLength = 1.0f / Sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    Batch<float, 1> v[4];
+    for (int c = 0; c < 4; c++) v[c] = Batch<float, 1>::Set1(q[c] * invLength);
+
+    BatchMask<1> largest, codes[3];
+    QEncodeSmallestThree<15>(largest, codes, v);
+    out[0] = uint16(codes[0].v[0] | ((largest.v[0] >> 1) << 15));
+    out[1] = uint16(codes[1].v[0] | ((largest.v[0] & 1) << 15));
+    out[2] = uint16(codes[2].v[0]);
+}
+
+template<int N>
+inline void ClipDecodeRotation(Batch<float, N> q[4], BatchMask<N> a, BatchMask<N> b, BatchMask<N> c)
+{
+    const BatchMask<N> mask = BatchMask<N>::Set1(0x7FFF);
+    BatchMask<N> largest = (ShiftRightLogical(a, 15) << 1) | ShiftRightLogical(b, 15);
+    const BatchMask<N> codes[3] = { a & mask, b & mask, c };
+    QDecodeSmallestThree<15>(q, largest, codes);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                               Compression                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+purefn uint16 ClipQuantize(float x, float min, float step) {
+    return step > 0.0f ? uint16(Clamp((x - min) / step + 0.5f, 0.0f, 65535.0f)) : uint16(0);
+}
+
+// inputs are frame major: rotations[frame * numJoints + joint], scales can be null.
+// memory is allocated with new[], release it with DestroyClip
+inline CompressedClip CompressClip(const Quaternion* rotations, const Vector3f* translations, const Vector3f* scales,
+                                   int numJoints, int numFrames, float frameRate)
+{
+    CompressedClip clip;
+    clip.numJoints  = numJoints;
+    clip.numFrames  = numFrames;
+    clip.numStreams = scales ? 9 : 6;
+    clip.frameRate  = frameRate;
+    clip.stream = new uint16[uint64(numFrames) * clip.numStreams * numJoints];
+    clip.ranges = new float[ClipRange_Count * numJoints];
+
+    for (int j = 0; j < numJoints; j++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float tmin = translations[j][c], tmax = tmin;
+            float smin = scales ? scales[j][c] : 1.0f, smax = smin;
+            for (int f = 1; f < numFrames; f++)
+            {
+                tmin = MIN(tmin, translations[f * numJoints + j][c]);
+                tmax = MAX(tmax, translations[f * numJoints + j][c]);
+                if (!scales) continue;
+                smin = MIN(smin, scales[f * numJoints + j][c]);
+                smax = MAX(smax, scales[f * numJoints + j][c]);
+            }
+            clip.ranges[(ClipRange_TranslationMin + c)  * numJoints + j] = tmin;
+            clip.ranges[(ClipRange_TranslationStep + c) * numJoints + j] = (tmax - tmin) / 65535.0f;
+            clip.ranges[(ClipRange_ScaleMin + c)  * numJoints + j] = smin;
+            clip.ranges[(ClipRange_ScaleStep + c) * numJoints + j] = (smax - smin) / 65535.0f;
+        }
+    }
+
+    for (int f = 0; f < numFrames; f++)
+    {
+        uint16* frame = clip.stream + uint64(f) * clip.numStreams * numJoints;
+        for (int j = 0; j < numJoints; j++)
+        {
+            alignas(16) float q[4];
+            VecStore(q, rotations[f * numJoints + j]);
+            uint16 r[3];
+            ClipEncodeRotation(r, q);
+            for (int c = 0; c < 3; c++)
+                frame[(ClipStream_RotationA + c) * numJoints + j] = r[c];
+
+            for (int c = 0; c < 3; c++)
+            {
+                float min  = clip.ranges[(ClipRange_TranslationMin + c)  * numJoints + j];
+                float step = clip.ranges[(ClipRange_TranslationStep + c) * numJoints + j];
+                frame[(ClipStream_TranslationX + c) * numJoints + j] = ClipQuantize(translations[f * numJoints + j][c], min, step);
+                if (!scales) continue;
+                min  = clip.ranges[(ClipRange_ScaleMin + c)  * numJoints + j];
+                step = clip.ranges[(ClipRange_ScaleStep + c) * numJoints + j];
+                frame[(ClipStream_ScaleX + c) * numJoints + j] = ClipQuantize(scales[f * numJoints + j][c], min, step);
+            }
+        }
+    }
+    return clip;
+}
+
+inline void DestroyClip(CompressedClip& clip)
+{
+    delete[] clip.stream;
+    delete[] clip.ranges;
+    clip.stream = nullptr;
+    clip.ranges = nullptr;
+    clip.numFrames = 0;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Decoding                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// decodes joints [joint, joint + N) of the frame into SoA registers
+template<int N>
+inline void ClipDecodeFrame(const CompressedClip& clip, int frame, int joint,
+                            Batch<float, N> rotation[4], Batch<float, N> translation[3], Batch<float, N> scale[3])
+{
+    typedef Batch<float, N> F;
+    const int numJoints = clip.numJoints;
+    const uint16* data = clip.stream + uint64(frame) * clip.numStreams * numJoints + joint;
+    const float* ranges = clip.ranges + joint;
+
+    ClipDecodeRotation(rotation, LoadU16<N>(data + ClipStream_RotationA * numJoints),
+                                 LoadU16<N>(data + ClipStream_RotationB * numJoints),
+                                 LoadU16<N>(data + ClipStream_RotationC * numJoints));
+
+    for (int c = 0; c < 3; c++)
+    {
+        F q = ToFloat(LoadU16<N>(data + (ClipStream_TranslationX + c) * numJoints));
+        translation[c] = Fmadd(q, F::Load(ranges + (ClipRange_TranslationStep + c) * numJoints),
+                                  F::Load(ranges + (ClipRange_TranslationMin + c) * numJoints));
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        if (clip.numStreams < 9) { scale[c] = F::Set1(1.0f); continue; }
+        F q = ToFloat(LoadU16<N>(data + (ClipStream_ScaleX + c) * numJoints));
+        scale[c] = Fmadd(q, F::Load(ranges + (ClipRange_ScaleStep + c) * numJoints),
+                            F::Load(ranges + (ClipRange_ScaleMin + c) * numJoints));
+    }
+}
+
+// decodes two frames and blends them with t, rotations are normalized lerped over the shortest path
+template<int N>
+inline int SampleClipKernel(const CompressedClip& clip, int frame0, int frame1, float t,
+                            const QuaternionSoA& rotations, const Vector3SoA& translations, const Vector3SoA& scales,
+                            int i, int count)
+{
+    typedef Batch<float, N> F;
+    const F vt = F::Set1(t);
+    float* const rotOut[4] = { rotations.x, rotations.y, rotations.z, rotations.w };
+    float* const posOut[3] = { translations.x, translations.y, translations.z };
+    float* const sclOut[3] = { scales.x, scales.y, scales.z };
+
+    for (; i + N <= count; i += N)
+    {
+        F r0[4], t0[3], s0[3], r1[4], t1[3], s1[3];
+        ClipDecodeFrame(clip, frame0, i, r0, t0, s0);
+        ClipDecodeFrame(clip, frame1, i, r1, t1, s1);
+
+        F cosAngle = r0[0] * r1[0];
+        for (int c = 1; c < 4; c++) cosAngle = Fmadd(r0[c], r1[c], cosAngle);
+        BatchMask<N> sign = AsInt(cosAngle) & BatchMask<N>::Set1(int32(0x80000000u));
+
+        F lengthSq = F::Zero();
+        for (int c = 0; c < 4; c++)
+        {
+            F b = AsFloat(AsInt(r1[c]) ^ sign);
+            r0[c] = Fmadd(b - r0[c], vt, r0[c]);
+            lengthSq = Fmadd(r0[c], r0[c], lengthSq);
+        }
+
+        F invLength = F::Set1(1.0f) / Sqrt(lengthSq);
+        for (int c = 0; c < 4; c++)
+            (r0[c] * invLength).Store(rotOut[c] + i);
+
+        for (int c = 0; c < 3; c++)
+        {
+            Fmadd(t1[c] - t0[c], vt, t0[c]).Store(posOut[c] + i);
+            if (sclOut[c]) Fmadd(s1[c] - s0[c], vt, s0[c]).Store(sclOut[c] + i);
+        }
+    }
+    return i;
+}
+
+// writes all joint transforms at time to SoA outputs, time is clamped to clip duration.
+// scales can be null pointers if they are not needed
+inline void SampleClip(const CompressedClip& clip, float time,
+                       const QuaternionSoA& rotations, const Vector3SoA& translations, const Vector3SoA& scales)
+{
+    if (clip.numFrames <= 0) return;
+    float position = Clamp(time * clip.frameRate, 0.0f, float(clip.numFrames - 1));
+    int frame0 = int(position);
+    int frame1 = MIN(frame0 + 1, clip.numFrames - 1);
+    float t = position - float(frame0);
+
+    int i = SampleClipKernel<AX_BATCH_WIDTH>(clip, frame0, frame1, t, rotations, translations, scales, 0, clip.numJoints);
+    SampleClipKernel<1>(clip, frame0, frame1, t, rotations, translations, scales, i, clip.numJoints);
+}
+
+AX_END_NAMESPACE
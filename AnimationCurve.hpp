@@ -0,0 +1,276 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Samples keyframed tracks of floats, Vector3f's and        *
+*      quaternions with step, linear, Hermite or Catmull-Rom     *
+*      interpolation. keys of all tracks are in one SoA buffer   *
+*      so many tracks are interpolated in one SIMD call.         *
+*      every track has a cursor that remembers last key, so      *
+*      forward playback finds the key in O(1) without searching. *
+*   Be Aware:                                                    *
+*      key times of a track has to be increasing.                *
+*      consecutive quaternion keys has to be in the same         *
+*      hemisphere, use CurveFixQuaternionSigns after loading.    *
+*      time is clamped to first and last key of each track.      *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Quaternion.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Types                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+enum CurveInterpolation : int
+{
+    CurveInterpolation_Step,       // value of the previous key
+    CurveInterpolation_Linear,
+    CurveInterpolation_Hermite,    // uses inTangents and outTangents of the keys
+    CurveInterpolation_CatmullRom  // tangents are calculated from neighbour keys
+};
+
+// value is number of components
+enum CurveValueType : int
+{
+    CurveValueType_Float      = 1,
+    CurveValueType_Vector3    = 3,
+    CurveValueType_Quaternion = 4  // result is normalized
+};
+
+// keys of many tracks in one buffer, keys of track t are [keyOffsets[t], keyOffsets[t] + keyCounts[t])
+// every track has to have at least one key (keyCounts[t] >= 1), a track with one key is constant.
+// values and tangents has one stream per component (x, y, z, w), tangents are per second
+// and only needed for Hermite interpolation, they can be null otherwise.
+struct CurveSet
+{
+    const float* times;
+    const float* values[4];
+    const float* inTangents[4];
+    const float* outTangents[4];
+    const int* keyOffsets;
+    const int* keyCounts;
+    int numTracks;
+    CurveValueType valueType;
+};
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Key Search                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// largest k in [lo, hi] where times[k] <= time, or lo if there is none
+purefn int CurveBinarySearch(const float* times, int lo, int hi, float time)
+{
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) >> 1;
+        if (times[mid] <= time) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// returns k where times[k] <= time < times[k + 1], clamped to [0, numKeys - 2].
+// search starts from cursor (last result of the track), playing forward or backward
+// moves a few keys at most so it is O(1), bigger jumps falls back to binary search
+purefn int CurveFindKey(const float* times, int numKeys, float time, int cursor)
+{
+    const int last = numKeys - 2;
+    if (last <= 0) return 0;
+
+    int k = Clamp(cursor, 0, last);
+    if (time >= times[k])
+    {
+        for (int step = 0; step < 2 && k < last && time >= times[k + 1]; step++) k++;
+        if (k == last || time < times[k + 1]) return k;
+        return CurveBinarySearch(times, k + 1, last, time);
+    }
+
+    if (k == 0 || time >= times[k - 1]) return MAX(k - 1, 0);
+    return CurveBinarySearch(times, 0, k - 1, time);
+}
+
+// flips quaternion keys that are in the other hemisphere of the previous key, result is same rotation
+inline void CurveFixQuaternionSigns(const QuaternionSoA& keys, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        float d = keys.x[i] * keys.x[i - 1] + keys.y[i] * keys.y[i - 1] + keys.z[i] * keys.z[i - 1] + keys.w[i] * keys.w[i - 1];
+        if (d >= 0.0f) continue;
+        keys.x[i] = -keys.x[i]; keys.y[i] = -keys.y[i];
+        keys.z[i] = -keys.z[i]; keys.w[i] = -keys.w[i];
+    }
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                               Evaluation                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// keys and weights of one track at given time, key indices are in CurveSet buffer
+struct CurveSegment
+{
+    int32 prev, k0, k1, next;
+    float t;        // [0, 1] between k0 and k1
+    float duration; // time between k0 and k1
+    float scale0;   // duration / (time[k1] - time[prev]), Catmull-Rom tangent scale
+    float scale1;   // duration / (time[next] - time[k0])
+};
+
+inline CurveSegment CurveFindSegment(const CurveSet& set, int track, float time, int* cursor)
+{
+    const int offset = set.keyOffsets[track], numKeys = set.keyCounts[track];
+    ASSERT(numKeys >= 1); // empty track would read keys of the next track or outside of the buffer
+    const float* times = set.times + offset;
+    const int last = numKeys - 1;
+
+    int k = CurveFindKey(times, numKeys, time, *cursor);
+    *cursor = k;
+
+    CurveSegment s;
+    int k1 = MIN(k + 1, last), prev = MAX(k - 1, 0), next = MIN(k + 2, last);
+    s.prev = offset + prev; s.k0 = offset + k;
+    s.k1   = offset + k1;   s.next = offset + next;
+
+    float duration = times[k1] - times[k];
+    s.duration = duration;
+    s.t = duration > 0.0f ? Clamp01((time - times[k]) / duration) : 0.0f;
+    s.scale0 = times[k1]   > times[prev] ? duration / (times[k1] - times[prev]) : 0.0f;
+    s.scale1 = times[next] > times[k]    ? duration / (times[next] - times[k])  : 0.0f;
+    return s;
+}
+
+// p0 + (3t^2 - 2t^3)(p1 - p0) + (t^3 - 2t^2 + t) m0 + (t^3 - t^2) m1, tangents are scaled to segment length
+template<int N>
+purefn Batch<float, N> CurveHermite(Batch<float, N> p0, Batch<float, N> p1, Batch<float, N> m0, Batch<float, N> m1, Batch<float, N> t)
+{
+    typedef Batch<float, N> F;
+    F t2 = t * t;
+    F t3 = t2 * t;
+    F h01 = Fmsub(F::Set1(3.0f), t2, t3 + t3);
+    F h11 = t3 - t2;
+    F h10 = h11 - t2 + t;
+    return Fmadd(h01, p1 - p0, Fmadd(h10, m0, Fmadd(h11, m1, p0)));
+}
+
+// evaluates tracks [i, count) at time, writes result of track i to out[component][i]
+template<int N>
+inline int SampleCurveSetKernel(float* const out[4], const CurveSet& set, float time, int* cursors,
+                                CurveInterpolation interpolation, int i, int count)
+{
+    typedef Batch<float, N> F;
+    typedef BatchMask<N> I;
+    const int numComponents = int(set.valueType);
+
+    for (; i + N <= count; i += N)
+    {
+        int32 prev[N], k0[N], k1[N], next[N];
+        float t[N], duration[N], scale0[N], scale1[N];
+        for (int l = 0; l < N; l++)
+        {
+            CurveSegment s = CurveFindSegment(set, i + l, time, cursors + i + l);
+            prev[l] = s.prev; k0[l] = s.k0; k1[l] = s.k1; next[l] = s.next;
+            t[l] = s.t; duration[l] = s.duration; scale0[l] = s.scale0; scale1[l] = s.scale1;
+        }
+
+        I i0 = I::Load(k0), i1 = I::Load(k1);
+        F u = F::Load(t);
+        if (interpolation == CurveInterpolation_Step) // jumps to the last key only at the end of the track
+            u = Select(F::Zero(), F::Set1(1.0f), u >= F::Set1(1.0f));
+        F result[4];
+
+        for (int c = 0; c < numComponents; c++)
+        {
+            F p0 = Gather(set.values[c], i0);
+            F p1 = Gather(set.values[c], i1);
+            switch (interpolation)
+            {
+                case CurveInterpolation_Hermite:
+                {
+                    F dt = F::Load(duration);
+                    F m0 = Gather(set.outTangents[c], i0) * dt;
+                    F m1 = Gather(set.inTangents[c], i1) * dt;
+                    result[c] = CurveHermite(p0, p1, m0, m1, u);
+                    break;
+                }
+                case CurveInterpolation_CatmullRom:
+                {
+                    F m0 = (p1 - Gather(set.values[c], I::Load(prev))) * F::Load(scale0);
+                    F m1 = (Gather(set.values[c], I::Load(next)) - p0) * F::Load(scale1);
+                    result[c] = CurveHermite(p0, p1, m0, m1, u);
+                    break;
+                }
+                default: // linear and step
+                    result[c] = Fmadd(p1 - p0, u, p0);
+                    break;
+            }
+        }
+
+        if (set.valueType == CurveValueType_Quaternion)
+        {
+            F lengthSq = result[0] * result[0];
+            for (int c = 1; c < 4; c++) lengthSq = Fmadd(result[c], result[c], lengthSq);
+            F invLength = F::Set1(1.0f) / Sqrt(lengthSq);
+            for (int c = 0; c < 4; c++) result[c] = result[c] * invLength;
+        }
+
+        for (int c = 0; c < numComponents; c++)
+            result[c].Store(out[c] + i);
+    }
+    return i;
+}
+
+// samples all tracks of the set at the same time, cursors has one int per track, initialize them to zero
+// out has one stream per component, each stream has numTracks elements
+inline void SampleCurveSet(float* const out[4], const CurveSet& set, float time, int* cursors, CurveInterpolation interpolation)
+{
+    int i = SampleCurveSetKernel<AX_BATCH_WIDTH>(out, set, time, cursors, interpolation, 0, set.numTracks);
+    SampleCurveSetKernel<1>(out, set, time, cursors, interpolation, i, set.numTracks);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Single Track                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// view of the set that only has the given track
+purefn CurveSet CurveSetTrack(const CurveSet& set, int track)
+{
+    CurveSet single = set;
+    single.keyOffsets = set.keyOffsets + track;
+    single.keyCounts  = set.keyCounts + track;
+    single.numTracks  = 1;
+    return single;
+}
+
+// result of the track, unused components are left uninitialized
+inline void SampleCurveTrack(float result[4], const CurveSet& set, int track, float time, int* cursor, CurveInterpolation interpolation)
+{
+    float* const out[4] = { result, result + 1, result + 2, result + 3 };
+    SampleCurveSetKernel<1>(out, CurveSetTrack(set, track), time, cursor, interpolation, 0, 1);
+}
+
+inline float SampleCurveFloat(const CurveSet& set, int track, float time, int* cursor, CurveInterpolation interpolation)
+{
+    float r[4];
+    SampleCurveTrack(r, set, track, time, cursor, interpolation);
+    return r[0];
+}
+
+inline Vector3f SampleCurveVector3(const CurveSet& set, int track, float time, int* cursor, CurveInterpolation interpolation)
+{
+    float r[4];
+    SampleCurveTrack(r, set, track, time, cursor, interpolation);
+    return { r[0], r[1], r[2] };
+}
+
+inline Quaternion SampleCurveQuaternion(const CurveSet& set, int track, float time, int* cursor, CurveInterpolation interpolation)
+{
+    float r[4];
+    SampleCurveTrack(r, set, track, time, cursor, interpolation);
+    return MakeQuat(r[0], r[1], r[2], r[3]);
+}
+
+AX_END_NAMESPACE
@@ -0,0 +1,680 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Array kernels written once with Batch<T, N>,              *
+*      each kernel is instantiated with AX_BATCH_WIDTH for the   *
+*      body and with width 1 for the remaining tail elements.    *
+*   Be Aware:                                                    *
+*      input and output streams can be unaligned.                *
+*      functions with "i, count" arguments returns the index     *
+*      they stopped, so you can run the tail with other width.   *
+*      if cpu supports AVX-512 Array functions dispatches to     *
+*      16 wide versions that handles the tail with mask regs.    *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Matrix.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 AVX-512                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// selected at runtime by the Array functions below, last iteration is masked
+// so there is no scalar loop for the remaining elements
+
+#ifdef AX_TARGET_AVX512
+
+AX_TARGET_AVX512 inline void SinArray512(float* dst, const float* src, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        Vec16StoreMasked(dst + i, m, Vec16Sin(Vec16LoadMasked(src + i, m)));
+    }
+}
+
+AX_TARGET_AVX512 inline void CosArray512(float* dst, const float* src, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        Vec16StoreMasked(dst + i, m, Vec16Cos(Vec16LoadMasked(src + i, m)));
+    }
+}
+
+AX_TARGET_AVX512 inline void SinCosArray512(float* sinOut, float* cosOut, const float* src, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t c, s = Vec16SinCos(&c, Vec16LoadMasked(src + i, m));
+        Vec16StoreMasked(sinOut + i, m, s);
+        Vec16StoreMasked(cosOut + i, m, c);
+    }
+}
+
+AX_TARGET_AVX512 inline void Atan2Array512(float* dst, const float* y, const float* x, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t vy = Vec16LoadMasked(y + i, m);
+        vec16_t vx = _mm512_mask_loadu_ps(Vec16One(), m, x + i); // avoid 0 / 0 on inactive lanes
+        Vec16StoreMasked(dst + i, m, Vec16Atan2(vy, vx));
+    }
+}
+
+AX_TARGET_AVX512 inline void TransformPointsArray512(Vector3SoA out, const Vector3SoA& in, const Matrix4& matrix, int count)
+{
+    const float (*mt)[4] = matrix.m;
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t x = Vec16LoadMasked(in.x + i, m);
+        vec16_t y = Vec16LoadMasked(in.y + i, m);
+        vec16_t z = Vec16LoadMasked(in.z + i, m);
+        for (int c = 0; c < 3; c++)
+        {
+            vec16_t r = Vec16Fmadd(z, Vec16Set1(mt[2][c]), Vec16Set1(mt[3][c]));
+            r = Vec16Fmadd(y, Vec16Set1(mt[1][c]), r);
+            r = Vec16Fmadd(x, Vec16Set1(mt[0][c]), r);
+            float* dst = c == 0 ? out.x : c == 1 ? out.y : out.z;
+            Vec16StoreMasked(dst + i, m, r);
+        }
+    }
+}
+
+// visibleBits has to be zeroed before
+AX_TARGET_AVX512 inline void CullAABBArray512(uint32* visibleBits, const Vector3SoA& mins, const Vector3SoA& maxs,
+                                              const FrustumPlanes& frustum, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t minx = Vec16LoadMasked(mins.x + i, m), miny = Vec16LoadMasked(mins.y + i, m), minz = Vec16LoadMasked(mins.z + i, m);
+        vec16_t maxx = Vec16LoadMasked(maxs.x + i, m), maxy = Vec16LoadMasked(maxs.y + i, m), maxz = Vec16LoadMasked(maxs.z + i, m);
+        vecmask16_t visible = m;
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            vec16_t px = plane[0] >= 0.0f ? maxx : minx;
+            vec16_t py = plane[1] >= 0.0f ? maxy : miny;
+            vec16_t pz = plane[2] >= 0.0f ? maxz : minz;
+            vec16_t d = Vec16Fmadd(pz, Vec16Set1(plane[2]), Vec16Set1(plane[3]));
+            d = Vec16Fmadd(py, Vec16Set1(plane[1]), d);
+            d = Vec16Fmadd(px, Vec16Set1(plane[0]), d);
+            visible &= Vec16CmpGe(d, Vec16Zero());
+        }
+        visibleBits[i >> 5] |= uint32(Vec16Movemask(visible)) << (i & 31);
+    }
+}
+
+// planes has to be normalized, visibleBits has to be zeroed before
+AX_TARGET_AVX512 inline void CullSpheresArray512(uint32* visibleBits, const Vector3SoA& centers, const float* radii,
+                                                 const FrustumPlanes& frustum, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t x = Vec16LoadMasked(centers.x + i, m), y = Vec16LoadMasked(centers.y + i, m), z = Vec16LoadMasked(centers.z + i, m);
+        vec16_t negRadius = Vec16Neg(Vec16LoadMasked(radii + i, m));
+        vecmask16_t visible = m;
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            vec16_t d = Vec16Fmadd(z, Vec16Set1(plane[2]), Vec16Set1(plane[3]));
+            d = Vec16Fmadd(y, Vec16Set1(plane[1]), d);
+            d = Vec16Fmadd(x, Vec16Set1(plane[0]), d);
+            visible &= Vec16CmpGe(d, negRadius);
+        }
+        visibleBits[i >> 5] |= uint32(Vec16Movemask(visible)) << (i & 31);
+    }
+}
+
+// planes has to be normalized, visibleBits has to be zeroed before
+AX_TARGET_AVX512 inline void CullConesArray512(uint32* visibleBits, const Vector3SoA& apexes, const Vector3SoA& directions,
+                                               const float* heights, const float* radii, const FrustumPlanes& frustum, int count)
+{
+    for (int i = 0; i < count; i += 16)
+    {
+        vecmask16_t m = Vec16TailMask(count - i);
+        vec16_t ax = Vec16LoadMasked(apexes.x + i, m), ay = Vec16LoadMasked(apexes.y + i, m), az = Vec16LoadMasked(apexes.z + i, m);
+        vec16_t dx = Vec16LoadMasked(directions.x + i, m), dy = Vec16LoadMasked(directions.y + i, m), dz = Vec16LoadMasked(directions.z + i, m);
+        vec16_t height = Vec16LoadMasked(heights + i, m), radius = Vec16LoadMasked(radii + i, m);
+        vecmask16_t visible = m;
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            vec16_t apexDist = Vec16Fmadd(az, Vec16Set1(plane[2]), Vec16Set1(plane[3]));
+            apexDist = Vec16Fmadd(ay, Vec16Set1(plane[1]), apexDist);
+            apexDist = Vec16Fmadd(ax, Vec16Set1(plane[0]), apexDist);
+            vec16_t nd = Vec16Mul(dz, Vec16Set1(plane[2]));
+            nd = Vec16Fmadd(dy, Vec16Set1(plane[1]), nd);
+            nd = Vec16Fmadd(dx, Vec16Set1(plane[0]), nd);
+            vec16_t sinAngle = Vec16Sqrt(Vec16Max(Vec16Fmadd(Vec16Neg(nd), nd, Vec16Set1(1.0f)), Vec16Zero()));
+            vec16_t baseDist = Vec16Fmadd(radius, sinAngle, Vec16Fmadd(nd, height, apexDist));
+            visible &= Vec16CmpGe(Vec16Max(apexDist, baseDist), Vec16Zero());
+        }
+        visibleBits[i >> 5] |= uint32(Vec16Movemask(visible)) << (i & 31);
+    }
+}
+
+AX_TARGET_AVX512 inline void HalfToFloatArray512(float* dst, const half* src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+        Vec16StoreU(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(src + i))));
+
+    if (i < count) // masked 16 bit loads requires AVX512BW, copy the tail instead
+    {
+        alignas(32) half tail[16] = {};
+        SmallMemCpy(tail, src + i, (count - i) * sizeof(half));
+        Vec16StoreMasked(dst + i, Vec16TailMask(count - i), _mm512_cvtph_ps(_mm256_load_si256((const __m256i*)tail)));
+    }
+}
+
+AX_TARGET_AVX512 inline void FloatToHalfArray512(half* dst, const float* src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtps_ph(Vec16Load(src + i), _MM_FROUND_TO_NEAREST_INT));
+
+    if (i < count)
+    {
+        alignas(32) half tail[16];
+        __m256i h = _mm512_cvtps_ph(Vec16LoadMasked(src + i, Vec16TailMask(count - i)), _MM_FROUND_TO_NEAREST_INT);
+        _mm256_store_si256((__m256i*)tail, h);
+        SmallMemCpy(dst + i, tail, (count - i) * sizeof(half));
+    }
+}
+
+#endif // AX_TARGET_AVX512
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                           Transcendental                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+inline int SinKernel(float* dst, const float* src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Sin(Batch<float, N>::Load(src + i)).Store(dst + i);
+    return i;
+}
+
+template<int N>
+inline int CosKernel(float* dst, const float* src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Cos(Batch<float, N>::Load(src + i)).Store(dst + i);
+    return i;
+}
+
+template<int N>
+inline int SinCosKernel(float* sinOut, float* cosOut, const float* src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+    {
+        Batch<float, N> c;
+        SinCos(&c, Batch<float, N>::Load(src + i)).Store(sinOut + i);
+        c.Store(cosOut + i);
+    }
+    return i;
+}
+
+template<int N>
+inline int Atan2Kernel(float* dst, const float* y, const float* x, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Atan2(Batch<float, N>::Load(y + i), Batch<float, N>::Load(x + i)).Store(dst + i);
+    return i;
+}
+
+inline void SinArray(float* dst, const float* src, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { SinArray512(dst, src, count); return; }
+#endif
+    int i = SinKernel<AX_BATCH_WIDTH>(dst, src, 0, count);
+    SinKernel<1>(dst, src, i, count);
+}
+
+inline void CosArray(float* dst, const float* src, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { CosArray512(dst, src, count); return; }
+#endif
+    int i = CosKernel<AX_BATCH_WIDTH>(dst, src, 0, count);
+    CosKernel<1>(dst, src, i, count);
+}
+
+inline void SinCosArray(float* sinOut, float* cosOut, const float* src, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { SinCosArray512(sinOut, cosOut, src, count); return; }
+#endif
+    int i = SinCosKernel<AX_BATCH_WIDTH>(sinOut, cosOut, src, 0, count);
+    SinCosKernel<1>(sinOut, cosOut, src, i, count);
+}
+
+inline void Atan2Array(float* dst, const float* y, const float* x, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { Atan2Array512(dst, y, x, count); return; }
+#endif
+    int i = Atan2Kernel<AX_BATCH_WIDTH>(dst, y, x, 0, count);
+    Atan2Kernel<1>(dst, y, x, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Transform                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// out = in * matrix, same as Vector3Transform. out can be same as in
+template<int N>
+inline int TransformPointsKernel(Vector3SoA out, const Vector3SoA& in, const Matrix4& matrix, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const float (*m)[4] = matrix.m;
+    for (; i + N <= count; i += N)
+    {
+        B x = B::Load(in.x + i), y = B::Load(in.y + i), z = B::Load(in.z + i);
+        B rx = Fmadd(x, B::Set1(m[0][0]), Fmadd(y, B::Set1(m[1][0]), Fmadd(z, B::Set1(m[2][0]), B::Set1(m[3][0]))));
+        B ry = Fmadd(x, B::Set1(m[0][1]), Fmadd(y, B::Set1(m[1][1]), Fmadd(z, B::Set1(m[2][1]), B::Set1(m[3][1]))));
+        B rz = Fmadd(x, B::Set1(m[0][2]), Fmadd(y, B::Set1(m[1][2]), Fmadd(z, B::Set1(m[2][2]), B::Set1(m[3][2]))));
+        rx.Store(out.x + i); ry.Store(out.y + i); rz.Store(out.z + i);
+    }
+    return i;
+}
+
+inline void TransformPointsArray(Vector3SoA out, const Vector3SoA& in, const Matrix4& matrix, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { TransformPointsArray512(out, in, matrix, count); return; }
+#endif
+    int i = TransformPointsKernel<AX_BATCH_WIDTH>(out, in, matrix, 0, count);
+    TransformPointsKernel<1>(out, in, matrix, i, count);
+}
+
+// linear blend skinning, each point has 4 joint indices and 4 weights (weights should sum to 1)
+// point = sum(weights[k] * (point * jointMatrices[joints[k]]))
+template<int N>
+inline int SkinPointsKernel(Vector3SoA out, const Vector3SoA& in, const int32* const joints[4],
+                            const float* const weights[4], const Matrix4* jointMatrices, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const float* base = &jointMatrices[0].m[0][0];
+    for (; i + N <= count; i += N)
+    {
+        B x = B::Load(in.x + i), y = B::Load(in.y + i), z = B::Load(in.z + i);
+        B r[3] = { B::Zero(), B::Zero(), B::Zero() };
+        for (int k = 0; k < 4; k++)
+        {
+            B w = B::Load(weights[k] + i);
+            BatchMask<N> idx = BatchMask<N>::Load(joints[k] + i);
+            for (int c = 0; c < 3; c++)
+            {
+                B t = Gather<16>(base + 12 + c, idx); // m[3][c]
+                t = Fmadd(z, Gather<16>(base + 8 + c, idx), t);
+                t = Fmadd(y, Gather<16>(base + 4 + c, idx), t);
+                t = Fmadd(x, Gather<16>(base + 0 + c, idx), t);
+                r[c] = Fmadd(w, t, r[c]);
+            }
+        }
+        r[0].Store(out.x + i); r[1].Store(out.y + i); r[2].Store(out.z + i);
+    }
+    return i;
+}
+
+inline void SkinPointsArray(Vector3SoA out, const Vector3SoA& in, const int32* const joints[4],
+                            const float* const weights[4], const Matrix4* jointMatrices, int count)
+{
+    int i = SkinPointsKernel<AX_BATCH_WIDTH>(out, in, joints, weights, jointMatrices, 0, count);
+    SkinPointsKernel<1>(out, in, joints, weights, jointMatrices, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Euler                                    */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// order of the rotations, XYZ rotates around x first, then y, then z (q = qz * qy * qx).
+// EulerOrder_XYZ gives same results with QFromEuler and QToEulerAngles
+enum EulerOrder : int
+{
+    EulerOrder_XYZ, EulerOrder_XZY,
+    EulerOrder_YXZ, EulerOrder_YZX,
+    EulerOrder_ZXY, EulerOrder_ZYX
+};
+
+// first, second and third axis of the order, and 1 if axes are an odd permutation of xyz
+constexpr int EulerOrderAxes[6][4] = {
+    { 0, 1, 2, 0 }, { 0, 2, 1, 1 },
+    { 1, 0, 2, 1 }, { 1, 2, 0, 0 },
+    { 2, 0, 1, 0 }, { 2, 1, 0, 1 }
+};
+
+// euler angles are in radians, sin and cos of each angle comes from one range reduction
+template<int N>
+inline int QFromEulerKernel(const QuaternionSoA& out, const Vector3SoA& euler, EulerOrder order, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const int* axes = EulerOrderAxes[order];
+    const float* angles[3] = { euler.x, euler.y, euler.z };
+    float* dst[4] = { out.x, out.y, out.z, out.w };
+    // odd orders has the opposite sign on second terms
+    const BatchMask<N> flip = BatchMask<N>::Set1(axes[3] ? int32(0x80000000u) : 0);
+    const B half = B::Set1(0.5f);
+
+    for (; i + N <= count; i += N)
+    {
+        B ca, cb, cc;
+        B sa = SinCos(&ca, B::Load(angles[axes[0]] + i) * half);
+        B sb = SinCos(&cb, B::Load(angles[axes[1]] + i) * half);
+        B sc = SinCos(&cc, B::Load(angles[axes[2]] + i) * half);
+        B cbcc = cb * cc, sbsc = sb * sc, cbsc = cb * sc, sbcc = sb * cc;
+
+        Fmsub(sa, cbcc, AsFloat(AsInt(ca * sbsc) ^ flip)).Store(dst[axes[0]] + i);
+        Fmadd(ca, sbcc, AsFloat(AsInt(sa * cbsc) ^ flip)).Store(dst[axes[1]] + i);
+        Fmsub(ca, cbsc, AsFloat(AsInt(sa * sbcc) ^ flip)).Store(dst[axes[2]] + i);
+        Fmadd(ca, cbcc, AsFloat(AsInt(sa * sbsc) ^ flip)).Store(dst[3] + i);
+    }
+    return i;
+}
+
+// inverse of QFromEulerKernel, quaternions has to be normalized. middle angle is in [-PI/2, PI/2]
+template<int N>
+inline int QToEulerKernel(const Vector3SoA& euler, const QuaternionSoA& in, EulerOrder order, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const int* axes = EulerOrderAxes[order];
+    const float* src[4] = { in.x, in.y, in.z, in.w };
+    float* angles[3] = { euler.x, euler.y, euler.z };
+    const BatchMask<N> flip = BatchMask<N>::Set1(axes[3] ? int32(0x80000000u) : 0);
+    const B one = B::Set1(1.0f), two = B::Set1(2.0f);
+
+    for (; i + N <= count; i += N)
+    {
+        B qa = B::Load(src[axes[0]] + i), qb = B::Load(src[axes[1]] + i);
+        B qc = B::Load(src[axes[2]] + i), w  = B::Load(src[3] + i);
+        B ww = w * w, aa = qa * qa, bb = qb * qb, cc = qc * qc;
+
+        B y0 = two * Fmadd(w, qa, AsFloat(AsInt(qb * qc) ^ flip));
+        B x0 = (ww - aa) - (bb - cc);
+        B y2 = two * Fmadd(w, qc, AsFloat(AsInt(qa * qb) ^ flip));
+        B x2 = (ww + aa) - (bb + cc);
+        // asin(s) = atan2(s, sqrt(1 - s^2)), clamped because of rounding errors near gimbal lock
+        B s  = Min(Max(two * Fmsub(w, qb, AsFloat(AsInt(qa * qc) ^ flip)), -one), one);
+
+        Atan2(y0, x0).Store(angles[axes[0]] + i);
+        Atan2(s, Sqrt(Max(Fmsub(-s, s, -one), B::Zero()))).Store(angles[axes[1]] + i);
+        Atan2(y2, x2).Store(angles[axes[2]] + i);
+    }
+    return i;
+}
+
+inline void QFromEulerArray(const QuaternionSoA& out, const Vector3SoA& euler, int count, EulerOrder order = EulerOrder_XYZ)
+{
+    int i = QFromEulerKernel<AX_BATCH_WIDTH>(out, euler, order, 0, count);
+    QFromEulerKernel<1>(out, euler, order, i, count);
+}
+
+inline void QToEulerArray(const Vector3SoA& euler, const QuaternionSoA& in, int count, EulerOrder order = EulerOrder_XYZ)
+{
+    int i = QToEulerKernel<AX_BATCH_WIDTH>(euler, in, order, 0, count);
+    QToEulerKernel<1>(euler, in, order, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                               Integration                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// out = delta * in, delta is the rotation of world space angular velocity omega (radians per second) during dt.
+// exponential map uses sin and cos of the half angle, first order uses (omega * dt / 2, 1) and normalizes.
+// out can be same as in
+template<int N>
+inline int QIntegrateKernel(const QuaternionSoA& out, const QuaternionSoA& in, const Vector3SoA& omega, float dt,
+                            QIntegration mode, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const B halfDt = B::Set1(0.5f * dt), one = B::Set1(1.0f);
+
+    for (; i + N <= count; i += N)
+    {
+        B qx = B::Load(in.x + i), qy = B::Load(in.y + i), qz = B::Load(in.z + i), qw = B::Load(in.w + i);
+        B wx = B::Load(omega.x + i), wy = B::Load(omega.y + i), wz = B::Load(omega.z + i);
+        B scale = halfDt, dw = one;
+        if (mode == QIntegration_Exponential)
+        {
+            B length = Sqrt(Fmadd(wx, wx, Fmadd(wy, wy, wz * wz)));
+            B halfAngle = length * halfDt;
+            B s = SinCos(&dw, halfAngle);
+            // sin(halfAngle) / length, taylor series when the angle is too small to divide
+            B taylor = halfDt * Fmadd(halfAngle * halfAngle, B::Set1(-1.0f / 6.0f), one);
+            scale = Select(s / Max(length, B::Set1(FLT_MIN)), taylor, halfAngle < B::Set1(1e-3f));
+        }
+        B dx = wx * scale, dy = wy * scale, dz = wz * scale;
+
+        B rx = Fmadd(dw, qx, Fmadd(qw, dx, Fmsub(dy, qz, dz * qy)));
+        B ry = Fmadd(dw, qy, Fmadd(qw, dy, Fmsub(dz, qx, dx * qz)));
+        B rz = Fmadd(dw, qz, Fmadd(qw, dz, Fmsub(dx, qy, dy * qx)));
+        B rw = Fmsub(dw, qw, Fmadd(dx, qx, Fmadd(dy, qy, dz * qz)));
+
+        if (mode == QIntegration_FirstOrder)
+        {
+            B invLength = one / Sqrt(Fmadd(rx, rx, Fmadd(ry, ry, Fmadd(rz, rz, rw * rw))));
+            rx = rx * invLength; ry = ry * invLength; rz = rz * invLength; rw = rw * invLength;
+        }
+        rx.Store(out.x + i); ry.Store(out.y + i); rz.Store(out.z + i); rw.Store(out.w + i);
+    }
+    return i;
+}
+
+// omega = 2 * log(q1 * conjugate(q0)) / dt over the shortest path, quaternions has to be normalized
+template<int N>
+inline int QAngularVelocityKernel(const Vector3SoA& omega, const QuaternionSoA& q0, const QuaternionSoA& q1, float dt,
+                                  int i, int count)
+{
+    typedef Batch<float, N> B;
+    const B twoDivDt = B::Set1(2.0f / dt);
+    const BatchMask<N> signBit = BatchMask<N>::Set1(int32(0x80000000u));
+
+    for (; i + N <= count; i += N)
+    {
+        B ax = B::Load(q0.x + i), ay = B::Load(q0.y + i), az = B::Load(q0.z + i), aw = B::Load(q0.w + i);
+        B bx = B::Load(q1.x + i), by = B::Load(q1.y + i), bz = B::Load(q1.z + i), bw = B::Load(q1.w + i);
+
+        B dx = Fmsub(aw, bx, Fmadd(bw, ax, Fmsub(by, az, bz * ay)));
+        B dy = Fmsub(aw, by, Fmadd(bw, ay, Fmsub(bz, ax, bx * az)));
+        B dz = Fmsub(aw, bz, Fmadd(bw, az, Fmsub(bx, ay, by * ax)));
+        B dw = Fmadd(aw, bw, Fmadd(ax, bx, Fmadd(ay, by, az * bz)));
+
+        // shortest path, negate delta if w is negative
+        BatchMask<N> sign = AsInt(dw) & signBit;
+        dw = Abs(dw);
+        B length = Sqrt(Fmadd(dx, dx, Fmadd(dy, dy, dz * dz)));
+        B halfAngle = Atan2(length, dw);
+        B scale = Select(halfAngle / Max(length, B::Set1(FLT_MIN)), B::Set1(1.0f) / dw, length < B::Set1(1e-4f));
+        scale = AsFloat(AsInt(scale * twoDivDt) ^ sign);
+
+        (dx * scale).Store(omega.x + i);
+        (dy * scale).Store(omega.y + i);
+        (dz * scale).Store(omega.z + i);
+    }
+    return i;
+}
+
+inline void QIntegrateArray(const QuaternionSoA& out, const QuaternionSoA& in, const Vector3SoA& omega, float dt, int count,
+                            QIntegration mode = QIntegration_Exponential)
+{
+    int i = QIntegrateKernel<AX_BATCH_WIDTH>(out, in, omega, dt, mode, 0, count);
+    QIntegrateKernel<1>(out, in, omega, dt, mode, i, count);
+}
+
+inline void QAngularVelocityArray(const Vector3SoA& omega, const QuaternionSoA& q0, const QuaternionSoA& q1, float dt, int count)
+{
+    int i = QAngularVelocityKernel<AX_BATCH_WIDTH>(omega, q0, q1, dt, 0, count);
+    QAngularVelocityKernel<1>(omega, q0, q1, dt, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Culling                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// same test with CheckAABBCulled (without far plane), but for world space boxes.
+// visibleBits[i / 32] bit (i % 32) is set if box i is inside or intersecting the frustum
+template<int N>
+inline int CullAABBKernel(uint32* visibleBits, const Vector3SoA& mins, const Vector3SoA& maxs,
+                          const FrustumPlanes& frustum, int i, int count)
+{
+    typedef Batch<float, N> B;
+    static_assert(32 % N == 0, "bitmask words must contain whole batches");
+    for (; i + N <= count; i += N)
+    {
+        B minx = B::Load(mins.x + i), miny = B::Load(mins.y + i), minz = B::Load(mins.z + i);
+        B maxx = B::Load(maxs.x + i), maxy = B::Load(maxs.y + i), maxz = B::Load(maxs.z + i);
+        BatchMask<N> visible = BatchMask<N>::Set1(~0);
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            // point that is farthest along the plane normal, normal is same for all lanes so select once
+            B px = plane[0] >= 0.0f ? maxx : minx;
+            B py = plane[1] >= 0.0f ? maxy : miny;
+            B pz = plane[2] >= 0.0f ? maxz : minz;
+            B d = Fmadd(px, B::Set1(plane[0]), Fmadd(py, B::Set1(plane[1]), Fmadd(pz, B::Set1(plane[2]), B::Set1(plane[3]))));
+            visible = visible & (d >= B::Zero());
+        }
+        visibleBits[i >> 5] |= uint32(Movemask(visible)) << (i & 31);
+    }
+    return i;
+}
+
+inline void CullAABBArray(uint32* visibleBits, const Vector3SoA& mins, const Vector3SoA& maxs,
+                          const FrustumPlanes& frustum, int count)
+{
+    MemsetZero(visibleBits, ((count + 31) >> 5) * sizeof(uint32));
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { CullAABBArray512(visibleBits, mins, maxs, frustum, count); return; }
+#endif
+    int i = CullAABBKernel<AX_BATCH_WIDTH>(visibleBits, mins, maxs, frustum, 0, count);
+    CullAABBKernel<1>(visibleBits, mins, maxs, frustum, i, count);
+}
+
+// frustum planes has to be normalized (CreateFrustumPlanesNormalized), same test with CheckSphereCulled
+template<int N>
+inline int CullSpheresKernel(uint32* visibleBits, const Vector3SoA& centers, const float* radii,
+                             const FrustumPlanes& frustum, int i, int count)
+{
+    typedef Batch<float, N> B;
+    static_assert(32 % N == 0, "bitmask words must contain whole batches");
+    for (; i + N <= count; i += N)
+    {
+        B x = B::Load(centers.x + i), y = B::Load(centers.y + i), z = B::Load(centers.z + i);
+        B negRadius = -B::Load(radii + i);
+        BatchMask<N> visible = BatchMask<N>::Set1(~0);
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            B d = Fmadd(x, B::Set1(plane[0]), Fmadd(y, B::Set1(plane[1]), Fmadd(z, B::Set1(plane[2]), B::Set1(plane[3]))));
+            visible = visible & (d >= negRadius);
+        }
+        visibleBits[i >> 5] |= uint32(Movemask(visible)) << (i & 31);
+    }
+    return i;
+}
+
+inline void CullSpheresArray(uint32* visibleBits, const Vector3SoA& centers, const float* radii,
+                             const FrustumPlanes& frustum, int count)
+{
+    MemsetZero(visibleBits, ((count + 31) >> 5) * sizeof(uint32));
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { CullSpheresArray512(visibleBits, centers, radii, frustum, count); return; }
+#endif
+    int i = CullSpheresKernel<AX_BATCH_WIDTH>(visibleBits, centers, radii, frustum, 0, count);
+    CullSpheresKernel<1>(visibleBits, centers, radii, frustum, i, count);
+}
+
+// cones with apex, unit direction, height and base radius, spot lights has radius = range * tan(outer angle).
+// cone is culled if both apex and the farthest point of the base circle are behind one of the planes.
+// frustum planes has to be normalized, same test with CheckConeCulled
+template<int N>
+inline int CullConesKernel(uint32* visibleBits, const Vector3SoA& apexes, const Vector3SoA& directions,
+                           const float* heights, const float* radii, const FrustumPlanes& frustum, int i, int count)
+{
+    typedef Batch<float, N> B;
+    static_assert(32 % N == 0, "bitmask words must contain whole batches");
+    for (; i + N <= count; i += N)
+    {
+        B ax = B::Load(apexes.x + i), ay = B::Load(apexes.y + i), az = B::Load(apexes.z + i);
+        B dx = B::Load(directions.x + i), dy = B::Load(directions.y + i), dz = B::Load(directions.z + i);
+        B height = B::Load(heights + i), radius = B::Load(radii + i);
+        BatchMask<N> visible = BatchMask<N>::Set1(~0);
+
+        for (int p = 0; p < 5; p++) // make < 6 if you want far plane
+        {
+            const float* plane = frustum.x + p * 4;
+            B nx = B::Set1(plane[0]), ny = B::Set1(plane[1]), nz = B::Set1(plane[2]);
+            B apexDist = Fmadd(ax, nx, Fmadd(ay, ny, Fmadd(az, nz, B::Set1(plane[3]))));
+            B nd = Fmadd(dx, nx, Fmadd(dy, ny, dz * nz));
+            // length of the plane normal projected on the base circle
+            B sinAngle = Sqrt(Max(Fmadd(-nd, nd, B::Set1(1.0f)), B::Zero()));
+            B baseDist = Fmadd(radius, sinAngle, Fmadd(nd, height, apexDist));
+            visible = visible & (Max(apexDist, baseDist) >= B::Zero());
+        }
+        visibleBits[i >> 5] |= uint32(Movemask(visible)) << (i & 31);
+    }
+    return i;
+}
+
+inline void CullConesArray(uint32* visibleBits, const Vector3SoA& apexes, const Vector3SoA& directions,
+                           const float* heights, const float* radii, const FrustumPlanes& frustum, int count)
+{
+    MemsetZero(visibleBits, ((count + 31) >> 5) * sizeof(uint32));
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { CullConesArray512(visibleBits, apexes, directions, heights, radii, frustum, count); return; }
+#endif
+    int i = CullConesKernel<AX_BATCH_WIDTH>(visibleBits, apexes, directions, heights, radii, frustum, 0, count);
+    CullConesKernel<1>(visibleBits, apexes, directions, heights, radii, frustum, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Half                                     */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+inline void HalfToFloatArray(float* dst, const half* src, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { HalfToFloatArray512(dst, src, count); return; }
+#endif
+    int i = 0;
+#ifdef AX_SUPPORT_AVX2
+    for (; i + 8 <= count; i += 8)
+        Vec8StoreU(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+#endif
+    for (; i < count; i++)
+        dst[i] = ConvertHalfToFloat(src[i]);
+}
+
+inline void FloatToHalfArray(half* dst, const float* src, int count)
+{
+#ifdef AX_TARGET_AVX512
+    if (AX_HasAVX512()) { FloatToHalfArray512(dst, src, count); return; }
+#endif
+    int i = 0;
+#ifdef AX_SUPPORT_AVX2
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(Vec8Load(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+    for (; i < count; i++)
+        dst[i] = ConvertFloatToHalf(src[i]);
+}
+
+AX_END_NAMESPACE
@@ -0,0 +1,367 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Axis aligned boxes and bounding spheres, single bounds    *
+*      works with vec_t and array versions transforms and fits   *
+*      bounds with Batch<T, N> over structure of arrays.         *
+*   Be Aware:                                                    *
+*      w component of AABB min and max is ignored.               *
+*      TransformAABB gives the box of the transformed box, it is *
+*      bigger than the box of the transformed points.            *
+*      SphereFromPoints is Ritter's method with EPOS-6 initial   *
+*      points, radius is few percent bigger than the minimum.    *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Matrix.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  AABB                                    */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+struct AABB { vec_t min, max; };
+
+purefn AABB MakeAABB(Vector3f min, Vector3f max)
+{
+    return { VecSetR(min.x, min.y, min.z, 0.0f), VecSetR(max.x, max.y, max.z, 0.0f) };
+}
+
+// min is bigger than max, union or merge with empty box gives the other operand
+purefn AABB AABBEmpty() { return { VecSet1(FLT_MAX), VecSet1(-FLT_MAX) }; }
+
+purefn AABB VECTORCALL AABBUnion(const AABB& a, const AABB& b) { return { VecMin(a.min, b.min), VecMax(a.max, b.max) }; }
+purefn AABB VECTORCALL AABBMerge(const AABB& a, vec_t point)   { return { VecMin(a.min, point), VecMax(a.max, point) }; }
+
+purefn vec_t VECTORCALL AABBCenter(const AABB& a)  { return VecMul(VecAdd(a.min, a.max), VecSet1(0.5f)); }
+purefn vec_t VECTORCALL AABBExtents(const AABB& a) { return VecMul(VecSub(a.max, a.min), VecSet1(0.5f)); }
+
+purefn bool VECTORCALL AABBContains(const AABB& a, vec_t point)
+{
+    veci_t inside = VeciAnd(VecCmpGe(point, a.min), VecCmpLe(point, a.max));
+    return (VecMovemask(inside) & 7) == 7;
+}
+
+// returns true if b is completely inside of a
+purefn bool VECTORCALL AABBContains(const AABB& a, const AABB& b)
+{
+    veci_t inside = VeciAnd(VecCmpGe(b.min, a.min), VecCmpLe(b.max, a.max));
+    return (VecMovemask(inside) & 7) == 7;
+}
+
+// touching boxes are overlapping
+purefn bool VECTORCALL AABBOverlap(const AABB& a, const AABB& b)
+{
+    veci_t overlap = VeciAnd(VecCmpLe(a.min, b.max), VecCmpLe(b.min, a.max));
+    return (VecMovemask(overlap) & 7) == 7;
+}
+
+// Arvo's method: center is transformed, extents are transformed with absolute value of the matrix
+purefn AABB VECTORCALL TransformAABB(const AABB& box, const Matrix4& matrix)
+{
+    vec_t center  = Vector3Transform(AABBCenter(box), matrix.r);
+    vec_t extents = AABBExtents(box);
+    vec_t e = VecMul(VecMax(matrix.r[0], VecNeg(matrix.r[0])), VecSplatX(extents));
+    e = VecFmadd(VecMax(matrix.r[1], VecNeg(matrix.r[1])), VecSplatY(extents), e);
+    e = VecFmadd(VecMax(matrix.r[2], VecNeg(matrix.r[2])), VecSplatZ(extents), e);
+    return { VecSub(center, e), VecAdd(center, e) };
+}
+
+inline bool VECTORCALL CheckAABBCulled(const AABB& box, const FrustumPlanes& frustum, const Matrix4& model)
+{
+    return CheckAABBCulled(box.min, box.max, frustum, model);
+}
+
+// out[i] = TransformAABB(in[i], matrices[i]), for instances that has their own matrix
+inline void TransformAABBArray(AABB* out, const AABB* in, const Matrix4* matrices, int count)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = TransformAABB(in[i], matrices[i]);
+}
+
+// TransformAABB for boxes in structure of arrays that has the same matrix
+template<int N>
+inline int TransformAABBKernel(const Vector3SoA& outMin, const Vector3SoA& outMax, const Vector3SoA& min, const Vector3SoA& max,
+                               const Matrix4& matrix, int i, int count)
+{
+    typedef Batch<float, N> B;
+    const float* mins[3] = { min.x, min.y, min.z };
+    const float* maxs[3] = { max.x, max.y, max.z };
+    float* outMins[3] = { outMin.x, outMin.y, outMin.z };
+    float* outMaxs[3] = { outMax.x, outMax.y, outMax.z };
+    const B half = B::Set1(0.5f);
+
+    for (; i + N <= count; i += N)
+    {
+        B center[3], extents[3];
+        for (int c = 0; c < 3; c++)
+        {
+            B lo = B::Load(mins[c] + i), hi = B::Load(maxs[c] + i);
+            center[c]  = (lo + hi) * half;
+            extents[c] = (hi - lo) * half;
+        }
+
+        for (int j = 0; j < 3; j++)
+        {
+            B tc = B::Set1(matrix.m[3][j]), te = B::Zero();
+            for (int k = 0; k < 3; k++)
+            {
+                tc = Fmadd(center[k], B::Set1(matrix.m[k][j]), tc);
+                te = Fmadd(extents[k], B::Set1(Abs(matrix.m[k][j])), te);
+            }
+            (tc - te).Store(outMins[j] + i);
+            (tc + te).Store(outMaxs[j] + i);
+        }
+    }
+    return i;
+}
+
+inline void TransformAABBArray(const Vector3SoA& outMin, const Vector3SoA& outMax, const Vector3SoA& min, const Vector3SoA& max,
+                               const Matrix4& matrix, int count)
+{
+    int i = TransformAABBKernel<AX_BATCH_WIDTH>(outMin, outMax, min, max, matrix, 0, count);
+    TransformAABBKernel<1>(outMin, outMax, min, max, matrix, i, count);
+}
+
+// min and max of points [i, count) are accumulated to lanes of lo and hi
+template<int N>
+inline int AABBFromPointsKernel(Batch<float, N> lo[3], Batch<float, N> hi[3], const Vector3SoA& points, int i, int count)
+{
+    const float* p[3] = { points.x, points.y, points.z };
+    for (; i + N <= count; i += N)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            Batch<float, N> x = Batch<float, N>::Load(p[c] + i);
+            lo[c] = Min(lo[c], x);
+            hi[c] = Max(hi[c], x);
+        }
+    }
+    return i;
+}
+
+// bounds of skinned or animated vertices, returns AABBEmpty if count is zero
+inline AABB AABBFromPoints(const Vector3SoA& points, int count)
+{
+    typedef Batch<float, AX_BATCH_WIDTH> B;
+    B lo[3], hi[3];
+    for (int c = 0; c < 3; c++) lo[c] = B::Set1(FLT_MAX), hi[c] = B::Set1(-FLT_MAX);
+    int i = AABBFromPointsKernel(lo, hi, points, 0, count);
+
+    Batch<float, 1> lo1[3], hi1[3];
+    for (int c = 0; c < 3; c++)
+    {
+        float los[AX_BATCH_WIDTH], his[AX_BATCH_WIDTH];
+        lo[c].Store(los), hi[c].Store(his);
+        for (int l = 1; l < AX_BATCH_WIDTH; l++) los[0] = MIN(los[0], los[l]), his[0] = MAX(his[0], his[l]);
+        lo1[c] = Batch<float, 1>::Set1(los[0]), hi1[c] = Batch<float, 1>::Set1(his[0]);
+    }
+    AABBFromPointsKernel(lo1, hi1, points, i, count);
+    return { VecSetR(lo1[0].v[0], lo1[1].v[0], lo1[2].v[0], 0.0f), VecSetR(hi1[0].v[0], hi1[1].v[0], hi1[2].v[0], 0.0f) };
+}
+
+inline AABB AABBFromPoints(const Vector3f* points, int count)
+{
+    AABB box = AABBEmpty();
+    for (int i = 0; i < count; i++)
+        box = AABBMerge(box, VecSetR(points[i].x, points[i].y, points[i].z, 0.0f));
+    return box;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Sphere                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+struct Sphere
+{
+    union
+    {
+        vec_t v; // center in xyz, radius in w
+        struct { Vector3f center; float radius; };
+    };
+};
+
+purefn Sphere MakeSphere(Vector3f center, float radius)
+{
+    Sphere s;
+    s.v = VecSetR(center.x, center.y, center.z, radius);
+    return s;
+}
+
+purefn Sphere VECTORCALL SphereFromAABB(const AABB& box)
+{
+    vec_t extents = AABBExtents(box);
+    Sphere s;
+    s.v = AABBCenter(box);
+    VecSetW(s.v, Sqrt(Vec3Dotf(extents, extents)));
+    return s;
+}
+
+purefn bool VECTORCALL SphereContains(const Sphere& s, vec_t point)
+{
+    vec_t d = VecSub(point, s.v);
+    return Vec3Dotf(d, d) <= s.radius * s.radius;
+}
+
+// returns true if b is completely inside of a
+purefn bool VECTORCALL SphereContains(const Sphere& a, const Sphere& b)
+{
+    vec_t d = VecSub(b.v, a.v);
+    return Sqrt(Vec3Dotf(d, d)) + b.radius <= a.radius;
+}
+
+purefn bool VECTORCALL SphereOverlap(const Sphere& a, const Sphere& b)
+{
+    vec_t d = VecSub(b.v, a.v);
+    float r = a.radius + b.radius;
+    return Vec3Dotf(d, d) <= r * r;
+}
+
+// grows the sphere towards the point if it is outside, same as Ritter's second pass
+purefn Sphere VECTORCALL SphereMerge(const Sphere& s, vec_t point)
+{
+    vec_t d = VecSub(point, s.v);
+    float distSq = Vec3Dotf(d, d);
+    if (distSq <= s.radius * s.radius) return s;
+
+    float dist = Sqrt(distSq);
+    float radius = (s.radius + dist) * 0.5f;
+    Sphere r;
+    r.v = VecFmadd(d, VecSet1((radius - s.radius) / dist), s.v);
+    VecSetW(r.v, radius);
+    return r;
+}
+
+// smallest sphere that encloses both of the spheres
+purefn Sphere VECTORCALL SphereUnion(const Sphere& a, const Sphere& b)
+{
+    vec_t d = VecSub(b.v, a.v);
+    float dist = Sqrt(Vec3Dotf(d, d));
+    if (dist + b.radius <= a.radius) return a;
+    if (dist + a.radius <= b.radius) return b;
+
+    float radius = (dist + a.radius + b.radius) * 0.5f;
+    Sphere r;
+    r.v = VecFmadd(d, VecSet1((radius - a.radius) / dist), a.v);
+    VecSetW(r.v, radius);
+    return r;
+}
+
+// radius is scaled with the biggest axis scale of the matrix
+purefn Sphere VECTORCALL TransformSphere(const Sphere& s, const Matrix4& matrix)
+{
+    float scaleSq = MAX(MAX(Vec3Dotf(matrix.r[0], matrix.r[0]), Vec3Dotf(matrix.r[1], matrix.r[1])), Vec3Dotf(matrix.r[2], matrix.r[2]));
+    Sphere r;
+    r.v = Vector3Transform(s.v, matrix.r);
+    VecSetW(r.v, s.radius * Sqrt(scaleSq));
+    return r;
+}
+
+// index of the points that has min and max value along x, y and z are accumulated to lanes
+template<int N>
+inline int SphereExtremesKernel(Batch<float, N> lo[3], Batch<float, N> hi[3], BatchMask<N> loIndex[3], BatchMask<N> hiIndex[3],
+                                const Vector3SoA& points, int i, int count)
+{
+    typedef BatchMask<N> I;
+    const float* p[3] = { points.x, points.y, points.z };
+    int32 lanes[N];
+    for (int l = 0; l < N; l++) lanes[l] = l;
+    I index = I::Load(lanes) + I::Set1(i);
+
+    for (; i + N <= count; i += N, index = index + I::Set1(N))
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            Batch<float, N> x = Batch<float, N>::Load(p[c] + i);
+            I less = x < lo[c], greater = x > hi[c];
+            lo[c] = Select(lo[c], x, less);
+            hi[c] = Select(hi[c], x, greater);
+            loIndex[c] = Select(loIndex[c], index, less);
+            hiIndex[c] = Select(hiIndex[c], index, greater);
+        }
+    }
+    return i;
+}
+
+// grows the sphere with the points [i, count) that are outside of it, sphere is in scalars
+// because it changes after each outside point, batch only finds the outside points
+template<int N>
+inline int SphereGrowKernel(float center[3], float& radius, const Vector3SoA& points, int i, int count)
+{
+    typedef Batch<float, N> B;
+    for (; i + N <= count; i += N)
+    {
+        B dx = B::Load(points.x + i) - B::Set1(center[0]);
+        B dy = B::Load(points.y + i) - B::Set1(center[1]);
+        B dz = B::Load(points.z + i) - B::Set1(center[2]);
+        B distSq = Fmadd(dx, dx, Fmadd(dy, dy, dz * dz));
+        uint32 outside = uint32(Movemask(distSq > B::Set1(radius * radius)));
+
+        for (; outside; outside &= outside - 1)
+        {
+            int j = i + TrailingZeroCount32(outside);
+            float d[3] = { points.x[j] - center[0], points.y[j] - center[1], points.z[j] - center[2] };
+            float dist = Sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            if (dist <= radius) continue; // inside of the grown sphere
+            float newRadius = (radius + dist) * 0.5f;
+            float t = (newRadius - radius) / dist;
+            for (int c = 0; c < 3; c++) center[c] += d[c] * t;
+            radius = newRadius;
+        }
+    }
+    return i;
+}
+
+// Ritter's bounding sphere, initial sphere is the most distant pair of the extreme points along axes
+inline Sphere SphereFromPoints(const Vector3SoA& points, int count)
+{
+    if (count <= 0) return MakeSphere(MakeVec3(0.0f), 0.0f);
+    typedef Batch<float, AX_BATCH_WIDTH> B; typedef BatchMask<AX_BATCH_WIDTH> I;
+    B lo[3], hi[3];
+    I loIndex[3], hiIndex[3];
+    for (int c = 0; c < 3; c++)
+        lo[c] = B::Set1(FLT_MAX), hi[c] = B::Set1(-FLT_MAX), loIndex[c] = hiIndex[c] = I::Zero();
+    int i = SphereExtremesKernel(lo, hi, loIndex, hiIndex, points, 0, count);
+
+    const float* p[3] = { points.x, points.y, points.z };
+    int extremes[3][2];
+    for (int c = 0; c < 3; c++)
+    {
+        float los[AX_BATCH_WIDTH], his[AX_BATCH_WIDTH];
+        int32 loIdx[AX_BATCH_WIDTH], hiIdx[AX_BATCH_WIDTH];
+        lo[c].Store(los), hi[c].Store(his), loIndex[c].Store(loIdx), hiIndex[c].Store(hiIdx);
+        extremes[c][0] = extremes[c][1] = i < count ? i : 0;
+        for (int l = 0; l < AX_BATCH_WIDTH && i > 0; l++)
+        {
+            if (los[l] < p[c][extremes[c][0]]) extremes[c][0] = loIdx[l];
+            if (his[l] > p[c][extremes[c][1]]) extremes[c][1] = hiIdx[l];
+        }
+        for (int j = i; j < count; j++)
+        {
+            if (p[c][j] < p[c][extremes[c][0]]) extremes[c][0] = j;
+            if (p[c][j] > p[c][extremes[c][1]]) extremes[c][1] = j;
+        }
+    }
+
+    float bestSq = -1.0f, center[3], radius = 0.0f;
+    for (int c = 0; c < 3; c++)
+    {
+        int a = extremes[c][0], b = extremes[c][1];
+        float d[3] = { p[0][b] - p[0][a], p[1][b] - p[1][a], p[2][b] - p[2][a] };
+        float distSq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        if (distSq <= bestSq) continue;
+        bestSq = distSq;
+        for (int k = 0; k < 3; k++) center[k] = (p[k][a] + p[k][b]) * 0.5f;
+        radius = Sqrt(distSq) * 0.5f;
+    }
+
+    i = SphereGrowKernel<AX_BATCH_WIDTH>(center, radius, points, 0, count);
+    SphereGrowKernel<1>(center, radius, points, i, count);
+    return MakeSphere(MakeVec3(center[0], center[1], center[2]), radius);
+}
+
+AX_END_NAMESPACE
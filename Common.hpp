@@ -170,13 +170,17 @@ typedef uint32_t uint;
 // int arr[4];
 // AX_CPUID(1, arr);
 // int numCores = (arr[1] >> 16) & 0xff; // virtual cores included
-#if defined(__clang__) || defined(__GNUC__)
-//  #include <cpuid.h>
-//  #define AX_CPUID(num, regs)       __cpuid(num, regs[0], regs[1], regs[2], regs[3])
-//  #define AX_CPUID2(num, sub, regs) __cpuid_count(num, sub, regs[0], regs[1], regs[2], regs[3])
-    #define AX_CPUID(num, regs)       
+// AX_CPUID2 is for leafs that has sub leafs, for example 7 (extended features)
+#if (defined(__clang__) || defined(__GNUC__)) && (defined(__x86_64__) || defined(__i386__))
+    #include <cpuid.h>
+    #define AX_CPUID(num, regs)       __cpuid(num, regs[0], regs[1], regs[2], regs[3])
+    #define AX_CPUID2(num, sub, regs) __cpuid_count(num, sub, regs[0], regs[1], regs[2], regs[3])
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define AX_CPUID(num, regs)       __cpuid(regs, num)
+    #define AX_CPUID2(num, sub, regs) __cpuidex(regs, num, sub)
 #else
-    #define AX_CPUID(num, regs) __cpuid(regs, num)
+    #define AX_CPUID(num, regs)       regs[0] = regs[1] = regs[2] = regs[3] = 0
+    #define AX_CPUID2(num, sub, regs) regs[0] = regs[1] = regs[2] = regs[3] = 0
 #endif
 
 /* Architecture Detection */
@@ -199,7 +203,7 @@ typedef uint32_t uint;
     #endif
 #endif
 
-// write AX_NO_SSE2 or AX_NO_AVX2 to disable vector instructions
+// write AX_NO_SSE2, AX_NO_AVX2 or AX_NO_AVX512 to disable vector instructions
 
 /* Intrinsics Support */
 #if (defined(AX_X64) || defined(AX_X86)) && !defined(AX_ARM)
@@ -218,6 +222,15 @@ typedef uint32_t uint;
             #define AX_SUPPORT_AVX2
         #endif
     #endif
+
+    #if defined(__AVX512F__) && defined(AX_SUPPORT_AVX2) && !defined(AX_NO_AVX512)
+        #define AX_SUPPORT_AVX512
+    #endif
+
+    // pdep/pext, msvc doesn't define __BMI2__ but every AVX2 cpu has it. define AX_NO_BMI2 to disable
+    #if (defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))) && defined(AX_X64) && !defined(AX_NO_BMI2)
+        #define AX_SUPPORT_BMI2
+    #endif
     
     /* If at this point we still haven't determined compiler support for the intrinsics just fall back to __has_include. */
     #if !defined(__GNUC__) && !defined(__clang__) && defined(__has_include)
@@ -229,10 +242,19 @@ typedef uint32_t uint;
         #endif
     #endif
 
-    #if defined(AX_SUPPORT_AVX2) || defined(AX_SUPPORT_AVX)
+    // SSE path uses SSE4.1 and FMA instructions as well (blendv, dp, fmadd) so immintrin is required
+    #if defined(AX_SUPPORT_AVX2) || defined(AX_SUPPORT_SSE)
         #include <immintrin.h>
-    #elif defined(AX_SUPPORT_SSE)
-        #include <emmintrin.h>
+    #endif
+
+    // functions marked with this can use AVX-512 intrinsics without compiling whole program with AVX-512,
+    // call them only if (AX_SIMDBits() & CPUIDBits_AVX512) is true. define AX_NO_AVX512 to disable
+    #if defined(AX_SUPPORT_SSE) && !defined(AX_NO_AVX512)
+        #if defined(__clang__) || defined(__GNUC__)
+            #define AX_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma,f16c")))
+        #elif defined(_MSC_VER) && _MSC_VER >= 1920 /* 2019 */
+            #define AX_TARGET_AVX512
+        #endif
     #endif
 #endif
 
@@ -583,6 +605,59 @@ pureconst int64_t NextPowerOf2(int64_t x) {
 }
 
 
+//------------------------------------------------------------------------
+// Hashing, integer finalizers. fast and good enough for hash tables, not cryptographic
+
+// Thomas Wang's 64 bit mix
+pureconst uint64_t WangHash(uint64_t x)
+{
+    x = (~x) + (x << 21ull);
+    x = x ^ (x >> 24ull);
+    x = (x + (x << 3ull)) + (x << 8ull);
+    x = x ^ (x >> 14ull);
+    x = (x + (x << 2ull)) + (x << 4ull);
+    x = x ^ (x >> 28ull);
+    x = x + (x << 31ull);
+    return x;
+}
+
+pureconst uint32_t WangHash32(uint32_t x)
+{
+    x = (x ^ 61u) ^ (x >> 16u);
+    x *= 9u;
+    x = x ^ (x >> 4u);
+    x *= 0x27d4eb2du;
+    x = x ^ (x >> 15u);
+    return x;
+}
+
+// MurmurHash3 finalizers, every input bit affects every output bit
+pureconst uint64_t MurmurHash(uint64_t x)
+{
+    x ^= x >> 33ull;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33ull;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33ull;
+    return x;
+}
+
+// only uses multiply, xor and logical shift so it maps to SIMD integer ops as well
+pureconst uint32_t MurmurHash32(uint32_t x)
+{
+    x ^= x >> 16u;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13u;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16u;
+    return x;
+}
+
+pureconst uint64_t HashCombine(uint64_t seed, uint64_t hash)
+{
+    return seed ^ (hash + 0x9e3779b97f4a7c15ull + (seed << 6ull) + (seed >> 2ull));
+}
+
 //------------------------------------------------------------------------
 // Utilities
 
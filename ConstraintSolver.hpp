@@ -0,0 +1,385 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Projected Gauss-Seidel solver for contact and joint rows. *
+*      rows are colored so that rows with the same color doesn't *
+*      share a dynamic body, each color is split in batches of   *
+*      AX_BATCH_WIDTH rows that are solved in SIMD lanes.        *
+*      batches of one color can be solved in parallel.           *
+*   Be Aware:                                                    *
+*      bodies with zero inverse mass are static, they doesn't    *
+*      take a color and they are solved as the world with zero   *
+*      velocity, their velocities are never read or written.     *
+*      rows that doesn't fit in 32 colors are solved one by one. *
+*      PGS: warm start and iterate with errorRate = beta / dt.   *
+*      TGS: for each substep integrate forces, warm start,       *
+*      iterate, integrate positions, SolverIntegrateError then   *
+*      relax by iterating with zero errorRate.                   *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Matrix.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Format                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// linear and angular velocities of the bodies, solver reads and writes them in place
+struct BodyVelocitySoA { Vector3SoA linear; Vector3SoA angular; };
+
+// one dimensional velocity constraint between two bodies, filled by the physics layer.
+// J * v = dot(linear, vA - vB) + dot(angularA, wA) + dot(angularB, wB)
+// contact normal: linear = n, angularA = rA x n, angularB = -(rB x n), lower = 0, upper = FLT_MAX
+// friction rows has the same form with tangent directions and friction coefficient
+struct ConstraintRow
+{
+    int32 bodyA, bodyB;   // -1 for the static world
+    Vector3f linear;
+    Vector3f angularA;
+    Vector3f angularB;
+    float bias;           // target of J * v, restitution or motor speed
+    float error;          // position error, J * v is driven towards bias - errorRate * error
+    float lower, upper;   // impulse limits
+    float friction;       // if not zero limits are -friction * impulse, friction * impulse of normalRow
+    int32 normalRow;
+    float impulse;        // accumulated impulse of last step for warm starting
+};
+
+// per slot streams of the solver, streams[SolverStream * numSlots + slot]
+enum SolverStream : int
+{
+    SolverStream_LinearX,       SolverStream_LinearY,       SolverStream_LinearZ,
+    SolverStream_AngularAX,     SolverStream_AngularAY,     SolverStream_AngularAZ,
+    SolverStream_AngularBX,     SolverStream_AngularBY,     SolverStream_AngularBZ,
+    // jacobian multiplied with inverse mass and inverse inertia of the bodies
+    SolverStream_MassLinearAX,  SolverStream_MassLinearAY,  SolverStream_MassLinearAZ,
+    SolverStream_MassLinearBX,  SolverStream_MassLinearBY,  SolverStream_MassLinearBZ,
+    SolverStream_MassAngularAX, SolverStream_MassAngularAY, SolverStream_MassAngularAZ,
+    SolverStream_MassAngularBX, SolverStream_MassAngularBY, SolverStream_MassAngularBZ,
+    SolverStream_EffectiveMass,
+    SolverStream_Bias,
+    SolverStream_Error,
+    SolverStream_Lower,
+    SolverStream_Upper,
+    SolverStream_Friction,
+    SolverStream_Impulse,
+    SolverStream_Count
+};
+
+constexpr int SolverMaxColors = 32;
+
+// slots [colorStart[c], colorStart[c + 1]) belongs to color c, colors are padded to AX_BATCH_WIDTH
+// with empty slots. slots after colorStart[numColors] are overflow rows that are solved one by one
+struct ConstraintSolver
+{
+    float* streams;
+    int32* bodyA;      // -1 for the world, static bodies and empty slots
+    int32* bodyB;
+    int32* normalSlot; // slot of the normal row for friction rows, otherwise -1
+    int32* rowOfSlot;  // index of the input row, -1 for empty slots
+    int numSlots;
+    int numColors;
+    int colorStart[SolverMaxColors + 1];
+};
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Build                                    */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// invInertia is world space inverse inertia tensor of each body, memory is allocated with new[],
+// release it with DestroyConstraintSolver
+inline ConstraintSolver CreateConstraintSolver(const ConstraintRow* rows, int numRows,
+                                               const float* invMass, const Matrix3* invInertia, int numBodies)
+{
+    const int width = AX_BATCH_WIDTH;
+    // greedy coloring, each dynamic body keeps the colors that it is used
+    uint32* bodyColors = new uint32[numBodies];
+    int32* slotOfRow = new int32[numRows];
+    for (int b = 0; b < numBodies; b++) bodyColors[b] = 0;
+
+    int colorCount[SolverMaxColors] = {};
+    int numOverflow = 0;
+    for (int r = 0; r < numRows; r++)
+    {
+        int a = rows[r].bodyA, b = rows[r].bodyB;
+        bool dynamicA = a >= 0 && invMass[a] > 0.0f;
+        bool dynamicB = b >= 0 && invMass[b] > 0.0f;
+        uint32 used = (dynamicA ? bodyColors[a] : 0u) | (dynamicB ? bodyColors[b] : 0u);
+        if (used == ~0u) { slotOfRow[r] = -1; numOverflow++; continue; }
+
+        int color = TrailingZeroCount32(~used);
+        if (dynamicA) bodyColors[a] |= 1u << color;
+        if (dynamicB) bodyColors[b] |= 1u << color;
+        slotOfRow[r] = color;
+        colorCount[color]++;
+    }
+
+    ConstraintSolver solver;
+    solver.numColors = 0;
+    solver.colorStart[0] = 0;
+    for (int c = 0; c < SolverMaxColors && colorCount[c] > 0; c++, solver.numColors++)
+        solver.colorStart[c + 1] = solver.colorStart[c] + (colorCount[c] + width - 1) / width * width;
+
+    int numSlots = solver.colorStart[solver.numColors] + numOverflow;
+    solver.numSlots   = numSlots;
+    solver.streams    = new float[SolverStream_Count * numSlots];
+    solver.bodyA      = new int32[numSlots];
+    solver.bodyB      = new int32[numSlots];
+    solver.normalSlot = new int32[numSlots];
+    solver.rowOfSlot  = new int32[numSlots];
+
+    // empty slots has zero jacobian and effective mass, they never change the velocities
+    for (int i = 0; i < SolverStream_Count * numSlots; i++) solver.streams[i] = 0.0f;
+    for (int i = 0; i < numSlots; i++)
+        solver.bodyA[i] = solver.bodyB[i] = solver.normalSlot[i] = solver.rowOfSlot[i] = -1;
+
+    int cursor[SolverMaxColors + 1];
+    for (int c = 0; c <= solver.numColors; c++) cursor[c] = solver.colorStart[c];
+    for (int r = 0; r < numRows; r++)
+        slotOfRow[r] = slotOfRow[r] < 0 ? cursor[solver.numColors]++ : cursor[slotOfRow[r]]++;
+
+    for (int r = 0; r < numRows; r++)
+    {
+        const ConstraintRow& row = rows[r];
+        const int s = slotOfRow[r];
+        float* stream = solver.streams + s;
+        // static bodies are same as the world, same rule with the coloring. otherwise they would be written
+        // from many lanes of a color and nonzero inverse inertia would change their angular velocity
+        const int bodyA = row.bodyA >= 0 && invMass[row.bodyA] > 0.0f ? row.bodyA : -1;
+        const int bodyB = row.bodyB >= 0 && invMass[row.bodyB] > 0.0f ? row.bodyB : -1;
+        float massA = bodyA >= 0 ? invMass[bodyA] : 0.0f;
+        float massB = bodyB >= 0 ? invMass[bodyB] : 0.0f;
+        Vector3f angularA = bodyA >= 0 ? Matrix3::Multiply(invInertia[bodyA], row.angularA) : MakeVec3(0.0f);
+        Vector3f angularB = bodyB >= 0 ? Matrix3::Multiply(invInertia[bodyB], row.angularB) : MakeVec3(0.0f);
+
+        for (int c = 0; c < 3; c++)
+        {
+            stream[(SolverStream_LinearX + c) * numSlots]       = row.linear[c];
+            stream[(SolverStream_AngularAX + c) * numSlots]     = row.angularA[c];
+            stream[(SolverStream_AngularBX + c) * numSlots]     = row.angularB[c];
+            stream[(SolverStream_MassLinearAX + c) * numSlots]  = row.linear[c] * massA;
+            stream[(SolverStream_MassLinearBX + c) * numSlots]  = row.linear[c] * massB;
+            stream[(SolverStream_MassAngularAX + c) * numSlots] = angularA[c];
+            stream[(SolverStream_MassAngularBX + c) * numSlots] = angularB[c];
+        }
+
+        float k = (massA + massB) * Vector3f::Dot(row.linear, row.linear) +
+                  Vector3f::Dot(row.angularA, angularA) + Vector3f::Dot(row.angularB, angularB);
+        stream[SolverStream_EffectiveMass * numSlots] = k > 0.0f ? 1.0f / k : 0.0f;
+        stream[SolverStream_Bias * numSlots]     = row.bias;
+        stream[SolverStream_Error * numSlots]    = row.error;
+        stream[SolverStream_Lower * numSlots]    = row.lower;
+        stream[SolverStream_Upper * numSlots]    = row.upper;
+        stream[SolverStream_Friction * numSlots] = row.friction;
+        stream[SolverStream_Impulse * numSlots]  = row.impulse;
+
+        solver.bodyA[s]      = bodyA;
+        solver.bodyB[s]      = bodyB;
+        solver.normalSlot[s] = row.friction != 0.0f ? slotOfRow[row.normalRow] : -1;
+        solver.rowOfSlot[s]  = r;
+    }
+
+    delete[] bodyColors;
+    delete[] slotOfRow;
+    return solver;
+}
+
+inline void DestroyConstraintSolver(ConstraintSolver& solver)
+{
+    delete[] solver.streams;
+    delete[] solver.bodyA;
+    delete[] solver.bodyB;
+    delete[] solver.normalSlot;
+    delete[] solver.rowOfSlot;
+    solver.streams = nullptr;
+    solver.numSlots = solver.numColors = 0;
+}
+
+// writes accumulated impulses back to rows, so they can be used for warm starting next step
+inline void SolverStoreImpulses(const ConstraintSolver& solver, ConstraintRow* rows)
+{
+    const float* impulses = solver.streams + SolverStream_Impulse * solver.numSlots;
+    for (int s = 0; s < solver.numSlots; s++)
+        if (solver.rowOfSlot[s] >= 0) rows[solver.rowOfSlot[s]].impulse = impulses[s];
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Solve                                    */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+purefn Batch<float, N> SolverLoad(const ConstraintSolver& solver, int stream, int slot)
+{
+    return Batch<float, N>::Load(solver.streams + stream * solver.numSlots + slot);
+}
+
+// gathers velocities of the bodies, world (-1) has zero velocity
+template<int N>
+inline void SolverLoadVelocity(Batch<float, N> v[3], Batch<float, N> w[3], const BodyVelocitySoA& bodies, BatchMask<N> body)
+{
+    const float* linear[3]  = { bodies.linear.x,  bodies.linear.y,  bodies.linear.z };
+    const float* angular[3] = { bodies.angular.x, bodies.angular.y, bodies.angular.z };
+    BatchMask<N> world = body < BatchMask<N>::Zero();
+    BatchMask<N> index = Max(body, BatchMask<N>::Zero());
+    for (int c = 0; c < 3; c++)
+    {
+        v[c] = Select(Gather(linear[c], index), Batch<float, N>::Zero(), world);
+        w[c] = Select(Gather(angular[c], index), Batch<float, N>::Zero(), world);
+    }
+}
+
+// scatters velocities back, dynamic bodies are unique in a batch, world and static bodies are -1
+template<int N>
+inline void SolverStoreVelocity(const BodyVelocitySoA& bodies, BatchMask<N> body, const Batch<float, N> v[3], const Batch<float, N> w[3])
+{
+    float* const dst[6] = { bodies.linear.x, bodies.linear.y, bodies.linear.z, bodies.angular.x, bodies.angular.y, bodies.angular.z };
+    int32 index[N];
+    float lanes[6][N];
+    body.Store(index);
+    for (int c = 0; c < 3; c++) v[c].Store(lanes[c]), w[c].Store(lanes[c + 3]);
+
+    for (int l = 0; l < N; l++)
+    {
+        if (index[l] < 0) continue;
+        for (int c = 0; c < 6; c++) dst[c][index[l]] = lanes[c][l];
+    }
+}
+
+// J * v of the rows [i, i + N)
+template<int N>
+purefn Batch<float, N> SolverVelocityError(const ConstraintSolver& solver, int i, const Batch<float, N> va[3], const Batch<float, N> wa[3],
+                                           const Batch<float, N> vb[3], const Batch<float, N> wb[3])
+{
+    Batch<float, N> jv = Batch<float, N>::Zero();
+    for (int c = 0; c < 3; c++)
+    {
+        jv = Fmadd(SolverLoad<N>(solver, SolverStream_LinearX + c, i), va[c] - vb[c], jv);
+        jv = Fmadd(SolverLoad<N>(solver, SolverStream_AngularAX + c, i), wa[c], jv);
+        jv = Fmadd(SolverLoad<N>(solver, SolverStream_AngularBX + c, i), wb[c], jv);
+    }
+    return jv;
+}
+
+// applies impulse to velocities, A gets M^-1 * J * impulse and B gets -M^-1 * J * impulse
+template<int N>
+inline void SolverApplyImpulse(const ConstraintSolver& solver, int i, Batch<float, N> impulse, Batch<float, N> va[3], Batch<float, N> wa[3],
+                               Batch<float, N> vb[3], Batch<float, N> wb[3])
+{
+    for (int c = 0; c < 3; c++)
+    {
+        va[c] = Fmadd(SolverLoad<N>(solver, SolverStream_MassLinearAX + c, i), impulse, va[c]);
+        vb[c] = vb[c] - SolverLoad<N>(solver, SolverStream_MassLinearBX + c, i) * impulse;
+        wa[c] = Fmadd(SolverLoad<N>(solver, SolverStream_MassAngularAX + c, i), impulse, wa[c]);
+        wb[c] = Fmadd(SolverLoad<N>(solver, SolverStream_MassAngularBX + c, i), impulse, wb[c]);
+    }
+}
+
+// applies accumulated impulses of the slots [i, end)
+template<int N>
+inline int SolverWarmStartKernel(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, int i, int end)
+{
+    typedef Batch<float, N> B;
+    for (; i + N <= end; i += N)
+    {
+        BatchMask<N> a = BatchMask<N>::Load(solver.bodyA + i), b = BatchMask<N>::Load(solver.bodyB + i);
+        B va[3], wa[3], vb[3], wb[3];
+        SolverLoadVelocity(va, wa, bodies, a);
+        SolverLoadVelocity(vb, wb, bodies, b);
+        SolverApplyImpulse(solver, i, SolverLoad<N>(solver, SolverStream_Impulse, i), va, wa, vb, wb);
+        SolverStoreVelocity(bodies, a, va, wa);
+        SolverStoreVelocity(bodies, b, vb, wb);
+    }
+    return i;
+}
+
+// one projected Gauss-Seidel pass over the slots [i, end)
+template<int N>
+inline int SolveRowsKernel(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float errorRate, int i, int end)
+{
+    typedef Batch<float, N> B; typedef BatchMask<N> I;
+    float* impulses = solver.streams + SolverStream_Impulse * solver.numSlots;
+    const B rate = B::Set1(-errorRate);
+
+    for (; i + N <= end; i += N)
+    {
+        I a = I::Load(solver.bodyA + i), b = I::Load(solver.bodyB + i);
+        B va[3], wa[3], vb[3], wb[3];
+        SolverLoadVelocity(va, wa, bodies, a);
+        SolverLoadVelocity(vb, wb, bodies, b);
+
+        B target = Fmadd(SolverLoad<N>(solver, SolverStream_Error, i), rate, SolverLoad<N>(solver, SolverStream_Bias, i));
+        B jv = SolverVelocityError(solver, i, va, wa, vb, wb);
+        B impulse = B::Load(impulses + i);
+        B newImpulse = Fmadd(SolverLoad<N>(solver, SolverStream_EffectiveMass, i), target - jv, impulse);
+
+        // friction limits comes from the current impulse of the normal row
+        I normal = I::Load(solver.normalSlot + i);
+        I notFriction = normal < I::Zero();
+        B limit = SolverLoad<N>(solver, SolverStream_Friction, i) * Gather(impulses, Max(normal, I::Zero()));
+        B lower = Select(-limit, SolverLoad<N>(solver, SolverStream_Lower, i), notFriction);
+        B upper = Select(limit, SolverLoad<N>(solver, SolverStream_Upper, i), notFriction);
+        newImpulse = Min(Max(newImpulse, lower), upper);
+        newImpulse.Store(impulses + i);
+
+        SolverApplyImpulse(solver, i, newImpulse - impulse, va, wa, vb, wb);
+        SolverStoreVelocity(bodies, a, va, wa);
+        SolverStoreVelocity(bodies, b, vb, wb);
+    }
+    return i;
+}
+
+// error += dt * J * v for the slots [i, end), positions has to be integrated with the same velocities
+template<int N>
+inline int SolverIntegrateErrorKernel(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float dt, int i, int end)
+{
+    typedef Batch<float, N> B;
+    float* errors = solver.streams + SolverStream_Error * solver.numSlots;
+    for (; i + N <= end; i += N)
+    {
+        BatchMask<N> a = BatchMask<N>::Load(solver.bodyA + i), b = BatchMask<N>::Load(solver.bodyB + i);
+        B va[3], wa[3], vb[3], wb[3];
+        SolverLoadVelocity(va, wa, bodies, a);
+        SolverLoadVelocity(vb, wb, bodies, b);
+        Fmadd(SolverVelocityError(solver, i, va, wa, vb, wb), B::Set1(dt), B::Load(errors + i)).Store(errors + i);
+    }
+    return i;
+}
+
+inline void SolverWarmStart(const ConstraintSolver& solver, const BodyVelocitySoA& bodies)
+{
+    int i = SolverWarmStartKernel<AX_BATCH_WIDTH>(solver, bodies, 0, solver.colorStart[solver.numColors]);
+    SolverWarmStartKernel<1>(solver, bodies, i, solver.numSlots);
+}
+
+// solves the slots [begin, end) of one color, begin and end has to be multiple of AX_BATCH_WIDTH.
+// slot ranges of the same color doesn't share dynamic bodies, so threads can solve them in parallel
+inline void SolveBatches(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float errorRate, int begin, int end)
+{
+    SolveRowsKernel<AX_BATCH_WIDTH>(solver, bodies, errorRate, begin, end);
+}
+
+// solves rows that doesn't fit in any color, has to be called after the colors
+inline void SolveOverflow(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float errorRate)
+{
+    SolveRowsKernel<1>(solver, bodies, errorRate, solver.colorStart[solver.numColors], solver.numSlots);
+}
+
+// one iteration over all of the colors and overflow rows on this thread
+inline void SolverIterate(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float errorRate)
+{
+    SolveBatches(solver, bodies, errorRate, 0, solver.colorStart[solver.numColors]);
+    SolveOverflow(solver, bodies, errorRate);
+}
+
+inline void SolverIntegrateError(const ConstraintSolver& solver, const BodyVelocitySoA& bodies, float dt)
+{
+    int i = SolverIntegrateErrorKernel<AX_BATCH_WIDTH>(solver, bodies, dt, 0, solver.colorStart[solver.numColors]);
+    SolverIntegrateErrorKernel<1>(solver, bodies, dt, i, solver.numSlots);
+}
+
+AX_END_NAMESPACE
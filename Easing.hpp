@@ -0,0 +1,246 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Easing functions for vec_t, Batch and arrays, and CSS     *
+*      style cubic bezier easing (cubic-bezier(x1, y1, x2, y2))  *
+*      solved for many tweens at once with safeguarded Newton.   *
+*      all of the functions are branchless.                      *
+*   Be Aware:                                                    *
+*      array functions clamps input to [0, 1], others expects    *
+*      input in this range. sine easings uses same               *
+*      approximations with VecSin and VecCos.                    *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  vec_t                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+// same as the scalar versions in Math.hpp, for 4 tweens at once
+
+purefn vec_t VECTORCALL VecEaseIn(vec_t x) {
+    return VecMul(x, x);
+}
+
+purefn vec_t VECTORCALL VecEaseOut(vec_t x) {
+    vec_t r = VecSub(VecOne(), x);
+    return VecSub(VecOne(), VecMul(r, r));
+}
+
+// 2x^2 for first half, mirrored for second half
+purefn vec_t VECTORCALL VecEaseInOut(vec_t x) {
+    vec_t t = VecMin(x, VecSub(VecOne(), x));
+    vec_t r = VecMul(VecSet1(2.0f), VecMul(t, t));
+    return VecSelect(r, VecSub(VecOne(), r), VecCmpGe(x, VecSet1(0.5f)));
+}
+
+purefn vec_t VECTORCALL VecSmoothStep(vec_t x) {
+    return VecMul(VecMul(x, x), VecSub(VecSet1(3.0f), VecAdd(x, x)));
+}
+
+inline vec_t VECTORCALL VecEaseInSine(vec_t x) {
+    return VecSub(VecOne(), VecCos(VecMul(x, VecSet1(PI * 0.5f))));
+}
+
+inline vec_t VECTORCALL VecEaseOutSine(vec_t x) {
+    return VecSin(VecMul(x, VecSet1(PI * 0.5f)));
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Batch                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+enum EaseType : int
+{
+    EaseType_Linear,
+    EaseType_In,
+    EaseType_Out,
+    EaseType_InOut,
+    EaseType_SmoothStep,
+    EaseType_InSine,
+    EaseType_OutSine
+};
+
+template<int N>
+purefn Batch<float, N> EaseIn(Batch<float, N> x) {
+    return x * x;
+}
+
+template<int N>
+purefn Batch<float, N> EaseOut(Batch<float, N> x) {
+    Batch<float, N> r = Batch<float, N>::Set1(1.0f) - x;
+    return Batch<float, N>::Set1(1.0f) - r * r;
+}
+
+template<int N>
+purefn Batch<float, N> EaseInOut(Batch<float, N> x) {
+    typedef Batch<float, N> F;
+    F t = Min(x, F::Set1(1.0f) - x);
+    F r = F::Set1(2.0f) * t * t;
+    return Select(r, F::Set1(1.0f) - r, x >= F::Set1(0.5f));
+}
+
+template<int N>
+purefn Batch<float, N> SmoothStep(Batch<float, N> x) {
+    return x * x * (Batch<float, N>::Set1(3.0f) - (x + x));
+}
+
+template<int N>
+inline Batch<float, N> EaseInSine(Batch<float, N> x) {
+    return Batch<float, N>::Set1(1.0f) - Cos(x * Batch<float, N>::Set1(PI * 0.5f));
+}
+
+template<int N>
+inline Batch<float, N> EaseOutSine(Batch<float, N> x) {
+    return Sin(x * Batch<float, N>::Set1(PI * 0.5f));
+}
+
+// type is same for all lanes, constant folded when type is known at compile time
+template<int N>
+inline Batch<float, N> Ease(EaseType type, Batch<float, N> x)
+{
+    switch (type)
+    {
+        case EaseType_In:         return EaseIn(x);
+        case EaseType_Out:        return EaseOut(x);
+        case EaseType_InOut:      return EaseInOut(x);
+        case EaseType_SmoothStep: return SmoothStep(x);
+        case EaseType_InSine:     return EaseInSine(x);
+        case EaseType_OutSine:    return EaseOutSine(x);
+        default:                  return x;
+    }
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Cubic Bezier                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+// curve from (0, 0) to (1, 1) with control points (x1, y1) and (x2, y2), same as CSS transition-timing-function.
+// x1 and x2 has to be in [0, 1] so x(t) is monotonic, y can be outside for overshooting curves
+
+struct CubicBezierEase
+{
+    float x1, y1, x2, y2;
+};
+
+constexpr CubicBezierEase CubicBezierEase_Ease      = { 0.25f, 0.1f, 0.25f, 1.0f };
+constexpr CubicBezierEase CubicBezierEase_EaseIn    = { 0.42f, 0.0f, 1.0f,  1.0f };
+constexpr CubicBezierEase CubicBezierEase_EaseOut   = { 0.0f,  0.0f, 0.58f, 1.0f };
+constexpr CubicBezierEase CubicBezierEase_EaseInOut = { 0.42f, 0.0f, 0.58f, 1.0f };
+
+// number of solver iterations, 10 is enough for 1e-6 error on common curves.
+// curves that has vertical tangent inside (x1 > x2 with steep y) are ill conditioned in float precision
+constexpr int CubicBezierIterations = 10;
+
+// polynomial form of the curve: ((a * t + b) * t + c) * t
+struct CubicBezierCoefficients
+{
+    float ax, bx, cx, ay, by, cy;
+};
+
+purefn CubicBezierCoefficients MakeCubicBezierCoefficients(const CubicBezierEase& e)
+{
+    CubicBezierCoefficients k;
+    k.cx = 3.0f * e.x1;
+    k.bx = 3.0f * (e.x2 - e.x1) - k.cx;
+    k.ax = 1.0f - k.cx - k.bx;
+    k.cy = 3.0f * e.y1;
+    k.by = 3.0f * (e.y2 - e.y1) - k.cy;
+    k.ay = 1.0f - k.cy - k.by;
+    return k;
+}
+
+// finds t where x(t) = x and returns y(t). Newton steps that leaves the bracket [lo, hi]
+// are replaced with bisection, so it converges even if derivative is zero at the ends
+template<int N>
+inline Batch<float, N> CubicBezier(Batch<float, N> x, const CubicBezierCoefficients& k)
+{
+    typedef Batch<float, N> F;
+    const F ax = F::Set1(k.ax), bx = F::Set1(k.bx), cx = F::Set1(k.cx);
+    const F ax3 = F::Set1(3.0f * k.ax), bx2 = F::Set1(2.0f * k.bx);
+    const F half = F::Set1(0.5f);
+
+    F lo = F::Zero(), hi = F::Set1(1.0f), t = x;
+    for (int i = 0; i < CubicBezierIterations; i++)
+    {
+        F error = Fmadd(Fmadd(ax, t, bx), t, cx) * t - x;
+        F slope = Fmadd(Fmadd(ax3, t, bx2), t, cx);
+        BatchMask<N> above = error > F::Zero();
+        lo = Select(lo, t, ~above);
+        hi = Select(hi, t, above);
+
+        F newton = t - error / slope; // inf or nan when slope is zero, fails the bracket test below
+        BatchMask<N> inside = (newton >= lo) & (newton <= hi);
+        t = Select((lo + hi) * half, newton, inside);
+    }
+    return Fmadd(Fmadd(F::Set1(k.ay), t, F::Set1(k.by)), t, F::Set1(k.cy)) * t;
+}
+
+inline float CubicBezier(float x, const CubicBezierEase& e)
+{
+    return CubicBezier(Batch<float, 1>::Set1(Clamp01(x)), MakeCubicBezierCoefficients(e)).v[0];
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Arrays                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// dst and src can be the same array
+
+template<int N, EaseType Type>
+inline int EaseKernel(float* dst, const float* src, int i, int count)
+{
+    typedef Batch<float, N> F;
+    for (; i + N <= count; i += N)
+    {
+        F x = Min(Max(F::Load(src + i), F::Zero()), F::Set1(1.0f));
+        Ease(Type, x).Store(dst + i);
+    }
+    return i;
+}
+
+template<EaseType Type>
+inline void EaseArray(float* dst, const float* src, int count)
+{
+    int i = EaseKernel<AX_BATCH_WIDTH, Type>(dst, src, 0, count);
+    EaseKernel<1, Type>(dst, src, i, count);
+}
+
+template<int N>
+inline int CubicBezierKernel(float* dst, const float* src, const CubicBezierCoefficients& k, int i, int count)
+{
+    typedef Batch<float, N> F;
+    for (; i + N <= count; i += N)
+    {
+        F x = Min(Max(F::Load(src + i), F::Zero()), F::Set1(1.0f));
+        CubicBezier(x, k).Store(dst + i);
+    }
+    return i;
+}
+
+// switch is outside of the loop, each type has its own kernel
+inline void EaseArray(float* dst, const float* src, int count, EaseType type)
+{
+    switch (type)
+    {
+        case EaseType_In:         EaseArray<EaseType_In>(dst, src, count);         break;
+        case EaseType_Out:        EaseArray<EaseType_Out>(dst, src, count);        break;
+        case EaseType_InOut:      EaseArray<EaseType_InOut>(dst, src, count);      break;
+        case EaseType_SmoothStep: EaseArray<EaseType_SmoothStep>(dst, src, count); break;
+        case EaseType_InSine:     EaseArray<EaseType_InSine>(dst, src, count);     break;
+        case EaseType_OutSine:    EaseArray<EaseType_OutSine>(dst, src, count);    break;
+        default:                  EaseArray<EaseType_Linear>(dst, src, count);     break;
+    }
+}
+
+inline void CubicBezierArray(float* dst, const float* src, int count, const CubicBezierEase& ease)
+{
+    CubicBezierCoefficients k = MakeCubicBezierCoefficients(ease);
+    int i = CubicBezierKernel<AX_BATCH_WIDTH>(dst, src, k, 0, count);
+    CubicBezierKernel<1>(dst, src, k, i, count);
+}
+
+AX_END_NAMESPACE
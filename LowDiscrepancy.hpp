@@ -0,0 +1,357 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Halton, Sobol and R2 (Kronecker) low discrepancy          *
+*      sequences in 1 to 4 dimensions, evaluated 4, 8 or 16      *
+*      indices at once with Batch<int32, N>.                     *
+*      Sobol has hash based Owen scrambling (Burley 2020).       *
+*      mapping helpers to disk, hemisphere and cosine weighted   *
+*      hemisphere that preserves the stratification.             *
+*   Be Aware:                                                    *
+*      Halton bases other than 2 are exact for index < 2^24.     *
+*      hemispheres are around +Z.                                *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Helpers                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+purefn BatchMask<N> ReverseBits(BatchMask<N> x)
+{
+    typedef BatchMask<N> I;
+    x = (ShiftRightLogical(x, 1) & I::Set1(0x55555555)) | ((x & I::Set1(0x55555555)) << 1);
+    x = (ShiftRightLogical(x, 2) & I::Set1(0x33333333)) | ((x & I::Set1(0x33333333)) << 2);
+    x = (ShiftRightLogical(x, 4) & I::Set1(0x0F0F0F0F)) | ((x & I::Set1(0x0F0F0F0F)) << 4);
+    x = (ShiftRightLogical(x, 8) & I::Set1(0x00FF00FF)) | ((x & I::Set1(0x00FF00FF)) << 8);
+    return ShiftRightLogical(x, 16) | (x << 16);
+}
+
+// 0.32 fixed point to [0, 1), top 24 bits so result never rounds up to 1
+template<int N>
+purefn Batch<float, N> FixedToUnitFloat(BatchMask<N> x)
+{
+    return ToFloat(ShiftRightLogical(x, 8)) * Batch<float, N>::Set1(1.0f / 16777216.0f);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Halton                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+constexpr int HaltonBases[4] = { 2, 3, 5, 7 };
+
+// digits of index in given base mirrored around the decimal point
+template<int N>
+purefn Batch<float, N> RadicalInverse(BatchMask<N> index, int base)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    if (base == 2)
+        return FixedToUnitFloat(ReverseBits(index));
+
+    const F invBase = F::Set1(1.0f / float(base));
+    const I vbase = I::Set1(base), baseMinusOne = I::Set1(base - 1);
+    F result = F::Zero(), scale = invBase;
+
+    while (Any(index > I::Zero()))
+    {
+        // division with float reciprocal can be off by one, fix it with remainder
+        I q = ToInt(ToFloat(index) * invBase);
+        I r = index - q * vbase;
+        I under = r < I::Zero();
+        q = q + under;
+        r = r + (under & vbase);
+        I over = r > baseMinusOne;
+        q = q - over;
+        r = r - (over & vbase);
+
+        result = Fmadd(ToFloat(r), scale, result);
+        scale  = scale * invBase;
+        index  = q;
+    }
+    return Min(result, F::Set1(0.99999994f));
+}
+
+// dim is in [0, 4) and uses bases 2, 3, 5, 7
+template<int N>
+purefn Batch<float, N> Halton(BatchMask<N> index, int dim)
+{
+    return RadicalInverse(index, HaltonBases[dim]);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Sobol                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// direction numbers of first 4 dimensions from Joe & Kuo, most significant bit first
+constexpr uint32 SobolDirections[4][32] = {
+    {
+        0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+        0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+        0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+        0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u,
+    },
+    {
+        0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+        0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+        0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+        0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu,
+    },
+    {
+        0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+        0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+        0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+        0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u,
+    },
+    {
+        0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+        0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+        0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+        0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u,
+    },
+};
+
+// sobol point as 0.32 fixed point, xor of direction numbers of set bits in index
+template<int N>
+purefn BatchMask<N> SobolBits(BatchMask<N> index, int dim)
+{
+    typedef BatchMask<N> I;
+    if (dim == 0)
+        return ReverseBits(index);
+
+    I result = I::Zero();
+    for (int k = 0; k < 32 && Any(~(index == I::Zero())); k++)
+    {
+        I bitMask = (index << 31) >> 31; // all ones if lowest bit is set
+        result = result ^ (bitMask & I::Set1(int32(SobolDirections[dim][k])));
+        index  = ShiftRightLogical(index, 1);
+    }
+    return result;
+}
+
+// Laine-Karras hash, permutes bits so that each bit only depends on lower bits
+template<int N>
+purefn BatchMask<N> LaineKarrasPermutation(BatchMask<N> x, BatchMask<N> seed)
+{
+    typedef BatchMask<N> I;
+    x = x + seed;
+    x = x ^ (x * I::Set1(0x6c50b47c));
+    x = x ^ (x * I::Set1(int32(0xb82f1e52u)));
+    x = x ^ (x * I::Set1(int32(0xc7afe638u)));
+    x = x ^ (x * I::Set1(int32(0x8d22f6e6u)));
+    return x;
+}
+
+// each bit is flipped depending on all higher bits, same as Owen scrambling
+template<int N>
+purefn BatchMask<N> NestedUniformScramble(BatchMask<N> x, BatchMask<N> seed)
+{
+    return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+}
+
+template<int N>
+purefn Batch<float, N> Sobol(BatchMask<N> index, int dim)
+{
+    return FixedToUnitFloat(SobolBits(index, dim));
+}
+
+// Burley 2020, Practical Hash-based Owen Scrambling. index is shuffled as well
+// so different seeds gives different sample order. dimensions use decorrelated seeds
+template<int N>
+purefn Batch<float, N> SobolOwen(BatchMask<N> index, int dim, uint32 seed)
+{
+    typedef BatchMask<N> I;
+    index = NestedUniformScramble(index, I::Set1(int32(MurmurHash32(seed))));
+    I bits = SobolBits(index, dim);
+    return FixedToUnitFloat(NestedUniformScramble(bits, I::Set1(int32(MurmurHash32(seed + uint32(dim) * 0x9e3779b9u + 1u)))));
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                R2 Kronecker                              */
+/*//////////////////////////////////////////////////////////////////////////*/
+// Martin Roberts, The Unreasonable Effectiveness of Quasirandom Sequences.
+// x = fract(0.5 + index * alpha) in 0.32 fixed point, wrapping integer math is the fract
+
+// fractional parts of 1 / phi^k, where phi is the positive root of x^(d+1) = x + 1
+constexpr uint32 KroneckerAlpha[4][4] = {
+    { 0x9e3779b9u, 0u,          0u,          0u          },
+    { 0xc13fa9a9u, 0x91e10da6u, 0u,          0u          },
+    { 0xd1b54a33u, 0xabc98389u, 0x8cb92ba7u, 0u          },
+    { 0xdb4f0b91u, 0xbbe05633u, 0xa0f2ec76u, 0x89e18285u }
+};
+
+// numDims is in [1, 4], dim is in [0, numDims)
+template<int N>
+purefn Batch<float, N> Kronecker(BatchMask<N> index, int dim, int numDims)
+{
+    typedef BatchMask<N> I;
+    I x = I::Set1(int32(0x80000000u)) + index * I::Set1(int32(KroneckerAlpha[numDims - 1][dim]));
+    return FixedToUnitFloat(x);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Scalar                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+typedef BatchMask<1> SequenceIndex1;
+
+purefn float Halton(uint32 index, int dim) { return Halton(SequenceIndex1::Set1(int32(index)), dim).v[0]; }
+purefn float Sobol(uint32 index, int dim)  { return Sobol(SequenceIndex1::Set1(int32(index)), dim).v[0]; }
+purefn float SobolOwen(uint32 index, int dim, uint32 seed) { return SobolOwen(SequenceIndex1::Set1(int32(index)), dim, seed).v[0]; }
+purefn float Kronecker(uint32 index, int dim, int numDims) { return Kronecker(SequenceIndex1::Set1(int32(index)), dim, numDims).v[0]; }
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Arrays                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+enum SequenceType : int
+{
+    SequenceType_Halton,
+    SequenceType_Sobol,     // Owen scrambled with seed
+    SequenceType_Kronecker  // R2 in two dimensions
+};
+
+template<int N>
+purefn Batch<float, N> SequenceSample(SequenceType type, BatchMask<N> index, int dim, int numDims, uint32 seed)
+{
+    switch (type)
+    {
+        case SequenceType_Halton: return Halton(index, dim);
+        case SequenceType_Sobol:  return SobolOwen(index, dim, seed);
+        default:                  return Kronecker(index, dim, numDims);
+    }
+}
+
+template<int N>
+inline int SequenceKernel(float* dst, SequenceType type, int dim, int numDims, uint32 first, uint32 seed, int i, int count)
+{
+    static const int32 lanes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    typedef BatchMask<N> I;
+    const I laneIndex = I::Load(lanes);
+    for (; i + N <= count; i += N)
+        SequenceSample(type, I::Set1(int32(first + uint32(i))) + laneIndex, dim, numDims, seed).Store(dst + i);
+    return i;
+}
+
+// writes samples [first, first + count) of one dimension of a numDims dimensional sequence
+inline void SequenceArray(float* dst, int count, SequenceType type, int dim, int numDims, uint32 first = 0, uint32 seed = 0)
+{
+    int i = SequenceKernel<AX_BATCH_WIDTH>(dst, type, dim, numDims, first, seed, 0, count);
+    SequenceKernel<1>(dst, type, dim, numDims, first, seed, i, count);
+}
+
+inline void SequenceArray2D(Vector2SoA dst, int count, SequenceType type, uint32 first = 0, uint32 seed = 0)
+{
+    SequenceArray(dst.x, count, type, 0, 2, first, seed);
+    SequenceArray(dst.y, count, type, 1, 2, first, seed);
+}
+
+inline void SequenceArray3D(Vector3SoA dst, int count, SequenceType type, uint32 first = 0, uint32 seed = 0)
+{
+    SequenceArray(dst.x, count, type, 0, 3, first, seed);
+    SequenceArray(dst.y, count, type, 1, 3, first, seed);
+    SequenceArray(dst.z, count, type, 2, 3, first, seed);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Mapping                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// maps [0, 1)^2 samples, neighbouring samples stays neighbour after mapping
+
+// Shirley & Chiu concentric mapping to unit disk
+template<int N>
+inline void MapToDisk(Batch<float, N> u, Batch<float, N> v, Batch<float, N>* x, Batch<float, N>* y)
+{
+    typedef Batch<float, N> F;
+    F a = Fmadd(u, F::Set1(2.0f), F::Set1(-1.0f));
+    F b = Fmadd(v, F::Set1(2.0f), F::Set1(-1.0f));
+    BatchMask<N> useA = Abs(a) > Abs(b);
+
+    F r   = Select(b, a, useA);
+    F num = Select(a, b, useA);
+    F den = Select(b, a, useA);
+    den   = Select(den, F::Set1(1.0f), Abs(den) <= F::Zero()); // center, r is zero anyway
+    F phi = num / den * F::Set1(PI / 4.0f);
+    phi   = Select(F::Set1(HalfPI) - phi, phi, useA);
+
+    F c, s = SinCos(&c, phi);
+    *x = r * c;
+    *y = r * s;
+}
+
+template<int N>
+inline void MapToHemisphere(Batch<float, N> u, Batch<float, N> v, Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z)
+{
+    typedef Batch<float, N> F;
+    F r = Sqrt(Max(F::Set1(1.0f) - u * u, F::Zero()));
+    F c, s = SinCos(&c, Fmadd(v, F::Set1(TwoPI), F::Set1(-PI)));
+    *x = r * c;
+    *y = r * s;
+    *z = u;
+}
+
+// Malley's method, concentric disk projected up to the hemisphere. pdf is cos(theta) / PI
+template<int N>
+inline void MapToCosineHemisphere(Batch<float, N> u, Batch<float, N> v, Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z)
+{
+    typedef Batch<float, N> F;
+    MapToDisk(u, v, x, y);
+    *z = Sqrt(Max(F::Set1(1.0f) - *x * *x - *y * *y, F::Zero()));
+}
+
+template<int N>
+inline int MapToDiskKernel(Vector2SoA dst, const Vector2SoA& src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+    {
+        Batch<float, N> x, y;
+        MapToDisk(Batch<float, N>::Load(src.x + i), Batch<float, N>::Load(src.y + i), &x, &y);
+        x.Store(dst.x + i);
+        y.Store(dst.y + i);
+    }
+    return i;
+}
+
+template<int N, bool Cosine>
+inline int MapToHemisphereKernel(Vector3SoA dst, const Vector2SoA& src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+    {
+        Batch<float, N> x, y, z;
+        Batch<float, N> u = Batch<float, N>::Load(src.x + i), v = Batch<float, N>::Load(src.y + i);
+        if (Cosine) MapToCosineHemisphere(u, v, &x, &y, &z);
+        else        MapToHemisphere(u, v, &x, &y, &z);
+        x.Store(dst.x + i);
+        y.Store(dst.y + i);
+        z.Store(dst.z + i);
+    }
+    return i;
+}
+
+// dst and src can be the same arrays
+inline void MapToDiskArray(Vector2SoA dst, const Vector2SoA& src, int count)
+{
+    int i = MapToDiskKernel<AX_BATCH_WIDTH>(dst, src, 0, count);
+    MapToDiskKernel<1>(dst, src, i, count);
+}
+
+inline void MapToHemisphereArray(Vector3SoA dst, const Vector2SoA& src, int count)
+{
+    int i = MapToHemisphereKernel<AX_BATCH_WIDTH, false>(dst, src, 0, count);
+    MapToHemisphereKernel<1, false>(dst, src, i, count);
+}
+
+inline void MapToCosineHemisphereArray(Vector3SoA dst, const Vector2SoA& src, int count)
+{
+    int i = MapToHemisphereKernel<AX_BATCH_WIDTH, true>(dst, src, 0, count);
+    MapToHemisphereKernel<1, true>(dst, src, i, count);
+}
+
+AX_END_NAMESPACE
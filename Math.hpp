@@ -81,8 +81,8 @@ pureconst float SqrtConstexpr(float a) {
 purefn float Sqrt(float a) {
 #ifdef AX_SUPPORT_SSE
     return _mm_cvtss_f32(_mm_sqrt_ps(_mm_set_ps1(a)));
-#elif defined(__clang__)
-    return __builtin_sqrt(a);
+#elif defined(__clang__) || defined(__GNUC__)
+    return __builtin_sqrtf(a); // correctly rounded, same result with vector sqrt instructions
 #else
     return SqrtConstexpr(a);
 #endif
@@ -246,7 +246,7 @@ pureconst T FMod(T x, T y) {
 template<typename T>
 pureconst T Floor(T x) {
     T whole = (T)(int)x;  // truncate quotient to integer
-    return x - (x-whole);
+    return whole - T(x < whole); // truncation rounds negative numbers up
 }
 
 template<typename T>
@@ -359,20 +359,60 @@ pureconst float Cos0pi(float a) {
     return 1.0f - 32.0f * a * a * (0.75f - a);
 }
 
+// a * b + c without rounding the product. compilers doesn't fuse a * b + c when floating point contraction is off
+// (-ffp-contract=off, msvc /fp:precise), use this where the rounding of the product matters
+pureconst float Fmadd(float a, float b, float c)
+{
+#if AX_COMPILER_HAS_BUILTIN(__builtin_fmaf) && AX_COMPILER_HAS_BUILTIN(__builtin_is_constant_evaluated)
+    if (!__builtin_is_constant_evaluated())
+        return __builtin_fmaf(a, b, c);
+#endif
+    // product of two floats is exact in double, sum is rounded twice only in rare halfway cases
+    return float(double(a) * double(b) + double(c));
+}
+
+// PI / 2 split in three parts for Cody-Waite range reduction (from cephes sinf),
+// steps are fused multiply adds so the products with the quadrant number doesn't lose bits
+constexpr float HalfPIPart1 = 1.5703125f;
+constexpr float HalfPIPart2 = 4.837512969970703125e-4f;
+constexpr float HalfPIPart3 = 7.54978995489188216e-8f;
+constexpr float SinCosMaxQuadrant = 4194304.0f; // 2^22, rounding with 1.5 * 2^23 is exact below this
+
+// sin and cos with one shared range reduction, accepts any float. error is below 1.5e-7 for |x| < 1e6,
+// precision drops after that but results are always in [-1, 1] for finite inputs.
+// polynomials are minimax on [-PI/4, PI/4] (cephes sinf, cosf)
+__constexpr inline void SinCos(float x, float* sp, float* cp)
+{
+    const float magic = 12582912.0f; // 1.5 * 2^23, adding and subtracting rounds to nearest integer
+    float j = Clamp(x * (2.0f / PI), -SinCosMaxQuadrant, SinCosMaxQuadrant);
+    j = (j + magic) - magic;
+    float r = Fmadd(-j, HalfPIPart1, x);
+    r = Fmadd(-j, HalfPIPart2, r);
+    r = Fmadd(-j, HalfPIPart3, r);
+    r = Clamp(r, -HalfPI, HalfPI); // only clamps when x is too big to reduce, polynomials stay in [-1, 1]
+    
+    float r2 = r * r;
+    float s = r + r * r2 * ((-1.9515295891e-4f * r2 + 8.3321608736e-3f) * r2 - 1.6666654611e-1f);
+    float c = 1.0f - 0.5f * r2 + r2 * r2 * ((2.443315711809948e-5f * r2 - 1.388731625493765e-3f) * r2 + 4.166664568298827e-2f);
+    
+    int quadrant = int(j) & 3; // sin: s, c, -s, -c  cos: c, -s, -c, s
+    float sv = quadrant & 1 ? c : s, cv = quadrant & 1 ? s : c;
+    *sp = quadrant & 2 ? -sv : sv;
+    *cp = (quadrant + 1) & 2 ? -cv : cv;
+}
+
 // R suffix allows us to use with greater range than -TwoPI, TwoPI
 pureconst float SinR(float x) {
-    return Sin(FMod(x + PI, TwoPI) - PI);
+    float s = 0.0f, c = 0.0f;
+    SinCos(x, &s, &c);
+    return s;
 }
 
 // R suffix allows us to use with greater range than -TwoPI, TwoPI
 pureconst float CosR(float x) {
-    return Cos(FMod(x + PI, TwoPI) - PI);
-}
-
-pureconst void SinCos(float x, float* sp, float* cp) 
-{
-    *sp = Sin(x);
-    *cp = Cos(x);
+    float s = 0.0f, c = 0.0f;
+    SinCos(x, &s, &c);
+    return c;
 }
 
 // https://github.com/id-Software/DOOM-3/blob/master/neo/idlib/math/Math.h
@@ -426,11 +466,12 @@ purefn float ConvertHalfToFloat(half x) {
 #elif defined(__ARM_NEON__)
     return _cvtsh_ss(x); 
 #else
+    uint h = x;
     uint h_e = h & 0x00007c00u;
     uint h_m = h & 0x000003ffu;
     uint h_s = h & 0x00008000u;
     uint h_e_f_bias = h_e + 0x0001c000u;
-    uint h_m_nlz = LeadingZeroCount(h_m) - (32u - 10u); // Assuming 32-bit integer
+    uint h_m_nlz = LeadingZeroCount32(h_m | 1u) - (32u - 10u); // only used when denormal, | 1 avoids clz(0)
 
     uint f_s = h_s << 0x00000010u;
     uint f_e = h_e_f_bias << 0x0000000du;
@@ -596,7 +637,9 @@ pureconst float EaseOut(float x) {
 }
 
 pureconst float EaseInOut(float x) {
-    return x < 0.5f ? 2.0f * x * x : 1.0f - Sqr(-2.0f * x + 2.0f) / 2.0f;
+    float t = MIN(x, 1.0f - x); // both halves are computed, compiles to select instead of branch
+    float r = 2.0f * t * t;
+    return x < 0.5f ? r : 1.0f - r;
 }
 
 // integral symbol shaped interpolation, similar to EaseInOut
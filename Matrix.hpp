@@ -292,9 +292,8 @@ struct alignas(16) Matrix4
     
     static Matrix4 PositionRotationScale(Vector3f position, Quaternion rotation, const Vector3f& scale)
     {
-        Matrix4 res;
         // Export rotation to matrix
-        MatrixFromQuaternion<4>(res.GetPtr(), rotation);
+        Matrix4 res = FromQuaternion(rotation);
         // Scale 3x3 matrix by given scale
         res.r[0] = VecMulf(res.r[0], scale.x);
         res.r[1] = VecMulf(res.r[1], scale.y);
@@ -307,9 +306,8 @@ struct alignas(16) Matrix4
     
     static Matrix4 PositionRotationScale(const float* position, const float* rotation, const float* scale)
     {
-        Matrix4 res = {};
         // Export rotation to matrix
-        MatrixFromQuaternion<4>(res.GetPtr(), VecLoad(rotation));
+        Matrix4 res = FromQuaternion(VecLoad(rotation));
         // Scale 3x3 matrix by given scale
         vec_t vecScale = VecLoad(scale);
         res.r[0] = VecMul(res.r[0], VecSplatX(vecScale));
@@ -337,12 +335,12 @@ struct alignas(16) Matrix4
     
     static Vector3f VECTORCALL ExtractScale(const Matrix4 matrix) 
     {
-    	return MakeVec3(Vec3Lenf(matrix.r[0]), Vec3Lenf(matrix.r[2]), Vec3Lenf(matrix.r[1]));
+    	return MakeVec3(Vec3Lenf(matrix.r[0]), Vec3Lenf(matrix.r[1]), Vec3Lenf(matrix.r[2]));
     }
         
     static vec_t VECTORCALL ExtractScaleV(const Matrix4 matrix) 
     {
-    	return VecSetR(Vec3Lenf(matrix.r[0]), Vec3Lenf(matrix.r[2]), Vec3Lenf(matrix.r[1]), 0.0f);
+    	return VecSetR(Vec3Lenf(matrix.r[0]), Vec3Lenf(matrix.r[1]), Vec3Lenf(matrix.r[2]), 0.0f);
     }
 
     static Matrix4 RotationX(float angleRadians) {
@@ -690,6 +688,421 @@ struct alignas(16) Matrix4
         return ::Vector4Transform(V, M.r);
     }
 };
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Batch TRS                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// compose and decompose position rotation scale streams to/from Matrix4 arrays.
+// works on 4 matrices at a time, each vec_t lane holds the same element of different matrix,
+// so there is no horizontal operations. remaining elements are padded to 4 and processed with the same code.
+
+inline void ComposeTRS4(Matrix4* out, const Vector3SoA& positions, const QuaternionSoA& rotations, const Vector3SoA& scales, int i)
+{
+    const vec_t q[4] = { VecLoad(rotations.x + i), VecLoad(rotations.y + i), 
+                         VecLoad(rotations.z + i), VecLoad(rotations.w + i) };
+    vec_t m[3][3];
+    MatrixFromQuaternionSoA(m, q);
+    
+    const vec_t scale[3] = { VecLoad(scales.x + i), VecLoad(scales.y + i), VecLoad(scales.z + i) };
+    for (int j = 0; j < 3; j++)
+    {
+        vec_t r0 = VecMul(m[j][0], scale[j]);
+        vec_t r1 = VecMul(m[j][1], scale[j]);
+        vec_t r2 = VecMul(m[j][2], scale[j]);
+        vec_t r3 = VecZero();
+        VecTranspose(r0, r1, r2, r3);
+        out[0].r[j] = r0; out[1].r[j] = r1; 
+        out[2].r[j] = r2; out[3].r[j] = r3;
+    }
+    vec_t r0 = VecLoad(positions.x + i);
+    vec_t r1 = VecLoad(positions.y + i);
+    vec_t r2 = VecLoad(positions.z + i);
+    vec_t r3 = VecOne();
+    VecTranspose(r0, r1, r2, r3);
+    out[0].r[3] = r0; out[1].r[3] = r1; 
+    out[2].r[3] = r2; out[3].r[3] = r3;
+}
+
+// batch version of Matrix4::PositionRotationScale
+inline void ComposeTRS(Matrix4* out, const Vector3SoA& positions, const QuaternionSoA& rotations, const Vector3SoA& scales, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        ComposeTRS4(out + i, positions, rotations, scales, i);
+
+    int remaining = count - i;
+    if (remaining == 0) return;
+    
+    float p[3][4] = {}, q[4][4] = {}, s[3][4] = {};
+    for (int j = 0; j < 4; j++) { q[3][j] = 1.0f; s[0][j] = s[1][j] = s[2][j] = 1.0f; }
+    for (int j = 0; j < remaining; j++)
+    {
+        p[0][j] = positions.x[i + j]; p[1][j] = positions.y[i + j]; p[2][j] = positions.z[i + j];
+        q[0][j] = rotations.x[i + j]; q[1][j] = rotations.y[i + j];
+        q[2][j] = rotations.z[i + j]; q[3][j] = rotations.w[i + j];
+        s[0][j] = scales.x[i + j]; s[1][j] = scales.y[i + j]; s[2][j] = scales.z[i + j];
+    }
+    Matrix4 tmp[4];
+    ComposeTRS4(tmp, { p[0], p[1], p[2] }, { q[0], q[1], q[2], q[3] }, { s[0], s[1], s[2] }, 0);
+    for (int j = 0; j < remaining; j++)
+        out[i + j] = tmp[j];
+}
+
+inline void DecomposeTRS4(const Vector3SoA& positions, const QuaternionSoA& rotations, const Vector3SoA& scales, const Matrix4* in, int i)
+{
+    vec_t m[4][4];
+    for (int j = 0; j < 4; j++)
+    {
+        m[j][0] = in[0].r[j]; m[j][1] = in[1].r[j];
+        m[j][2] = in[2].r[j]; m[j][3] = in[3].r[j];
+        VecTranspose(m[j][0], m[j][1], m[j][2], m[j][3]);
+    }
+    
+    const vec_t one = VecOne();
+    float* scaleOut[3] = { scales.x + i, scales.y + i, scales.z + i };
+    for (int j = 0; j < 3; j++)
+    {
+        vec_t lenSq = VecMul(m[j][0], m[j][0]);
+        lenSq = VecFmadd(m[j][1], m[j][1], lenSq);
+        lenSq = VecFmadd(m[j][2], m[j][2], lenSq);
+        vec_t len = VecSqrt(lenSq);
+        VecStoreU(scaleOut[j], len);
+        // remove the scale from rotation, avoid divide by zero like InverseTransform
+        vec_t rLen = VecSelect(VecDiv(one, len), one, VecCmpLt(lenSq, VecSet1(1.e-8f)));
+        m[j][0] = VecMul(m[j][0], rLen);
+        m[j][1] = VecMul(m[j][1], rLen);
+        m[j][2] = VecMul(m[j][2], rLen);
+    }
+    
+    const vec_t rot[3][3] = {
+        { m[0][0], m[0][1], m[0][2] },
+        { m[1][0], m[1][1], m[1][2] },
+        { m[2][0], m[2][1], m[2][2] }
+    };
+    vec_t q[4];
+    QuaternionFromMatrixSoA(q, rot);
+    VecStoreU(rotations.x + i, q[0]);
+    VecStoreU(rotations.y + i, q[1]);
+    VecStoreU(rotations.z + i, q[2]);
+    VecStoreU(rotations.w + i, q[3]);
+    
+    VecStoreU(positions.x + i, m[3][0]);
+    VecStoreU(positions.y + i, m[3][1]);
+    VecStoreU(positions.z + i, m[3][2]);
+}
+
+// batch version of ExtractPosition, ExtractRotation and ExtractScale.
+// rotation is extracted after removing the scale from the matrix
+inline void DecomposeTRS(const Vector3SoA& positions, const QuaternionSoA& rotations, const Vector3SoA& scales, const Matrix4* in, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        DecomposeTRS4(positions, rotations, scales, in + i, i);
+    
+    int remaining = count - i;
+    if (remaining == 0) return;
+    
+    Matrix4 tmp[4] = { Matrix4::Identity(), Matrix4::Identity(), Matrix4::Identity(), Matrix4::Identity() };
+    for (int j = 0; j < remaining; j++)
+        tmp[j] = in[i + j];
+    
+    float p[3][4], q[4][4], s[3][4];
+    DecomposeTRS4({ p[0], p[1], p[2] }, { q[0], q[1], q[2], q[3] }, { s[0], s[1], s[2] }, tmp, 0);
+    for (int j = 0; j < remaining; j++)
+    {
+        positions.x[i + j] = p[0][j]; positions.y[i + j] = p[1][j]; positions.z[i + j] = p[2][j];
+        rotations.x[i + j] = q[0][j]; rotations.y[i + j] = q[1][j];
+        rotations.z[i + j] = q[2][j]; rotations.w[i + j] = q[3][j];
+        scales.x[i + j] = s[0][j]; scales.y[i + j] = s[1][j]; scales.z[i + j] = s[2][j];
+    }
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Matrix4x8                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// 8 Matrix4's interleaved, m[i][j] holds the element (i, j) of 8 matrices in one register.
+// Matrix4 vectorizes within one matrix and needs lane splats, this vectorizes across matrices
+// so multiply, inverse and transform doesn't need any shuffle or horizontal operation.
+// use Pack/Unpack to convert from/to Matrix4 arrays
+struct Matrix4x8
+{
+    vec8_t m[4][4];
+    
+    // same semantics as Matrix4
+    Matrix4x8 operator * (const Matrix4x8& M) const { return Multiply(M, *this); }
+    
+    // loads 8 matrices
+    static Matrix4x8 Pack(const Matrix4* in)
+    {
+        Matrix4x8 out;
+        for (int i = 0; i < 4; i++)
+        {
+            vec_t a0 = in[0].r[i], a1 = in[1].r[i], a2 = in[2].r[i], a3 = in[3].r[i];
+            vec_t b0 = in[4].r[i], b1 = in[5].r[i], b2 = in[6].r[i], b3 = in[7].r[i];
+            VecTranspose(a0, a1, a2, a3);
+            VecTranspose(b0, b1, b2, b3);
+            out.m[i][0] = Vec8FromVec4(a0, b0);
+            out.m[i][1] = Vec8FromVec4(a1, b1);
+            out.m[i][2] = Vec8FromVec4(a2, b2);
+            out.m[i][3] = Vec8FromVec4(a3, b3);
+        }
+        return out;
+    }
+    
+    // stores 8 matrices
+    static void Unpack(Matrix4* out, const Matrix4x8& M)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            vec_t a0 = Vec8Low(M.m[i][0]),  a1 = Vec8Low(M.m[i][1]),  a2 = Vec8Low(M.m[i][2]),  a3 = Vec8Low(M.m[i][3]);
+            vec_t b0 = Vec8High(M.m[i][0]), b1 = Vec8High(M.m[i][1]), b2 = Vec8High(M.m[i][2]), b3 = Vec8High(M.m[i][3]);
+            VecTranspose(a0, a1, a2, a3);
+            VecTranspose(b0, b1, b2, b3);
+            out[0].r[i] = a0; out[1].r[i] = a1; out[2].r[i] = a2; out[3].r[i] = a3;
+            out[4].r[i] = b0; out[5].r[i] = b1; out[6].r[i] = b2; out[7].r[i] = b3;
+        }
+    }
+    
+    static Matrix4x8 Identity()
+    {
+        Matrix4x8 M;
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++)
+                M.m[i][j] = Vec8Set1(i == j ? 1.0f : 0.0f);
+        return M;
+    }
+    
+    // same semantics as Matrix4::Multiply, row i of result is row i of in2 transformed by in1
+    static Matrix4x8 Multiply(const Matrix4x8& in1, const Matrix4x8& in2)
+    {
+        Matrix4x8 out;
+        for (int i = 0; i < 4; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                vec8_t m0 = Vec8Mul(in2.m[i][0], in1.m[0][j]);
+                m0 = Vec8Fmadd(in2.m[i][1], in1.m[1][j], m0);
+                m0 = Vec8Fmadd(in2.m[i][2], in1.m[2][j], m0);
+                m0 = Vec8Fmadd(in2.m[i][3], in1.m[3][j], m0);
+                out.m[i][j] = m0;
+            }
+        }
+        return out;
+    }
+    
+    static Matrix4x8 Transpose(const Matrix4x8& M)
+    {
+        Matrix4x8 out;
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++)
+                out.m[i][j] = M.m[j][i];
+        return out;
+    }
+    
+    // general inverse with 2x2 sub determinants (Laplace expansion),
+    // https://www.geometrictools.com/Documentation/LaplaceExpansionTheorem.pdf
+    static Matrix4x8 Inverse(const Matrix4x8& M)
+    {
+        #define AX_M(i, j) M.m[i][j]
+        #define AX_DET2(a, b, c, d) Vec8Fmsub(a, b, Vec8Mul(c, d)) /* a * b - c * d */
+        vec8_t s0 = AX_DET2(AX_M(0, 0), AX_M(1, 1), AX_M(1, 0), AX_M(0, 1));
+        vec8_t s1 = AX_DET2(AX_M(0, 0), AX_M(1, 2), AX_M(1, 0), AX_M(0, 2));
+        vec8_t s2 = AX_DET2(AX_M(0, 0), AX_M(1, 3), AX_M(1, 0), AX_M(0, 3));
+        vec8_t s3 = AX_DET2(AX_M(0, 1), AX_M(1, 2), AX_M(1, 1), AX_M(0, 2));
+        vec8_t s4 = AX_DET2(AX_M(0, 1), AX_M(1, 3), AX_M(1, 1), AX_M(0, 3));
+        vec8_t s5 = AX_DET2(AX_M(0, 2), AX_M(1, 3), AX_M(1, 2), AX_M(0, 3));
+        
+        vec8_t c5 = AX_DET2(AX_M(2, 2), AX_M(3, 3), AX_M(3, 2), AX_M(2, 3));
+        vec8_t c4 = AX_DET2(AX_M(2, 1), AX_M(3, 3), AX_M(3, 1), AX_M(2, 3));
+        vec8_t c3 = AX_DET2(AX_M(2, 1), AX_M(3, 2), AX_M(3, 1), AX_M(2, 2));
+        vec8_t c2 = AX_DET2(AX_M(2, 0), AX_M(3, 3), AX_M(3, 0), AX_M(2, 3));
+        vec8_t c1 = AX_DET2(AX_M(2, 0), AX_M(3, 2), AX_M(3, 0), AX_M(2, 2));
+        vec8_t c0 = AX_DET2(AX_M(2, 0), AX_M(3, 1), AX_M(3, 0), AX_M(2, 1));
+        
+        // det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0
+        vec8_t det = Vec8Mul(s0, c5);
+        det = Vec8Sub(det, Vec8Mul(s1, c4));
+        det = Vec8Fmadd(s2, c3, det);
+        det = Vec8Fmadd(s3, c2, det);
+        det = Vec8Sub(det, Vec8Mul(s4, c1));
+        det = Vec8Fmadd(s5, c0, det);
+        vec8_t invDet = Vec8Div(Vec8One(), det);
+        vec8_t negInvDet = Vec8Neg(invDet);
+        
+        // a * x - b * y + c * z
+        #define AX_COF(a, x, b, y, c, z, d) Vec8Mul(Vec8Fmadd(c, z, AX_DET2(a, x, b, y)), d)
+        Matrix4x8 out;
+        out.m[0][0] = AX_COF(AX_M(1, 1), c5, AX_M(1, 2), c4, AX_M(1, 3), c3, invDet);
+        out.m[0][1] = AX_COF(AX_M(0, 1), c5, AX_M(0, 2), c4, AX_M(0, 3), c3, negInvDet);
+        out.m[0][2] = AX_COF(AX_M(3, 1), s5, AX_M(3, 2), s4, AX_M(3, 3), s3, invDet);
+        out.m[0][3] = AX_COF(AX_M(2, 1), s5, AX_M(2, 2), s4, AX_M(2, 3), s3, negInvDet);
+        
+        out.m[1][0] = AX_COF(AX_M(1, 0), c5, AX_M(1, 2), c2, AX_M(1, 3), c1, negInvDet);
+        out.m[1][1] = AX_COF(AX_M(0, 0), c5, AX_M(0, 2), c2, AX_M(0, 3), c1, invDet);
+        out.m[1][2] = AX_COF(AX_M(3, 0), s5, AX_M(3, 2), s2, AX_M(3, 3), s1, negInvDet);
+        out.m[1][3] = AX_COF(AX_M(2, 0), s5, AX_M(2, 2), s2, AX_M(2, 3), s1, invDet);
+        
+        out.m[2][0] = AX_COF(AX_M(1, 0), c4, AX_M(1, 1), c2, AX_M(1, 3), c0, invDet);
+        out.m[2][1] = AX_COF(AX_M(0, 0), c4, AX_M(0, 1), c2, AX_M(0, 3), c0, negInvDet);
+        out.m[2][2] = AX_COF(AX_M(3, 0), s4, AX_M(3, 1), s2, AX_M(3, 3), s0, invDet);
+        out.m[2][3] = AX_COF(AX_M(2, 0), s4, AX_M(2, 1), s2, AX_M(2, 3), s0, negInvDet);
+        
+        out.m[3][0] = AX_COF(AX_M(1, 0), c3, AX_M(1, 1), c1, AX_M(1, 2), c0, negInvDet);
+        out.m[3][1] = AX_COF(AX_M(0, 0), c3, AX_M(0, 1), c1, AX_M(0, 2), c0, invDet);
+        out.m[3][2] = AX_COF(AX_M(3, 0), s3, AX_M(3, 1), s1, AX_M(3, 2), s0, negInvDet);
+        out.m[3][3] = AX_COF(AX_M(2, 0), s3, AX_M(2, 1), s1, AX_M(2, 2), s0, invDet);
+        #undef AX_COF
+        #undef AX_DET2
+        #undef AX_M
+        return out;
+    }
+    
+    // same as Vector3Transform, transforms 8 points with 8 matrices, w is 1
+    static void TransformPoint(const Matrix4x8& M, vec8_t& x, vec8_t& y, vec8_t& z)
+    {
+        vec8_t ox = Vec8Fmadd(x, M.m[0][0], M.m[3][0]);
+        vec8_t oy = Vec8Fmadd(x, M.m[0][1], M.m[3][1]);
+        vec8_t oz = Vec8Fmadd(x, M.m[0][2], M.m[3][2]);
+        ox = Vec8Fmadd(y, M.m[1][0], ox);
+        oy = Vec8Fmadd(y, M.m[1][1], oy);
+        oz = Vec8Fmadd(y, M.m[1][2], oz);
+        x  = Vec8Fmadd(z, M.m[2][0], ox);
+        y  = Vec8Fmadd(z, M.m[2][1], oy);
+        z  = Vec8Fmadd(z, M.m[2][2], oz);
+    }
+    
+    // same as Vector4Transform
+    static void Transform(const Matrix4x8& M, vec8_t& x, vec8_t& y, vec8_t& z, vec8_t& w)
+    {
+        vec8_t o[4];
+        for (int j = 0; j < 4; j++)
+        {
+            o[j] = Vec8Mul(x, M.m[0][j]);
+            o[j] = Vec8Fmadd(y, M.m[1][j], o[j]);
+            o[j] = Vec8Fmadd(z, M.m[2][j], o[j]);
+            o[j] = Vec8Fmadd(w, M.m[3][j], o[j]);
+        }
+        x = o[0]; y = o[1]; z = o[2]; w = o[3];
+    }
+
+    // same as Matrix4::ExtractRotation, branchless. scale is not removed so rows has to be normalized
+    static void ExtractRotation(vec8_t q[4], const Matrix4x8& M)
+    {
+        const vec8_t rot[3][3] = {
+            { M.m[0][0], M.m[0][1], M.m[0][2] },
+            { M.m[1][0], M.m[1][1], M.m[1][2] },
+            { M.m[2][0], M.m[2][1], M.m[2][2] }
+        };
+        QuaternionFromMatrixSoA8(q, rot);
+    }
+};
+
+// converts Matrix4 array to packets, last packet is padded with identity matrices
+inline void PackMatrix4x8(Matrix4x8* out, const Matrix4* in, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        *out++ = Matrix4x8::Pack(in + i);
+    
+    if (i == count) return;
+    Matrix4 tmp[8];
+    for (int j = 0; j < 8; j++)
+        tmp[j] = i + j < count ? in[i + j] : Matrix4::Identity();
+    *out = Matrix4x8::Pack(tmp);
+}
+
+// count is number of matrices, not packets
+inline void UnpackMatrix4x8(Matrix4* out, const Matrix4x8* in, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        Matrix4x8::Unpack(out + i, *in++);
+    
+    if (i == count) return;
+    Matrix4 tmp[8];
+    Matrix4x8::Unpack(tmp, *in);
+    for (int j = 0; i + j < count; j++)
+        out[i + j] = tmp[j];
+}
+
+// out[i] = Multiply(a[i], b[i]), 8 matrices at a time
+inline void MultiplyMatrix4Array(Matrix4* out, const Matrix4* a, const Matrix4* b, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        int n = MIN(count - i, 8);
+        Matrix4x8 pa, pb;
+        PackMatrix4x8(&pa, a + i, n);
+        PackMatrix4x8(&pb, b + i, n);
+        Matrix4x8 res = Matrix4x8::Multiply(pa, pb);
+        UnpackMatrix4x8(out + i, &res, n);
+    }
+}
+
+// out[i] = Inverse(in[i]), 8 matrices at a time
+inline void InverseMatrix4Array(Matrix4* out, const Matrix4* in, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        int n = MIN(count - i, 8);
+        Matrix4x8 p;
+        PackMatrix4x8(&p, in + i, n);
+        p = Matrix4x8::Inverse(p);
+        UnpackMatrix4x8(out + i, &p, n);
+    }
+}
+
+// writes 8 quaternions from SoA registers, only first n are written
+inline void StoreQuaternion8(const QuaternionSoA& out, const vec8_t q[4], int i, int n)
+{
+    float* dst[4] = { out.x + i, out.y + i, out.z + i, out.w + i };
+    for (int c = 0; c < 4; c++)
+    {
+        if (n == 8) { Vec8StoreU(dst[c], q[c]); continue; }
+        float tmp[8];
+        Vec8StoreU(tmp, q[c]);
+        for (int j = 0; j < n; j++) dst[c][j] = tmp[j];
+    }
+}
+
+// out[i] = Matrix4::ExtractRotation(in[i]), 8 matrices at a time without branches
+inline void ExtractRotationArray(const QuaternionSoA& out, const Matrix4* in, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        int n = MIN(count - i, 8);
+        Matrix4x8 p;
+        PackMatrix4x8(&p, in + i, n);
+        vec8_t q[4];
+        Matrix4x8::ExtractRotation(q, p);
+        StoreQuaternion8(out, q, i, n);
+    }
+}
+
+// out[i] = in[i].ToQuaternion(), 8 matrices at a time without branches
+inline void QuaternionFromMatrix3Array(const QuaternionSoA& out, const Matrix3* in, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        int n = MIN(count - i, 8);
+        float e[3][3][8]; // element (r, c) of 8 matrices, padded with identity
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                for (int j = 0; j < 8; j++)
+                    e[r][c][j] = j < n ? in[i + j].m[r][c] : float(r == c);
+
+        vec8_t m[3][3];
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                m[r][c] = Vec8Load(e[r][c]);
+
+        vec8_t q[4];
+        QuaternionFromMatrixSoA8(q, m);
+        StoreQuaternion8(out, q, i, n);
+    }
+}
  
 struct FrustumPlanes
 {
@@ -712,6 +1125,16 @@ inline FrustumPlanes CreateFrustumPlanes(const Matrix4& viewProjection)
     return result;
 }
 
+// planes with unit normals, distances to planes are in world units. required for sphere and cone culling,
+// aabb culling works with both
+inline FrustumPlanes CreateFrustumPlanesNormalized(const Matrix4& viewProjection)
+{
+    FrustumPlanes result = CreateFrustumPlanes(viewProjection);
+    for (int i = 0; i < 5; i++)
+        result.planes[i] = VecMul(result.planes[i], VecSet1(1.0f / Sqrt(Vec3Dotf(result.planes[i], result.planes[i]))));
+    return result;
+}
+
 purefn vec_t VECTORCALL MaxPointAlongNormal(vec_t min, vec_t max, vec_t n) 
 {
     return VecSelect(min, max, VecCmpGe(n, VecZero()));
@@ -728,6 +1151,31 @@ inline bool VECTORCALL CheckAABBCulled(vec_t min, vec_t max, const FrustumPlanes
     return true;
 }
 
+// returns true if the sphere is inside or intersecting the frustum, planes has to be normalized
+inline bool VECTORCALL CheckSphereCulled(vec_t center, float radius, const FrustumPlanes& frustum)
+{
+    center = VecSelect(VecOne(), center, VecSelect1110);
+    for (uint i = 0u; i < 5u; ++i) // make < 6 if you want far plane 
+        if (VecDotf(frustum.planes[i], center) < -radius) return false;
+    return true;
+}
+
+// cone with apex, unit direction, height and radius of the base. returns true if it is inside or
+// intersecting the frustum, planes has to be normalized
+inline bool VECTORCALL CheckConeCulled(vec_t apex, vec_t direction, float height, float radius, const FrustumPlanes& frustum)
+{
+    apex = VecSelect(VecOne(), apex, VecSelect1110);
+    for (uint i = 0u; i < 5u; ++i) // make < 6 if you want far plane 
+    {
+        float apexDist = VecDotf(frustum.planes[i], apex);
+        float nd = Vec3Dotf(frustum.planes[i], direction);
+        // farthest point of the base circle along the plane normal
+        float baseDist = apexDist + nd * height + radius * Sqrt(MAX(1.0f - nd * nd, 0.0f));
+        if (apexDist < 0.0f && baseDist < 0.0f) return false;
+    }
+    return true;
+}
+
 inline bool isPointCulled(const FrustumPlanes& frustum, const Vector3f& _point, const Matrix4& matrix)
 {
     vec_t point = Vector3Transform(VecLoad(&_point.x), matrix.r);
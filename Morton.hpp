@@ -0,0 +1,400 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Morton (Z-order) and Hilbert curve encode and decode      *
+*      for Vector2i, Vector3i and quantized points in a box.     *
+*      sorting by these keys keeps nearby points close in        *
+*      memory, use them for particles, voxels and BVH builds.    *
+*   Be Aware:                                                    *
+*      coordinates are treated as unsigned, bias negative ones.  *
+*      64 bit keys: 2D uses 32 bit per axis, 3D 21 bit per axis  *
+*      32 bit keys: 2D uses 16 bit per axis, 3D 10 bit per axis  *
+*      pdep/pext is microcoded on AMD before Zen3, define        *
+*      AX_NO_BMI2 if you are targeting those cpus.               *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+#if defined(AX_SUPPORT_BMI2)
+    #include <immintrin.h>
+#endif
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Bit Spreading                               */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// x axis is at bit 0, y at bit 1 and z at bit 2
+constexpr uint64 MortonMask2X = 0x5555555555555555ull;
+constexpr uint64 MortonMask3X = 0x1249249249249249ull;
+
+// inserts one zero bit between the low 32 bits
+pureconst uint64 MortonSpread2(uint64 x)
+{
+    x &= 0x00000000FFFFFFFFull;
+    x = (x | (x << 16ull)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8ull))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4ull))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2ull))  & 0x3333333333333333ull;
+    x = (x | (x << 1ull))  & 0x5555555555555555ull;
+    return x;
+}
+
+pureconst uint64 MortonCompact2(uint64 x)
+{
+    x &= 0x5555555555555555ull;
+    x = (x ^ (x >> 1ull))  & 0x3333333333333333ull;
+    x = (x ^ (x >> 2ull))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x ^ (x >> 4ull))  & 0x00FF00FF00FF00FFull;
+    x = (x ^ (x >> 8ull))  & 0x0000FFFF0000FFFFull;
+    x = (x ^ (x >> 16ull)) & 0x00000000FFFFFFFFull;
+    return x;
+}
+
+// inserts two zero bits between the low 21 bits
+pureconst uint64 MortonSpread3(uint64 x)
+{
+    x &= 0x1FFFFFull;
+    x = (x | (x << 32ull)) & 0x001F00000000FFFFull;
+    x = (x | (x << 16ull)) & 0x001F0000FF0000FFull;
+    x = (x | (x << 8ull))  & 0x100F00F00F00F00Full;
+    x = (x | (x << 4ull))  & 0x10C30C30C30C30C3ull;
+    x = (x | (x << 2ull))  & 0x1249249249249249ull;
+    return x;
+}
+
+pureconst uint64 MortonCompact3(uint64 x)
+{
+    x &= 0x1249249249249249ull;
+    x = (x ^ (x >> 2ull))  & 0x10C30C30C30C30C3ull;
+    x = (x ^ (x >> 4ull))  & 0x100F00F00F00F00Full;
+    x = (x ^ (x >> 8ull))  & 0x001F0000FF0000FFull;
+    x = (x ^ (x >> 16ull)) & 0x001F00000000FFFFull;
+    x = (x ^ (x >> 32ull)) & 0x1FFFFFull;
+    return x;
+}
+
+pureconst uint32 MortonSpread2_32(uint32 x)
+{
+    x &= 0x0000FFFFu;
+    x = (x | (x << 8u)) & 0x00FF00FFu;
+    x = (x | (x << 4u)) & 0x0F0F0F0Fu;
+    x = (x | (x << 2u)) & 0x33333333u;
+    x = (x | (x << 1u)) & 0x55555555u;
+    return x;
+}
+
+pureconst uint32 MortonCompact2_32(uint32 x)
+{
+    x &= 0x55555555u;
+    x = (x ^ (x >> 1u)) & 0x33333333u;
+    x = (x ^ (x >> 2u)) & 0x0F0F0F0Fu;
+    x = (x ^ (x >> 4u)) & 0x00FF00FFu;
+    x = (x ^ (x >> 8u)) & 0x0000FFFFu;
+    return x;
+}
+
+pureconst uint32 MortonSpread3_32(uint32 x)
+{
+    x &= 0x000003FFu;
+    x = (x | (x << 16u)) & 0x030000FFu;
+    x = (x | (x << 8u))  & 0x0300F00Fu;
+    x = (x | (x << 4u))  & 0x030C30C3u;
+    x = (x | (x << 2u))  & 0x09249249u;
+    return x;
+}
+
+pureconst uint32 MortonCompact3_32(uint32 x)
+{
+    x &= 0x09249249u;
+    x = (x ^ (x >> 2u))  & 0x030C30C3u;
+    x = (x ^ (x >> 4u))  & 0x0300F00Fu;
+    x = (x ^ (x >> 8u))  & 0xFF0000FFu;
+    x = (x ^ (x >> 16u)) & 0x000003FFu;
+    return x;
+}
+
+// same magic numbers on integer lanes, 4, 8 or 16 keys at a time
+template<int N>
+purefn BatchMask<N> MortonSpread2_32(BatchMask<N> x)
+{
+    typedef BatchMask<N> I;
+    x = x & I::Set1(0x0000FFFF);
+    x = (x | (x << 8)) & I::Set1(0x00FF00FF);
+    x = (x | (x << 4)) & I::Set1(0x0F0F0F0F);
+    x = (x | (x << 2)) & I::Set1(0x33333333);
+    x = (x | (x << 1)) & I::Set1(0x55555555);
+    return x;
+}
+
+template<int N>
+purefn BatchMask<N> MortonSpread3_32(BatchMask<N> x)
+{
+    typedef BatchMask<N> I;
+    x = x & I::Set1(0x000003FF);
+    x = (x | (x << 16)) & I::Set1(0x030000FF);
+    x = (x | (x << 8))  & I::Set1(0x0300F00F);
+    x = (x | (x << 4))  & I::Set1(0x030C30C3);
+    x = (x | (x << 2))  & I::Set1(0x09249249);
+    return x;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Morton                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+#if defined(AX_SUPPORT_BMI2)
+
+purefn uint64 MortonEncode(Vector2i v) {
+    return _pdep_u64(uint32(v.x), MortonMask2X) | _pdep_u64(uint32(v.y), MortonMask2X << 1ull);
+}
+
+purefn uint64 MortonEncode(Vector3i v) {
+    return _pdep_u64(uint32(v.x), MortonMask3X) | _pdep_u64(uint32(v.y), MortonMask3X << 1ull) | _pdep_u64(uint32(v.z), MortonMask3X << 2ull);
+}
+
+purefn Vector2i MortonDecode2(uint64 code) {
+    return { (int)_pext_u64(code, MortonMask2X), (int)_pext_u64(code, MortonMask2X << 1ull) };
+}
+
+purefn Vector3i MortonDecode3(uint64 code) {
+    return { (int)_pext_u64(code, MortonMask3X), (int)_pext_u64(code, MortonMask3X << 1ull), (int)_pext_u64(code, MortonMask3X << 2ull) };
+}
+
+#else
+
+purefn uint64 MortonEncode(Vector2i v) {
+    return MortonSpread2(uint32(v.x)) | (MortonSpread2(uint32(v.y)) << 1ull);
+}
+
+purefn uint64 MortonEncode(Vector3i v) {
+    return MortonSpread3(uint32(v.x)) | (MortonSpread3(uint32(v.y)) << 1ull) | (MortonSpread3(uint32(v.z)) << 2ull);
+}
+
+purefn Vector2i MortonDecode2(uint64 code) {
+    return { (int)MortonCompact2(code), (int)MortonCompact2(code >> 1ull) };
+}
+
+purefn Vector3i MortonDecode3(uint64 code) {
+    return { (int)MortonCompact3(code), (int)MortonCompact3(code >> 1ull), (int)MortonCompact3(code >> 2ull) };
+}
+
+#endif
+
+// 32 bit keys, magic numbers are faster than pdep for these on most cpus
+purefn uint32 MortonEncode32(Vector2i v) {
+    return MortonSpread2_32(uint32(v.x)) | (MortonSpread2_32(uint32(v.y)) << 1u);
+}
+
+purefn uint32 MortonEncode32(Vector3i v) {
+    return MortonSpread3_32(uint32(v.x)) | (MortonSpread3_32(uint32(v.y)) << 1u) | (MortonSpread3_32(uint32(v.z)) << 2u);
+}
+
+purefn Vector2i MortonDecode2_32(uint32 code) {
+    return { (int)MortonCompact2_32(code), (int)MortonCompact2_32(code >> 1u) };
+}
+
+purefn Vector3i MortonDecode3_32(uint32 code) {
+    return { (int)MortonCompact3_32(code), (int)MortonCompact3_32(code >> 1u), (int)MortonCompact3_32(code >> 2u) };
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Hilbert                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// John Skilling, Programming the Hilbert curve, 2004.
+// axes are transposed in place, then Morton interleaving of the transpose gives the index.
+// order is number of bits per axis: at most 32 for 2D and 21 for 3D
+
+template<int Dim>
+inline void HilbertAxesToTranspose(uint32* X, int order)
+{
+    uint32 M = 1u << (order - 1), P, t;
+    // inverse undo
+    for (uint32 Q = M; Q > 1; Q >>= 1)
+    {
+        P = Q - 1;
+        for (int i = 0; i < Dim; i++)
+        {
+            if (X[i] & Q) { X[0] ^= P; }
+            else { t = (X[0] ^ X[i]) & P; X[0] ^= t; X[i] ^= t; }
+        }
+    }
+    // gray encode
+    for (int i = 1; i < Dim; i++) X[i] ^= X[i - 1];
+    t = 0;
+    for (uint32 Q = M; Q > 1; Q >>= 1)
+        if (X[Dim - 1] & Q) t ^= Q - 1;
+    for (int i = 0; i < Dim; i++) X[i] ^= t;
+}
+
+template<int Dim>
+inline void HilbertTransposeToAxes(uint32* X, int order)
+{
+    uint32 N = 2ull << (order - 1), P, t;
+    // gray decode
+    t = X[Dim - 1] >> 1;
+    for (int i = Dim - 1; i > 0; i--) X[i] ^= X[i - 1];
+    X[0] ^= t;
+    // undo excess work
+    for (uint32 Q = 2; Q != N; Q <<= 1)
+    {
+        P = Q - 1;
+        for (int i = Dim - 1; i >= 0; i--)
+        {
+            if (X[i] & Q) { X[0] ^= P; }
+            else { t = (X[0] ^ X[i]) & P; X[0] ^= t; X[i] ^= t; }
+        }
+    }
+}
+
+// first axis of the transpose holds the most significant bit of each group
+purefn uint64 HilbertEncode(Vector2i v, int order = 16)
+{
+    uint32 X[2] = { uint32(v.x), uint32(v.y) };
+    HilbertAxesToTranspose<2>(X, order);
+    return MortonEncode(Vector2i{ (int)X[1], (int)X[0] });
+}
+
+purefn uint64 HilbertEncode(Vector3i v, int order = 10)
+{
+    uint32 X[3] = { uint32(v.x), uint32(v.y), uint32(v.z) };
+    HilbertAxesToTranspose<3>(X, order);
+    return MortonEncode(Vector3i{ (int)X[2], (int)X[1], (int)X[0] });
+}
+
+purefn Vector2i HilbertDecode2(uint64 index, int order = 16)
+{
+    Vector2i t = MortonDecode2(index);
+    uint32 X[2] = { uint32(t.y), uint32(t.x) };
+    HilbertTransposeToAxes<2>(X, order);
+    return { (int)X[0], (int)X[1] };
+}
+
+purefn Vector3i HilbertDecode3(uint64 index, int order = 10)
+{
+    Vector3i t = MortonDecode3(index);
+    uint32 X[3] = { uint32(t.z), uint32(t.y), uint32(t.x) };
+    HilbertTransposeToAxes<3>(X, order);
+    return { (int)X[0], (int)X[1], (int)X[2] };
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                             Quantized Points                             */
+/*//////////////////////////////////////////////////////////////////////////*/
+// points are mapped to [0, 2^bits-1] inside the box, outside points are clamped
+
+purefn Vector3f MortonScale(Vector3f boundsMin, Vector3f boundsMax, float maxCell)
+{
+    Vector3f extent = boundsMax - boundsMin;
+    return { extent.x > 0.0f ? maxCell / extent.x : 0.0f,
+             extent.y > 0.0f ? maxCell / extent.y : 0.0f,
+             extent.z > 0.0f ? maxCell / extent.z : 0.0f };
+}
+
+purefn uint32 MortonQuantize(float x, float boundsMin, float scale, float maxCell)
+{
+    return (uint32)Clamp((x - boundsMin) * scale, 0.0f, maxCell);
+}
+
+// 10 bits per axis
+purefn uint32 MortonEncode32(Vector3f point, Vector3f boundsMin, Vector3f boundsMax)
+{
+    Vector3f scale = MortonScale(boundsMin, boundsMax, 1023.0f);
+    return MortonEncode32(Vector3i{ (int)MortonQuantize(point.x, boundsMin.x, scale.x, 1023.0f),
+                                    (int)MortonQuantize(point.y, boundsMin.y, scale.y, 1023.0f),
+                                    (int)MortonQuantize(point.z, boundsMin.z, scale.z, 1023.0f) });
+}
+
+// 21 bits per axis
+purefn uint64 MortonEncode(Vector3f point, Vector3f boundsMin, Vector3f boundsMax)
+{
+    const float maxCell = float((1 << 21) - 1);
+    Vector3f scale = MortonScale(boundsMin, boundsMax, maxCell);
+    return MortonEncode(Vector3i{ (int)MortonQuantize(point.x, boundsMin.x, scale.x, maxCell),
+                                  (int)MortonQuantize(point.y, boundsMin.y, scale.y, maxCell),
+                                  (int)MortonQuantize(point.z, boundsMin.z, scale.z, maxCell) });
+}
+
+template<int N>
+purefn BatchMask<N> MortonQuantize(Batch<float, N> x, float boundsMin, float scale, float maxCell)
+{
+    typedef Batch<float, N> F;
+    return ToInt(Min(Max((x - F::Set1(boundsMin)) * F::Set1(scale), F::Set1(0.0f)), F::Set1(maxCell)));
+}
+
+template<int N>
+inline int MortonKeyKernel32(uint32* keys, const Vector3SoA& points, Vector3f boundsMin, Vector3f scale, int i, int count)
+{
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> x = MortonQuantize(Batch<float, N>::Load(points.x + i), boundsMin.x, scale.x, 1023.0f);
+        BatchMask<N> y = MortonQuantize(Batch<float, N>::Load(points.y + i), boundsMin.y, scale.y, 1023.0f);
+        BatchMask<N> z = MortonQuantize(Batch<float, N>::Load(points.z + i), boundsMin.z, scale.z, 1023.0f);
+        BatchMask<N> key = MortonSpread3_32(x) | (MortonSpread3_32(y) << 1) | (MortonSpread3_32(z) << 2);
+        key.Store((int32*)keys + i);
+    }
+    return i;
+}
+
+// 30 bit keys of points inside the box
+inline void MortonKeyArray32(uint32* keys, const Vector3SoA& points, Vector3f boundsMin, Vector3f boundsMax, int count)
+{
+    Vector3f scale = MortonScale(boundsMin, boundsMax, 1023.0f);
+    int i = MortonKeyKernel32<AX_BATCH_WIDTH>(keys, points, boundsMin, scale, 0, count);
+    MortonKeyKernel32<1>(keys, points, boundsMin, scale, i, count);
+}
+
+template<int N>
+inline int MortonKeyKernel2D32(uint32* keys, const Vector2SoA& points, Vector2f boundsMin, Vector2f scale, int i, int count)
+{
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> x = MortonQuantize(Batch<float, N>::Load(points.x + i), boundsMin.x, scale.x, 65535.0f);
+        BatchMask<N> y = MortonQuantize(Batch<float, N>::Load(points.y + i), boundsMin.y, scale.y, 65535.0f);
+        (MortonSpread2_32(x) | (MortonSpread2_32(y) << 1)).Store((int32*)keys + i);
+    }
+    return i;
+}
+
+// 32 bit keys of 2D points inside the rectangle
+inline void MortonKeyArray32(uint32* keys, const Vector2SoA& points, Vector2f boundsMin, Vector2f boundsMax, int count)
+{
+    Vector3f scale = MortonScale({ boundsMin.x, boundsMin.y, 0.0f }, { boundsMax.x, boundsMax.y, 0.0f }, 65535.0f);
+    int i = MortonKeyKernel2D32<AX_BATCH_WIDTH>(keys, points, boundsMin, { scale.x, scale.y }, 0, count);
+    MortonKeyKernel2D32<1>(keys, points, boundsMin, { scale.x, scale.y }, i, count);
+}
+
+// 63 bit keys, there is no 64 bit lane support in Batch, uses pdep if available
+inline void MortonKeyArray(uint64* keys, const Vector3SoA& points, Vector3f boundsMin, Vector3f boundsMax, int count)
+{
+    const float maxCell = float((1 << 21) - 1);
+    Vector3f scale = MortonScale(boundsMin, boundsMax, maxCell);
+    for (int i = 0; i < count; i++)
+    {
+        keys[i] = MortonEncode(Vector3i{ (int)MortonQuantize(points.x[i], boundsMin.x, scale.x, maxCell),
+                                         (int)MortonQuantize(points.y[i], boundsMin.y, scale.y, maxCell),
+                                         (int)MortonQuantize(points.z[i], boundsMin.z, scale.z, maxCell) });
+    }
+}
+
+inline void MortonEncodeArray(uint64* codes, const Vector3i* cells, int count)
+{
+    for (int i = 0; i < count; i++) codes[i] = MortonEncode(cells[i]);
+}
+
+inline void MortonDecodeArray(Vector3i* cells, const uint64* codes, int count)
+{
+    for (int i = 0; i < count; i++) cells[i] = MortonDecode3(codes[i]);
+}
+
+inline void HilbertEncodeArray(uint64* codes, const Vector3i* cells, int count, int order = 10)
+{
+    for (int i = 0; i < count; i++) codes[i] = HilbertEncode(cells[i], order);
+}
+
+AX_END_NAMESPACE
@@ -0,0 +1,505 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Value, Perlin and Simplex noise written with              *
+*      Batch<float, N>, evaluates 4, 8 or 16 points per call.    *
+*      fBm, domain warp and array functions for heightfields.    *
+*      scalar versions are width 1 instantiations so they        *
+*      match SIMD versions, except fma rounding differences.     *
+*   Be Aware:                                                    *
+*      results are approximately in [-1, 1] range.               *
+*      corners are hashed with integer math instead of           *
+*      permutation tables, so there are no gathers and           *
+*      different seeds gives different noise.                    *
+*      4D noise is only available as simplex noise.              *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Helpers                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// coordinates are multiplied with these primes, neighbour cell hash is a single add
+constexpr int32 NoisePrimeX = 501125321;
+constexpr int32 NoisePrimeY = 1136930381;
+constexpr int32 NoisePrimeZ = 1720413743;
+constexpr int32 NoisePrimeW = 1066037191;
+
+template<int N>
+purefn BatchMask<N> NoiseMix(BatchMask<N> h)
+{
+    typedef BatchMask<N> I;
+    h = h ^ ShiftRightLogical(h, 15);
+    h = h * I::Set1(0x2c1b3c6d);
+    h = h ^ ShiftRightLogical(h, 12);
+    h = h * I::Set1(0x297a2d39);
+    return h ^ ShiftRightLogical(h, 15);
+}
+
+// flips sign of x if bit at index is set in h
+template<int N>
+purefn Batch<float, N> NoiseNegateIf(Batch<float, N> x, BatchMask<N> h, int index)
+{
+    return AsFloat(AsInt(x) ^ ((h >> index) << 31));
+}
+
+template<int N>
+purefn Batch<float, N> NoiseLerp(Batch<float, N> a, Batch<float, N> b, Batch<float, N> t)
+{
+    return Fmadd(b - a, t, a);
+}
+
+// 6t^5 - 15t^4 + 10t^3
+template<int N>
+purefn Batch<float, N> NoiseFade(Batch<float, N> t)
+{
+    typedef Batch<float, N> F;
+    return t * t * t * Fmadd(t, Fmadd(t, F::Set1(6.0f), F::Set1(-15.0f)), F::Set1(10.0f));
+}
+
+// hash to [-1, 1]
+template<int N>
+purefn Batch<float, N> NoiseValue(BatchMask<N> h)
+{
+    return ToFloat(h) * Batch<float, N>::Set1(1.0f / 2147483648.0f);
+}
+
+template<int N>
+purefn Batch<float, N> NoiseGrad2(BatchMask<N> h, Batch<float, N> x, Batch<float, N> y)
+{
+    typedef BatchMask<N> I;
+    I m = (h & I::Set1(7)) < I::Set1(4);
+    Batch<float, N> u = Select(y, x, m);
+    Batch<float, N> v = Select(x, y, m);
+    return NoiseNegateIf(u, h, 0) + NoiseNegateIf(v + v, h, 1);
+}
+
+// Ken Perlin's 12 edge gradients, with 4 of them repeated
+template<int N>
+purefn Batch<float, N> NoiseGrad3(BatchMask<N> h, Batch<float, N> x, Batch<float, N> y, Batch<float, N> z)
+{
+    typedef BatchMask<N> I;
+    I hb = h & I::Set1(15);
+    Batch<float, N> u = Select(y, x, hb < I::Set1(8));
+    Batch<float, N> v = Select(Select(z, x, (hb == I::Set1(12)) | (hb == I::Set1(14))), y, hb < I::Set1(4));
+    return NoiseNegateIf(u, h, 0) + NoiseNegateIf(v, h, 1);
+}
+
+template<int N>
+purefn Batch<float, N> NoiseGrad4(BatchMask<N> h, Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, Batch<float, N> w)
+{
+    typedef BatchMask<N> I;
+    I hb = h & I::Set1(31);
+    Batch<float, N> u = Select(y, x, hb < I::Set1(24));
+    Batch<float, N> v = Select(z, y, hb < I::Set1(16));
+    Batch<float, N> t = Select(w, z, hb < I::Set1(8));
+    return NoiseNegateIf(u, h, 0) + NoiseNegateIf(v, h, 1) + NoiseNegateIf(t, h, 2);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                             Value & Perlin                               */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+purefn Batch<float, N> ValueNoise2(Batch<float, N> x, Batch<float, N> y, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    F fx = Floor(x), fy = Floor(y);
+    I px0 = ToInt(fx) * I::Set1(NoisePrimeX), px1 = px0 + I::Set1(NoisePrimeX);
+    I py0 = ToInt(fy) * I::Set1(NoisePrimeY), py1 = py0 + I::Set1(NoisePrimeY);
+    py0 = py0 ^ I::Set1(seed);
+    py1 = py1 ^ I::Set1(seed);
+    F u = NoiseFade(x - fx), v = NoiseFade(y - fy);
+
+    F a = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py0)), NoiseValue(NoiseMix(px1 ^ py0)), u);
+    F b = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py1)), NoiseValue(NoiseMix(px1 ^ py1)), u);
+    return NoiseLerp(a, b, v);
+}
+
+template<int N>
+purefn Batch<float, N> ValueNoise3(Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    F fx = Floor(x), fy = Floor(y), fz = Floor(z);
+    I px0 = ToInt(fx) * I::Set1(NoisePrimeX), px1 = px0 + I::Set1(NoisePrimeX);
+    I py0 = ToInt(fy) * I::Set1(NoisePrimeY), py1 = py0 + I::Set1(NoisePrimeY);
+    I pz0 = ToInt(fz) * I::Set1(NoisePrimeZ), pz1 = pz0 + I::Set1(NoisePrimeZ);
+    pz0 = pz0 ^ I::Set1(seed);
+    pz1 = pz1 ^ I::Set1(seed);
+    F u = NoiseFade(x - fx), v = NoiseFade(y - fy), w = NoiseFade(z - fz);
+
+    F a = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py0 ^ pz0)), NoiseValue(NoiseMix(px1 ^ py0 ^ pz0)), u);
+    F b = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py1 ^ pz0)), NoiseValue(NoiseMix(px1 ^ py1 ^ pz0)), u);
+    F c = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py0 ^ pz1)), NoiseValue(NoiseMix(px1 ^ py0 ^ pz1)), u);
+    F d = NoiseLerp(NoiseValue(NoiseMix(px0 ^ py1 ^ pz1)), NoiseValue(NoiseMix(px1 ^ py1 ^ pz1)), u);
+    return NoiseLerp(NoiseLerp(a, b, v), NoiseLerp(c, d, v), w);
+}
+
+template<int N>
+purefn Batch<float, N> Perlin2(Batch<float, N> x, Batch<float, N> y, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    F fx = Floor(x), fy = Floor(y);
+    I px0 = ToInt(fx) * I::Set1(NoisePrimeX), px1 = px0 + I::Set1(NoisePrimeX);
+    I py0 = ToInt(fy) * I::Set1(NoisePrimeY), py1 = py0 + I::Set1(NoisePrimeY);
+    py0 = py0 ^ I::Set1(seed);
+    py1 = py1 ^ I::Set1(seed);
+    F x0 = x - fx, y0 = y - fy;
+    F x1 = x0 - F::Set1(1.0f), y1 = y0 - F::Set1(1.0f);
+    F u = NoiseFade(x0), v = NoiseFade(y0);
+
+    F a = NoiseLerp(NoiseGrad2(NoiseMix(px0 ^ py0), x0, y0), NoiseGrad2(NoiseMix(px1 ^ py0), x1, y0), u);
+    F b = NoiseLerp(NoiseGrad2(NoiseMix(px0 ^ py1), x0, y1), NoiseGrad2(NoiseMix(px1 ^ py1), x1, y1), u);
+    return F::Set1(0.507f) * NoiseLerp(a, b, v);
+}
+
+template<int N>
+purefn Batch<float, N> Perlin3(Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    F fx = Floor(x), fy = Floor(y), fz = Floor(z);
+    I px0 = ToInt(fx) * I::Set1(NoisePrimeX), px1 = px0 + I::Set1(NoisePrimeX);
+    I py0 = ToInt(fy) * I::Set1(NoisePrimeY), py1 = py0 + I::Set1(NoisePrimeY);
+    I pz0 = ToInt(fz) * I::Set1(NoisePrimeZ), pz1 = pz0 + I::Set1(NoisePrimeZ);
+    pz0 = pz0 ^ I::Set1(seed);
+    pz1 = pz1 ^ I::Set1(seed);
+    F x0 = x - fx, y0 = y - fy, z0 = z - fz;
+    F x1 = x0 - F::Set1(1.0f), y1 = y0 - F::Set1(1.0f), z1 = z0 - F::Set1(1.0f);
+    F u = NoiseFade(x0), v = NoiseFade(y0), w = NoiseFade(z0);
+
+    F a = NoiseLerp(NoiseGrad3(NoiseMix(px0 ^ py0 ^ pz0), x0, y0, z0), NoiseGrad3(NoiseMix(px1 ^ py0 ^ pz0), x1, y0, z0), u);
+    F b = NoiseLerp(NoiseGrad3(NoiseMix(px0 ^ py1 ^ pz0), x0, y1, z0), NoiseGrad3(NoiseMix(px1 ^ py1 ^ pz0), x1, y1, z0), u);
+    F c = NoiseLerp(NoiseGrad3(NoiseMix(px0 ^ py0 ^ pz1), x0, y0, z1), NoiseGrad3(NoiseMix(px1 ^ py0 ^ pz1), x1, y0, z1), u);
+    F d = NoiseLerp(NoiseGrad3(NoiseMix(px0 ^ py1 ^ pz1), x0, y1, z1), NoiseGrad3(NoiseMix(px1 ^ py1 ^ pz1), x1, y1, z1), u);
+    return F::Set1(0.936f) * NoiseLerp(NoiseLerp(a, b, v), NoiseLerp(c, d, v), w);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Simplex                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// Stefan Gustavson, Simplex noise demystified. corner ordering is branchless:
+// comparison masks are all ones (-1) so "p - mask" adds one to selected corners
+
+// (max(r - x^2 - y^2..., 0))^4
+template<int N>
+purefn Batch<float, N> SimplexFalloff(Batch<float, N> t)
+{
+    t = Max(t, Batch<float, N>::Zero());
+    t = t * t;
+    return t * t;
+}
+
+template<int N>
+purefn Batch<float, N> Simplex2(Batch<float, N> x, Batch<float, N> y, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    const float F2 = 0.366025403f, G2 = 0.211324865f;
+
+    F s = (x + y) * F::Set1(F2);
+    F i = Floor(x + s), j = Floor(y + s);
+    F t = (i + j) * F::Set1(G2);
+    F x0 = x - (i - t), y0 = y - (j - t);
+
+    I m  = x0 > y0; // lower triangle, x first
+    F x1 = x0 - (Select(F::Zero(), F::Set1(1.0f), m) - F::Set1(G2));
+    F y1 = y0 - (Select(F::Set1(1.0f), F::Zero(), m) - F::Set1(G2));
+    F x2 = x0 - F::Set1(1.0f - 2.0f * G2);
+    F y2 = y0 - F::Set1(1.0f - 2.0f * G2);
+
+    const I PX = I::Set1(NoisePrimeX), PY = I::Set1(NoisePrimeY);
+    I pi = ToInt(i) * PX, pj = ToInt(j) * PY, sd = I::Set1(seed);
+    I h0 = NoiseMix(pi ^ pj ^ sd);
+    I h1 = NoiseMix((pi + (m & PX)) ^ (pj + (~m & PY)) ^ sd);
+    I h2 = NoiseMix((pi + PX) ^ (pj + PY) ^ sd);
+
+    F n0 = SimplexFalloff(F::Set1(0.5f) - x0 * x0 - y0 * y0) * NoiseGrad2(h0, x0, y0);
+    F n1 = SimplexFalloff(F::Set1(0.5f) - x1 * x1 - y1 * y1) * NoiseGrad2(h1, x1, y1);
+    F n2 = SimplexFalloff(F::Set1(0.5f) - x2 * x2 - y2 * y2) * NoiseGrad2(h2, x2, y2);
+    return F::Set1(40.0f) * (n0 + n1 + n2);
+}
+
+template<int N>
+purefn Batch<float, N> Simplex3(Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    const float F3 = 1.0f / 3.0f, G3 = 1.0f / 6.0f;
+
+    F s = (x + y + z) * F::Set1(F3);
+    F i = Floor(x + s), j = Floor(y + s), k = Floor(z + s);
+    F t = (i + j + k) * F::Set1(G3);
+    F x0 = x - (i - t), y0 = y - (j - t), z0 = z - (k - t);
+
+    // g = x >= y, y >= z, z >= x; first corner is min(g, !g.zxy), second max(g, !g.zxy)
+    I gx = x0 >= y0, gy = y0 >= z0, gz = z0 >= x0;
+    I i1 = gx & ~gz, j1 = gy & ~gx, k1 = gz & ~gy;
+    I i2 = gx | ~gz, j2 = gy | ~gx, k2 = gz | ~gy;
+
+    const F one = F::Set1(1.0f);
+    F x1 = x0 - Select(F::Zero(), one, i1) + F::Set1(G3);
+    F y1 = y0 - Select(F::Zero(), one, j1) + F::Set1(G3);
+    F z1 = z0 - Select(F::Zero(), one, k1) + F::Set1(G3);
+    F x2 = x0 - Select(F::Zero(), one, i2) + F::Set1(2.0f * G3);
+    F y2 = y0 - Select(F::Zero(), one, j2) + F::Set1(2.0f * G3);
+    F z2 = z0 - Select(F::Zero(), one, k2) + F::Set1(2.0f * G3);
+    F x3 = x0 - F::Set1(1.0f - 3.0f * G3);
+    F y3 = y0 - F::Set1(1.0f - 3.0f * G3);
+    F z3 = z0 - F::Set1(1.0f - 3.0f * G3);
+
+    const I PX = I::Set1(NoisePrimeX), PY = I::Set1(NoisePrimeY), PZ = I::Set1(NoisePrimeZ);
+    I pi = ToInt(i) * PX, pj = ToInt(j) * PY, pk = ToInt(k) * PZ, sd = I::Set1(seed);
+
+    I h0 = NoiseMix(pi ^ pj ^ pk ^ sd);
+    I h1 = NoiseMix((pi + (i1 & PX)) ^ (pj + (j1 & PY)) ^ (pk + (k1 & PZ)) ^ sd);
+    I h2 = NoiseMix((pi + (i2 & PX)) ^ (pj + (j2 & PY)) ^ (pk + (k2 & PZ)) ^ sd);
+    I h3 = NoiseMix((pi + PX) ^ (pj + PY) ^ (pk + PZ) ^ sd);
+
+    const F r = F::Set1(0.6f);
+    F n0 = SimplexFalloff(r - x0 * x0 - y0 * y0 - z0 * z0) * NoiseGrad3(h0, x0, y0, z0);
+    F n1 = SimplexFalloff(r - x1 * x1 - y1 * y1 - z1 * z1) * NoiseGrad3(h1, x1, y1, z1);
+    F n2 = SimplexFalloff(r - x2 * x2 - y2 * y2 - z2 * z2) * NoiseGrad3(h2, x2, y2, z2);
+    F n3 = SimplexFalloff(r - x3 * x3 - y3 * y3 - z3 * z3) * NoiseGrad3(h3, x3, y3, z3);
+    return F::Set1(32.0f) * (n0 + n1 + n2 + n3);
+}
+
+template<int N>
+purefn Batch<float, N> Simplex4(Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, Batch<float, N> w, int seed = 0)
+{
+    typedef Batch<float, N> F; typedef BatchMask<N> I;
+    const float F4 = 0.309016994f, G4 = 0.138196601f;
+
+    F s = (x + y + z + w) * F::Set1(F4);
+    F i = Floor(x + s), j = Floor(y + s), k = Floor(z + s), l = Floor(w + s);
+    F t = (i + j + k + l) * F::Set1(G4);
+    F x0 = x - (i - t), y0 = y - (j - t), z0 = z - (k - t), w0 = w - (l - t);
+
+    // rank of each axis, number of axes that are smaller. masks are -1 so subtracting increments
+    I rx = I::Zero(), ry = I::Zero(), rz = I::Zero(), rw = I::Zero();
+    I c;
+    c = x0 > y0; rx = rx - c; ry = ry - ~c;
+    c = x0 > z0; rx = rx - c; rz = rz - ~c;
+    c = x0 > w0; rx = rx - c; rw = rw - ~c;
+    c = y0 > z0; ry = ry - c; rz = rz - ~c;
+    c = y0 > w0; ry = ry - c; rw = rw - ~c;
+    c = z0 > w0; rz = rz - c; rw = rw - ~c;
+
+    const I PX = I::Set1(NoisePrimeX), PY = I::Set1(NoisePrimeY), PZ = I::Set1(NoisePrimeZ), PW = I::Set1(NoisePrimeW);
+    I pi = ToInt(i) * PX, pj = ToInt(j) * PY, pk = ToInt(k) * PZ, pl = ToInt(l) * PW, sd = I::Set1(seed);
+
+    const F one = F::Set1(1.0f);
+    F sum = F::Zero();
+    F g = F::Zero();
+    // middle corners, axis steps once its rank is greater than 2, 1 and 0
+    for (int corner = 2; corner >= 0; corner--)
+    {
+        I cr = I::Set1(corner);
+        I mi = rx > cr, mj = ry > cr, mk = rz > cr, ml = rw > cr;
+        g = g + F::Set1(G4);
+        F xc = x0 - Select(F::Zero(), one, mi) + g;
+        F yc = y0 - Select(F::Zero(), one, mj) + g;
+        F zc = z0 - Select(F::Zero(), one, mk) + g;
+        F wc = w0 - Select(F::Zero(), one, ml) + g;
+        I h = NoiseMix((pi + (mi & PX)) ^ (pj + (mj & PY)) ^ (pk + (mk & PZ)) ^ (pl + (ml & PW)) ^ sd);
+        sum = sum + SimplexFalloff(F::Set1(0.6f) - xc * xc - yc * yc - zc * zc - wc * wc) * NoiseGrad4(h, xc, yc, zc, wc);
+    }
+
+    F x4 = x0 - F::Set1(1.0f - 4.0f * G4), y4 = y0 - F::Set1(1.0f - 4.0f * G4);
+    F z4 = z0 - F::Set1(1.0f - 4.0f * G4), w4 = w0 - F::Set1(1.0f - 4.0f * G4);
+    I h0 = NoiseMix(pi ^ pj ^ pk ^ pl ^ sd);
+    I h4 = NoiseMix((pi + PX) ^ (pj + PY) ^ (pk + PZ) ^ (pl + PW) ^ sd);
+    sum = sum + SimplexFalloff(F::Set1(0.6f) - x0 * x0 - y0 * y0 - z0 * z0 - w0 * w0) * NoiseGrad4(h0, x0, y0, z0, w0);
+    sum = sum + SimplexFalloff(F::Set1(0.6f) - x4 * x4 - y4 * y4 - z4 * z4 - w4 * w4) * NoiseGrad4(h4, x4, y4, z4, w4);
+    return F::Set1(27.0f) * sum;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                           fBm & Domain Warp                              */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+enum NoiseType : int
+{
+    NoiseType_Value,
+    NoiseType_Perlin,
+    NoiseType_Simplex
+};
+
+struct FbmParams
+{
+    NoiseType type       = NoiseType_Simplex;
+    int   octaves        = 5;
+    float frequency      = 1.0f;
+    float lacunarity     = 2.0f; // frequency multiplier of each octave
+    float gain           = 0.5f; // amplitude multiplier of each octave
+    int   seed           = 0;
+    float warpAmplitude  = 0.0f; // domain warp is disabled when zero
+    float warpFrequency  = 1.0f;
+};
+
+template<int N>
+purefn Batch<float, N> Noise2(NoiseType type, Batch<float, N> x, Batch<float, N> y, int seed)
+{
+    switch (type)
+    {
+        case NoiseType_Value:  return ValueNoise2(x, y, seed);
+        case NoiseType_Perlin: return Perlin2(x, y, seed);
+        default:               return Simplex2(x, y, seed);
+    }
+}
+
+template<int N>
+purefn Batch<float, N> Noise3(NoiseType type, Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, int seed)
+{
+    switch (type)
+    {
+        case NoiseType_Value:  return ValueNoise3(x, y, z, seed);
+        case NoiseType_Perlin: return Perlin3(x, y, z, seed);
+        default:               return Simplex3(x, y, z, seed);
+    }
+}
+
+// offsets coordinates with simplex noise, each axis uses different seed
+template<int N>
+inline void DomainWarp2(Batch<float, N>* x, Batch<float, N>* y, float amplitude, float frequency, int seed)
+{
+    typedef Batch<float, N> F;
+    F fx = *x * F::Set1(frequency), fy = *y * F::Set1(frequency);
+    F wx = Simplex2(fx, fy, seed), wy = Simplex2(fx, fy, seed + 1);
+    *x = Fmadd(wx, F::Set1(amplitude), *x);
+    *y = Fmadd(wy, F::Set1(amplitude), *y);
+}
+
+template<int N>
+inline void DomainWarp3(Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z, float amplitude, float frequency, int seed)
+{
+    typedef Batch<float, N> F;
+    F fx = *x * F::Set1(frequency), fy = *y * F::Set1(frequency), fz = *z * F::Set1(frequency);
+    F wx = Simplex3(fx, fy, fz, seed), wy = Simplex3(fx, fy, fz, seed + 1), wz = Simplex3(fx, fy, fz, seed + 2);
+    *x = Fmadd(wx, F::Set1(amplitude), *x);
+    *y = Fmadd(wy, F::Set1(amplitude), *y);
+    *z = Fmadd(wz, F::Set1(amplitude), *z);
+}
+
+// sum of octaves divided by sum of amplitudes, result stays in [-1, 1]
+template<int N>
+purefn Batch<float, N> Fbm2(Batch<float, N> x, Batch<float, N> y, const FbmParams& params)
+{
+    typedef Batch<float, N> F;
+    if (params.warpAmplitude != 0.0f)
+        DomainWarp2(&x, &y, params.warpAmplitude, params.warpFrequency, params.seed + 1013);
+
+    F sum = F::Zero();
+    float frequency = params.frequency, amplitude = 1.0f, total = 0.0f;
+    for (int o = 0; o < params.octaves; o++)
+    {
+        F f = F::Set1(frequency);
+        sum = Fmadd(Noise2(params.type, x * f, y * f, params.seed + o), F::Set1(amplitude), sum);
+        total += amplitude;
+        frequency *= params.lacunarity;
+        amplitude *= params.gain;
+    }
+    return sum * F::Set1(total > 0.0f ? 1.0f / total : 0.0f);
+}
+
+template<int N>
+purefn Batch<float, N> Fbm3(Batch<float, N> x, Batch<float, N> y, Batch<float, N> z, const FbmParams& params)
+{
+    typedef Batch<float, N> F;
+    if (params.warpAmplitude != 0.0f)
+        DomainWarp3(&x, &y, &z, params.warpAmplitude, params.warpFrequency, params.seed + 1013);
+
+    F sum = F::Zero();
+    float frequency = params.frequency, amplitude = 1.0f, total = 0.0f;
+    for (int o = 0; o < params.octaves; o++)
+    {
+        F f = F::Set1(frequency);
+        sum = Fmadd(Noise3(params.type, x * f, y * f, z * f, params.seed + o), F::Set1(amplitude), sum);
+        total += amplitude;
+        frequency *= params.lacunarity;
+        amplitude *= params.gain;
+    }
+    return sum * F::Set1(total > 0.0f ? 1.0f / total : 0.0f);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Scalar                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+typedef Batch<float, 1> Noise1;
+
+purefn float ValueNoise(float x, float y, int seed = 0)          { return ValueNoise2(Noise1::Set1(x), Noise1::Set1(y), seed).v[0]; }
+purefn float ValueNoise(float x, float y, float z, int seed = 0) { return ValueNoise3(Noise1::Set1(x), Noise1::Set1(y), Noise1::Set1(z), seed).v[0]; }
+purefn float Perlin(float x, float y, int seed = 0)              { return Perlin2(Noise1::Set1(x), Noise1::Set1(y), seed).v[0]; }
+purefn float Perlin(float x, float y, float z, int seed = 0)     { return Perlin3(Noise1::Set1(x), Noise1::Set1(y), Noise1::Set1(z), seed).v[0]; }
+purefn float Simplex(float x, float y, int seed = 0)             { return Simplex2(Noise1::Set1(x), Noise1::Set1(y), seed).v[0]; }
+purefn float Simplex(float x, float y, float z, int seed = 0)    { return Simplex3(Noise1::Set1(x), Noise1::Set1(y), Noise1::Set1(z), seed).v[0]; }
+
+purefn float Simplex(float x, float y, float z, float w, int seed = 0) {
+    return Simplex4(Noise1::Set1(x), Noise1::Set1(y), Noise1::Set1(z), Noise1::Set1(w), seed).v[0];
+}
+
+purefn float Fbm(Vector2f p, const FbmParams& params) { return Fbm2(Noise1::Set1(p.x), Noise1::Set1(p.y), params).v[0]; }
+purefn float Fbm(Vector3f p, const FbmParams& params) { return Fbm3(Noise1::Set1(p.x), Noise1::Set1(p.y), Noise1::Set1(p.z), params).v[0]; }
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Arrays                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+inline int Fbm2Kernel(float* dst, const Vector2SoA& points, const FbmParams& params, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Fbm2(Batch<float, N>::Load(points.x + i), Batch<float, N>::Load(points.y + i), params).Store(dst + i);
+    return i;
+}
+
+template<int N>
+inline int Fbm3Kernel(float* dst, const Vector3SoA& points, const FbmParams& params, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Fbm3(Batch<float, N>::Load(points.x + i), Batch<float, N>::Load(points.y + i), Batch<float, N>::Load(points.z + i), params).Store(dst + i);
+    return i;
+}
+
+inline void FbmArray(float* dst, const Vector2SoA& points, const FbmParams& params, int count)
+{
+    int i = Fbm2Kernel<AX_BATCH_WIDTH>(dst, points, params, 0, count);
+    Fbm2Kernel<1>(dst, points, params, i, count);
+}
+
+inline void FbmArray(float* dst, const Vector3SoA& points, const FbmParams& params, int count)
+{
+    int i = Fbm3Kernel<AX_BATCH_WIDTH>(dst, points, params, 0, count);
+    Fbm3Kernel<1>(dst, points, params, i, count);
+}
+
+template<int N>
+inline int FbmRowKernel(float* dst, float x, float y, float spacing, const FbmParams& params, int i, int count)
+{
+    static const float lanes[16] = { 0.0f, 1.0f, 2.0f,  3.0f,  4.0f,  5.0f,  6.0f,  7.0f,
+                                     8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f };
+    typedef Batch<float, N> F;
+    const F offsets = F::Load(lanes) * F::Set1(spacing);
+    for (; i + N <= count; i += N)
+        Fbm2(F::Set1(x + float(i) * spacing) + offsets, F::Set1(y), params).Store(dst + i);
+    return i;
+}
+
+// width * height row major grid, sample (x, y) is at origin + (x, y) * spacing
+inline void FbmHeightfield(float* dst, int width, int height, Vector2f origin, float spacing, const FbmParams& params)
+{
+    for (int row = 0; row < height; row++)
+    {
+        float* line = dst + row * width;
+        float y = origin.y + float(row) * spacing;
+        int i = FbmRowKernel<AX_BATCH_WIDTH>(line, origin.x, y, spacing, params, 0, width);
+        FbmRowKernel<1>(line, origin.x, y, spacing, params, i, width);
+    }
+}
+
+AX_END_NAMESPACE
@@ -0,0 +1,447 @@
+/*****************************************************************
+*   Purpose:                                                     *
+*      Software occlusion culling, occluder triangles are binned *
+*      to screen tiles and rasterized with Batch<T, N> to a low  *
+*      resolution depth buffer, each tile has min/max depth      *
+*      pyramid, boxes are tested against it hierarchically.      *
+*   Be Aware:                                                    *
+*      There is no thread pool in this library, tiles are        *
+*      independent: call RenderOcclusionTile for each tile from  *
+*      your own threads after BinOcclusionTriangles.             *
+*      Depth is z / w, bigger is farther. Reversed z is not      *
+*      supported. Triangles behind the near plane are skipped.   *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "Bounds.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Buffer                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// tiles are square, size has to be power of two and multiple of AX_BATCH_WIDTH
+constexpr int OcclusionTileSize   = 32;
+constexpr int OcclusionTilePixels = OcclusionTileSize * OcclusionTileSize;
+constexpr int OcclusionTileLevels = 6; // 32x32, 16x16, 8x8, 4x4, 2x2, 1x1
+
+// start of the levels in hiz texels of a tile, level 0 is the depth buffer itself
+constexpr int OcclusionLevelOffset[OcclusionTileLevels] = { 0, 0, 256, 320, 336, 340 };
+constexpr int OcclusionHiZSize = 341;
+
+struct OcclusionBuffer
+{
+    float* depth;         // tile major, pixel x, y of tile t is depth[t * OcclusionTilePixels + y * OcclusionTileSize + x]
+    float* hizMin;        // nearest depth of the texels, OcclusionHiZSize floats per tile
+    float* hizMax;        // farthest depth of the texels
+    float* triangles;     // screen space x, y, depth of 3 vertices, 9 floats per triangle
+    uint32* binStart;     // triangles of tile t are binTriangles[binStart[t]] .. binTriangles[binStart[t + 1] - 1]
+    uint32* binTriangles;
+    int width, height;    // in pixels, tiles at right and bottom can be partially used
+    int tilesX, tilesY;
+    int numTriangles, maxTriangles;
+    int binCapacity;
+};
+
+// memory is allocated with new[], release it with DestroyOcclusionBuffer
+inline OcclusionBuffer CreateOcclusionBuffer(int width, int height, int maxTriangles)
+{
+    OcclusionBuffer buffer;
+    buffer.width  = width;
+    buffer.height = height;
+    buffer.tilesX = (width  + OcclusionTileSize - 1) / OcclusionTileSize;
+    buffer.tilesY = (height + OcclusionTileSize - 1) / OcclusionTileSize;
+    const int numTiles = buffer.tilesX * buffer.tilesY;
+
+    buffer.depth        = new float[numTiles * OcclusionTilePixels];
+    buffer.hizMin       = new float[numTiles * OcclusionHiZSize];
+    buffer.hizMax       = new float[numTiles * OcclusionHiZSize];
+    buffer.triangles    = new float[maxTriangles * 9];
+    buffer.binStart     = new uint32[numTiles + 1];
+    buffer.binTriangles = new uint32[maxTriangles];
+    buffer.binCapacity  = maxTriangles;
+    buffer.maxTriangles = maxTriangles;
+    buffer.numTriangles = 0;
+
+    // nothing is occluded until the first render
+    for (int i = 0; i < numTiles * OcclusionTilePixels; i++) buffer.depth[i] = FLT_MAX;
+    for (int i = 0; i < numTiles * OcclusionHiZSize; i++) buffer.hizMin[i] = buffer.hizMax[i] = FLT_MAX;
+    for (int i = 0; i <= numTiles; i++) buffer.binStart[i] = 0;
+    return buffer;
+}
+
+inline void DestroyOcclusionBuffer(OcclusionBuffer& buffer)
+{
+    delete[] buffer.depth;
+    delete[] buffer.hizMin;
+    delete[] buffer.hizMax;
+    delete[] buffer.triangles;
+    delete[] buffer.binStart;
+    delete[] buffer.binTriangles;
+    buffer.depth = nullptr;
+    buffer.numTriangles = buffer.maxTriangles = buffer.binCapacity = 0;
+}
+
+// removes the occluders, call at the start of the frame before adding occluders
+inline void ClearOcclusionBuffer(OcclusionBuffer& buffer)
+{
+    buffer.numTriangles = 0;
+}
+
+// inclusive pixel bounds of the screen space rectangle clamped to screen,
+// returns false if rectangle is outside of the screen
+inline bool OcclusionScreenRect(const OcclusionBuffer& buffer, float minX, float minY, float maxX, float maxY, int rect[4])
+{
+    if (maxX < 0.0f || maxY < 0.0f || minX >= (float)buffer.width || minY >= (float)buffer.height)
+        return false;
+    rect[0] = (int)MAX(minX, 0.0f);
+    rect[1] = (int)MAX(minY, 0.0f);
+    rect[2] = (int)MIN(maxX, float(buffer.width - 1));
+    rect[3] = (int)MIN(maxY, float(buffer.height - 1));
+    return true;
+}
+
+inline bool OcclusionTriangleRect(const OcclusionBuffer& buffer, const float* tri, int rect[4])
+{
+    return OcclusionScreenRect(buffer, MIN(tri[0], MIN(tri[3], tri[6])), MIN(tri[1], MIN(tri[4], tri[7])),
+                                       MAX(tri[0], MAX(tri[3], tri[6])), MAX(tri[1], MAX(tri[4], tri[7])), rect);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Occluders                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// indices are triangle list, modelViewProjection is OpenGL style (Matrix4::PerspectiveFovRH).
+// triangles that has a vertex closer than the near plane (z < -w) are skipped like the gpu clips them,
+// it only makes the culling less aggressive.
+// both faces are rasterized, occluder meshes doesn't need to be closed or consistently wound.
+// returns false if buffer is full, triangles that fit are still added
+inline bool AddOccluder(OcclusionBuffer& buffer, const Vector3f* vertices, const uint32* indices, int numIndices,
+                        const Matrix4& modelViewProjection)
+{
+    const float halfWidth = 0.5f * buffer.width, halfHeight = 0.5f * buffer.height;
+    for (int i = 0; i + 3 <= numIndices; i += 3)
+    {
+        if (buffer.numTriangles == buffer.maxTriangles) return false;
+        float* tri = buffer.triangles + buffer.numTriangles * 9;
+        bool behind = false;
+
+        for (int v = 0; v < 3 && !behind; v++)
+        {
+            const Vector3f& p = vertices[indices[i + v]];
+            alignas(16) float clip[4];
+            VecStore(clip, ::Vector3Transform(VecSetR(p.x, p.y, p.z, 1.0f), modelViewProjection.r));
+            behind = clip[2] < -clip[3]; // also true for w <= 0 with perspective projection
+            float rw = 1.0f / clip[3];
+            tri[v * 3 + 0] = (clip[0] * rw + 1.0f) * halfWidth;
+            tri[v * 3 + 1] = (1.0f - clip[1] * rw) * halfHeight; // y is down in screen
+            tri[v * 3 + 2] = clip[2] * rw;
+        }
+        buffer.numTriangles += !behind;
+    }
+    return true;
+}
+
+// has to be called after adding all of the occluders, before rendering the tiles
+inline void BinOcclusionTriangles(OcclusionBuffer& buffer)
+{
+    const int numTiles = buffer.tilesX * buffer.tilesY;
+    uint32* binStart = buffer.binStart;
+    for (int t = 0; t <= numTiles; t++) binStart[t] = 0;
+
+    // first pass counts the triangles of each tile to binStart[t + 1], second pass uses it as cursor,
+    // at the end binStart[t + 1] is the end of tile t which is the start of the next tile
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < buffer.numTriangles; i++)
+        {
+            int rect[4];
+            if (!OcclusionTriangleRect(buffer, buffer.triangles + i * 9, rect)) continue;
+
+            for (int ty = rect[1] / OcclusionTileSize; ty <= rect[3] / OcclusionTileSize; ty++)
+            for (int tx = rect[0] / OcclusionTileSize; tx <= rect[2] / OcclusionTileSize; tx++)
+            {
+                uint32& bin = binStart[ty * buffer.tilesX + tx + 1];
+                if (pass == 0) bin++;
+                else buffer.binTriangles[bin++] = (uint32)i;
+            }
+        }
+
+        if (pass == 1) break;
+        uint32 total = 0;
+        for (int t = 0; t < numTiles; t++)
+        {
+            uint32 count = binStart[t + 1];
+            binStart[t + 1] = total;
+            total += count;
+        }
+
+        if (total > (uint32)buffer.binCapacity)
+        {
+            delete[] buffer.binTriangles;
+            buffer.binCapacity  = (int)total + (int)(total >> 1);
+            buffer.binTriangles = new uint32[buffer.binCapacity];
+        }
+    }
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                               Rasterizer                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+constexpr float OcclusionPixelCenters[16] = { 0.5f, 1.5f,  2.5f,  3.5f,  4.5f,  5.5f,  6.5f,  7.5f,
+                                              8.5f, 9.5f, 10.5f, 11.5f, 12.5f, 13.5f, 14.5f, 15.5f };
+
+// pixels that has their center inside of the triangle keeps the nearest depth,
+// rect is the screen bounds of the triangle, from OcclusionTriangleRect
+template<int N>
+inline void RasterizeOcclusionTriangle(float* tileDepth, const float* tri, int tileX, int tileY, const int rect[4])
+{
+    typedef Batch<float, N> B;
+    static_assert(OcclusionTileSize % N == 0, "tile rows must contain whole batches");
+
+    float x0 = tri[0], y0 = tri[1], z0 = tri[2];
+    float x1 = tri[3], y1 = tri[4], z1 = tri[5];
+    float x2 = tri[6], y2 = tri[7], z2 = tri[8];
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (Abs(area) < 1e-6f) return;
+    if (area < 0.0f) // make the winding counter clockwise so inside of all edges is positive
+    {
+        float t;
+        t = x1; x1 = x2; x2 = t;
+        t = y1; y1 = y2; y2 = t;
+        t = z1; z1 = z2; z2 = t;
+        area = -area;
+    }
+
+    // depth plane, z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+    float rcpArea = 1.0f / area;
+    float dzdx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) * rcpArea;
+    float dzdy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) * rcpArea;
+
+    // edge i goes from vertex i to vertex i + 1, e = a * x + b * y + c
+    const float ea[3] = { y0 - y1, y1 - y2, y2 - y0 };
+    const float eb[3] = { x1 - x0, x2 - x1, x0 - x2 };
+    const float ec[3] = { -(ea[0] * x0 + eb[0] * y0), -(ea[1] * x1 + eb[1] * y1), -(ea[2] * x2 + eb[2] * y2) };
+
+    const int originX = tileX * OcclusionTileSize, originY = tileY * OcclusionTileSize;
+    const int startX = MAX(rect[0] - originX, 0) & ~(N - 1);
+    const int endX   = MIN(rect[2] - originX, OcclusionTileSize - 1);
+    const int startY = MAX(rect[1] - originY, 0);
+    const int endY   = MIN(rect[3] - originY, OcclusionTileSize - 1);
+
+    const B centers = B::Load(OcclusionPixelCenters);
+    const B a0 = B::Set1(ea[0]), a1 = B::Set1(ea[1]), a2 = B::Set1(ea[2]), slope = B::Set1(dzdx);
+
+    for (int y = startY; y <= endY; y++)
+    {
+        float py = float(originY + y) + 0.5f;
+        B row0 = B::Set1(eb[0] * py + ec[0]);
+        B row1 = B::Set1(eb[1] * py + ec[1]);
+        B row2 = B::Set1(eb[2] * py + ec[2]);
+        B rowZ = B::Set1(z0 - dzdx * x0 + dzdy * (py - y0));
+        float* depthRow = tileDepth + y * OcclusionTileSize;
+
+        for (int x = startX; x <= endX; x += N)
+        {
+            B px = B::Set1(float(originX + x)) + centers;
+            BatchMask<N> inside = (Fmadd(px, a0, row0) >= B::Zero()) &
+                                  (Fmadd(px, a1, row1) >= B::Zero()) &
+                                  (Fmadd(px, a2, row2) >= B::Zero());
+            if (!Any(inside)) continue;
+
+            B depth = B::Load(depthRow + x);
+            Select(depth, Min(depth, Fmadd(px, slope, rowZ)), inside).Store(depthRow + x);
+        }
+    }
+}
+
+// builds min/max depth pyramid of the tile from its depth buffer
+inline void BuildOcclusionHiZ(OcclusionBuffer& buffer, int tile)
+{
+    const float* srcMin = buffer.depth + tile * OcclusionTilePixels;
+    const float* srcMax = srcMin;
+    float* hizMin = buffer.hizMin + tile * OcclusionHiZSize;
+    float* hizMax = buffer.hizMax + tile * OcclusionHiZSize;
+
+    for (int level = 1, size = OcclusionTileSize >> 1; level < OcclusionTileLevels; level++, size >>= 1)
+    {
+        float* dstMin = hizMin + OcclusionLevelOffset[level];
+        float* dstMax = hizMax + OcclusionLevelOffset[level];
+        const int srcSize = size << 1;
+
+        for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+        {
+            const int s = y * 2 * srcSize + x * 2;
+            dstMin[y * size + x] = MIN(MIN(srcMin[s], srcMin[s + 1]), MIN(srcMin[s + srcSize], srcMin[s + srcSize + 1]));
+            dstMax[y * size + x] = MAX(MAX(srcMax[s], srcMax[s + 1]), MAX(srcMax[s + srcSize], srcMax[s + srcSize + 1]));
+        }
+        srcMin = dstMin;
+        srcMax = dstMax;
+    }
+}
+
+// rasterizes the triangles that are binned to the tile and builds the depth pyramid of it.
+// tiles doesn't share memory, different threads can render different tiles at the same time
+inline void RenderOcclusionTile(OcclusionBuffer& buffer, int tile)
+{
+    float* depth = buffer.depth + tile * OcclusionTilePixels;
+    for (int i = 0; i < OcclusionTilePixels; i++) depth[i] = FLT_MAX;
+
+    const int tileX = tile % buffer.tilesX, tileY = tile / buffer.tilesX;
+    for (uint32 b = buffer.binStart[tile]; b < buffer.binStart[tile + 1]; b++)
+    {
+        const float* tri = buffer.triangles + buffer.binTriangles[b] * 9;
+        int rect[4];
+        OcclusionTriangleRect(buffer, tri, rect);
+        RasterizeOcclusionTriangle<AX_BATCH_WIDTH>(depth, tri, tileX, tileY, rect);
+    }
+    BuildOcclusionHiZ(buffer, tile);
+}
+
+// single threaded, bins and renders all of the tiles
+inline void RenderOcclusionBuffer(OcclusionBuffer& buffer)
+{
+    BinOcclusionTriangles(buffer);
+    for (int t = 0; t < buffer.tilesX * buffer.tilesY; t++)
+        RenderOcclusionTile(buffer, t);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Testing                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// rect is tile local inclusive pixel bounds, x and y is the texel in the level.
+// returns true if all of the pixels in the rect has an occluder nearer than minDepth
+inline bool IsTileRectOccluded(const OcclusionBuffer& buffer, int tile, int level, int x, int y, const int rect[4], float minDepth)
+{
+    const int size = OcclusionTileSize >> level;
+    const int texel = OcclusionLevelOffset[level] + y * size + x;
+    float farthest = level == 0 ? buffer.depth[tile * OcclusionTilePixels + texel] : buffer.hizMax[tile * OcclusionHiZSize + texel];
+    if (farthest < minDepth) return true;
+    if (level == 0 || buffer.hizMin[tile * OcclusionHiZSize + texel] >= minDepth) return false;
+
+    level--;
+    for (int cy = y * 2; cy <= y * 2 + 1; cy++)
+    for (int cx = x * 2; cx <= x * 2 + 1; cx++)
+    {
+        // skip the children that doesn't overlap with the rect
+        if ((cx + 1) << level <= rect[0] || cx << level > rect[2] ||
+            (cy + 1) << level <= rect[1] || cy << level > rect[3]) continue;
+        if (!IsTileRectOccluded(buffer, tile, level, cx, cy, rect, minDepth)) return false;
+    }
+    return true;
+}
+
+// rect is inclusive pixel bounds clamped to screen (OcclusionScreenRect)
+inline bool IsRectOccluded(const OcclusionBuffer& buffer, const int rect[4], float minDepth)
+{
+    for (int ty = rect[1] / OcclusionTileSize; ty <= rect[3] / OcclusionTileSize; ty++)
+    for (int tx = rect[0] / OcclusionTileSize; tx <= rect[2] / OcclusionTileSize; tx++)
+    {
+        const int originX = tx * OcclusionTileSize, originY = ty * OcclusionTileSize;
+        const int local[4] = { MAX(rect[0] - originX, 0), MAX(rect[1] - originY, 0),
+                               MIN(rect[2] - originX, OcclusionTileSize - 1), MIN(rect[3] - originY, OcclusionTileSize - 1) };
+        if (!IsTileRectOccluded(buffer, ty * buffer.tilesX + tx, OcclusionTileLevels - 1, 0, 0, local, minDepth))
+            return false;
+    }
+    return true;
+}
+
+// boxes that has a corner closer than the near plane (z < -w) or outside of the screen are never occluded
+inline bool IsOccluded(const OcclusionBuffer& buffer, const AABB& box, const Matrix4& viewProjection)
+{
+    alignas(16) float mins[4], maxs[4], clip[4];
+    VecStore(mins, box.min);
+    VecStore(maxs, box.max);
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minDepth = FLT_MAX;
+
+    for (int c = 0; c < 8; c++)
+    {
+        vec_t corner = VecSetR(c & 1 ? maxs[0] : mins[0], c & 2 ? maxs[1] : mins[1], c & 4 ? maxs[2] : mins[2], 1.0f);
+        VecStore(clip, ::Vector3Transform(corner, viewProjection.r));
+        if (clip[2] < -clip[3]) return false;
+        float rw = 1.0f / clip[3];
+        minX = MIN(minX, clip[0] * rw), maxX = MAX(maxX, clip[0] * rw);
+        minY = MIN(minY, clip[1] * rw), maxY = MAX(maxY, clip[1] * rw);
+        minDepth = MIN(minDepth, clip[2] * rw);
+    }
+
+    const float halfWidth = 0.5f * buffer.width, halfHeight = 0.5f * buffer.height;
+    int rect[4];
+    if (!OcclusionScreenRect(buffer, (minX + 1.0f) * halfWidth, (1.0f - maxY) * halfHeight,
+                                     (maxX + 1.0f) * halfWidth, (1.0f - minY) * halfHeight, rect))
+        return false;
+    return IsRectOccluded(buffer, rect, minDepth);
+}
+
+// clears the visibleBits of the boxes that are behind the occluders, same bit layout with CullAABBArray.
+// boxes that are already culled (bit is zero) are skipped, so it is cheap to use after frustum culling.
+// projection of the boxes is done with batches, hierarchical test is done one box at a time.
+// i and count has to be multiple of 32 if you split the boxes between threads
+template<int N>
+inline int TestOcclusionAABBKernel(uint32* visibleBits, const OcclusionBuffer& buffer, const Vector3SoA& mins, const Vector3SoA& maxs,
+                                   const Matrix4& viewProjection, int i, int count)
+{
+    typedef Batch<float, N> B;
+    static_assert(32 % N == 0, "bitmask words must contain whole batches");
+    const float* m = &viewProjection.m[0][0];
+    const float halfWidth = 0.5f * buffer.width, halfHeight = 0.5f * buffer.height;
+
+    for (; i + N <= count; i += N)
+    {
+        uint32 bits = (visibleBits[i >> 5] >> (i & 31)) & uint32((1ull << N) - 1ull);
+        if (bits == 0) continue;
+
+        B minx = B::Load(mins.x + i), miny = B::Load(mins.y + i), minz = B::Load(mins.z + i);
+        B maxx = B::Load(maxs.x + i), maxy = B::Load(maxs.y + i), maxz = B::Load(maxs.z + i);
+        B lowX = B::Set1(FLT_MAX), lowY = B::Set1(FLT_MAX), highX = B::Set1(-FLT_MAX), highY = B::Set1(-FLT_MAX);
+        B minDepth = B::Set1(FLT_MAX), minNear = B::Set1(FLT_MAX);
+
+        for (int c = 0; c < 8; c++)
+        {
+            B x = c & 1 ? maxx : minx, y = c & 2 ? maxy : miny, z = c & 4 ? maxz : minz;
+            B cx = Fmadd(x, B::Set1(m[0]), Fmadd(y, B::Set1(m[4]), Fmadd(z, B::Set1(m[8]),  B::Set1(m[12]))));
+            B cy = Fmadd(x, B::Set1(m[1]), Fmadd(y, B::Set1(m[5]), Fmadd(z, B::Set1(m[9]),  B::Set1(m[13]))));
+            B cz = Fmadd(x, B::Set1(m[2]), Fmadd(y, B::Set1(m[6]), Fmadd(z, B::Set1(m[10]), B::Set1(m[14]))));
+            B cw = Fmadd(x, B::Set1(m[3]), Fmadd(y, B::Set1(m[7]), Fmadd(z, B::Set1(m[11]), B::Set1(m[15]))));
+            B rw = B::Set1(1.0f) / cw; // lanes closer than the near plane are skipped below, so inf and nan are fine
+            cx = cx * rw, cy = cy * rw;
+            lowX  = Min(lowX, cx),  lowY  = Min(lowY, cy);
+            highX = Max(highX, cx), highY = Max(highY, cy);
+            minDepth = Min(minDepth, cz * rw);
+            minNear = Min(minNear, cz + cw); // negative if a corner is closer than the near plane
+        }
+
+        alignas(64) float left[N], top[N], right[N], bottom[N], depth[N], nearDist[N];
+        Fmadd(lowX,  B::Set1(halfWidth),   B::Set1(halfWidth)).Store(left);
+        Fmadd(highX, B::Set1(halfWidth),   B::Set1(halfWidth)).Store(right);
+        Fmadd(highY, B::Set1(-halfHeight), B::Set1(halfHeight)).Store(top);
+        Fmadd(lowY,  B::Set1(-halfHeight), B::Set1(halfHeight)).Store(bottom);
+        minDepth.Store(depth);
+        minNear.Store(nearDist);
+
+        for (int l = 0; l < N; l++)
+        {
+            int rect[4];
+            if (!((bits >> l) & 1u) || nearDist[l] < 0.0f) continue;
+            if (!OcclusionScreenRect(buffer, left[l], top[l], right[l], bottom[l], rect)) continue;
+            if (IsRectOccluded(buffer, rect, depth[l]))
+                visibleBits[(i + l) >> 5] &= ~(1u << ((i + l) & 31));
+        }
+    }
+    return i;
+}
+
+inline void TestOcclusionAABBArray(uint32* visibleBits, const OcclusionBuffer& buffer, const Vector3SoA& mins, const Vector3SoA& maxs,
+                                   const Matrix4& viewProjection, int count)
+{
+    int i = TestOcclusionAABBKernel<AX_BATCH_WIDTH>(visibleBits, buffer, mins, maxs, viewProjection, 0, count);
+    TestOcclusionAABBKernel<1>(visibleBits, buffer, mins, maxs, viewProjection, i, count);
+}
+
+AX_END_NAMESPACE
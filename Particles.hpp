@@ -0,0 +1,312 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      SIMD particle integrator over SoA streams. gravity,       *
+*      drag, point attractors, plane and box collision and       *
+*      aging are done in one pass over the memory, particles     *
+*      that reached their lifetime are removed by compacting     *
+*      the streams in place within the same pass.                *
+*   Be Aware:                                                    *
+*      order of alive particles is preserved, dead ones are      *
+*      dropped. for multi threading split the array into ranges, *
+*      update each range with ParticleUpdateRange and call       *
+*      ParticleCloseGaps after all threads are finished.         *
+*      every stream has to have the same element count.          *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Types                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+enum ParticleIntegrator : int
+{
+    ParticleIntegrator_Euler,        // p += v * dt, v += a * dt
+    ParticleIntegrator_SemiImplicit, // v += a * dt, p += v * dt, stable for most cases
+    ParticleIntegrator_Verlet        // p += (p - prevPosition) + a * dt * dt
+};
+
+// prevPosition is only used with Verlet integrator, it can be null otherwise
+struct ParticleSoA
+{
+    Vector3SoA position;
+    Vector3SoA velocity;
+    Vector3SoA prevPosition;
+    float* age;
+    float* lifetime;
+};
+
+// pulls particles with strength / distance^2, negative strength pushes them away
+struct ParticleAttractor
+{
+    Vector3f position;
+    float strength;
+};
+
+// particles are kept on the side where Dot(normal, p) + d >= 0, normal has to be normalized
+struct ParticlePlane
+{
+    Vector3f normal;
+    float d;
+};
+
+struct ParticleParams
+{
+    ParticleIntegrator integrator = ParticleIntegrator_SemiImplicit;
+    Vector3f gravity       = { 0.0f, -9.81f, 0.0f };
+    float drag             = 0.0f;  // velocity is divided by (1 + drag * dt) each step
+    const ParticleAttractor* attractors = nullptr;
+    int   numAttractors    = 0;
+    float softening        = 0.01f; // added to squared distance of attractors, avoids infinite force
+    const ParticlePlane* planes = nullptr;
+    int   numPlanes        = 0;
+    bool  useBounds        = false; // particles are kept inside of boundsMin, boundsMax when true
+    Vector3f boundsMin     = { 0.0f, 0.0f, 0.0f };
+    Vector3f boundsMax     = { 0.0f, 0.0f, 0.0f };
+    float restitution      = 0.5f;  // fraction of normal velocity that bounces back
+    float friction         = 0.0f;  // fraction of tangential velocity lost at each hit
+};
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Forces                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+inline void ParticleAcceleration(Batch<float, N>* ax, Batch<float, N>* ay, Batch<float, N>* az,
+                                 Batch<float, N> px, Batch<float, N> py, Batch<float, N> pz, const ParticleParams& params)
+{
+    typedef Batch<float, N> F;
+    *ax = F::Set1(params.gravity.x);
+    *ay = F::Set1(params.gravity.y);
+    *az = F::Set1(params.gravity.z);
+
+    const F softening = F::Set1(params.softening);
+    for (int a = 0; a < params.numAttractors; a++)
+    {
+        const ParticleAttractor& attractor = params.attractors[a];
+        F dx = F::Set1(attractor.position.x) - px;
+        F dy = F::Set1(attractor.position.y) - py;
+        F dz = F::Set1(attractor.position.z) - pz;
+        F distSq = Fmadd(dx, dx, Fmadd(dy, dy, Fmadd(dz, dz, softening)));
+        F invDist = F::Set1(1.0f) / Sqrt(distSq);
+        // strength / dist^2 along normalized direction
+        F s = F::Set1(attractor.strength) * invDist * invDist * invDist;
+        *ax = Fmadd(dx, s, *ax);
+        *ay = Fmadd(dy, s, *ay);
+        *az = Fmadd(dz, s, *az);
+    }
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Collision                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// pushes particles out of the plane and reflects the velocity that goes into the plane
+template<int N>
+inline void ParticleCollidePlane(Batch<float, N>* p, Batch<float, N>* v, const ParticlePlane& plane,
+                                 Batch<float, N> restitution, Batch<float, N> tangentScale)
+{
+    typedef Batch<float, N> F;
+    const F zero = F::Zero();
+    F nx = F::Set1(plane.normal.x), ny = F::Set1(plane.normal.y), nz = F::Set1(plane.normal.z);
+
+    F dist = Fmadd(nx, p[0], Fmadd(ny, p[1], Fmadd(nz, p[2], F::Set1(plane.d))));
+    BatchMask<N> hit = dist < zero;
+    F push = Min(dist, zero); // zero for particles that are on the positive side
+    p[0] = p[0] - nx * push;
+    p[1] = p[1] - ny * push;
+    p[2] = p[2] - nz * push;
+
+    F vn = Fmadd(nx, v[0], Fmadd(ny, v[1], nz * v[2]));
+    hit = hit & (vn < zero);
+    // v = tangent * (1 - friction) - normal * vn * restitution
+    F tx = v[0] - nx * vn, ty = v[1] - ny * vn, tz = v[2] - nz * vn;
+    F bounce = -vn * restitution;
+    v[0] = Select(v[0], Fmadd(tx, tangentScale, nx * bounce), hit);
+    v[1] = Select(v[1], Fmadd(ty, tangentScale, ny * bounce), hit);
+    v[2] = Select(v[2], Fmadd(tz, tangentScale, nz * bounce), hit);
+}
+
+// clamps particles into the box, velocity is reflected at the axis that particle went outside
+template<int N>
+inline void ParticleCollideBounds(Batch<float, N>* p, Batch<float, N>* v, Vector3f boundsMin, Vector3f boundsMax,
+                                  Batch<float, N> restitution, Batch<float, N> tangentScale)
+{
+    typedef Batch<float, N> F;
+    const F zero = F::Zero(), one = F::Set1(1.0f);
+    BatchMask<N> hits[3];
+    for (int c = 0; c < 3; c++)
+    {
+        F mn = F::Set1(boundsMin[c]), mx = F::Set1(boundsMax[c]);
+        BatchMask<N> hit = ((p[c] < mn) & (v[c] < zero)) | ((p[c] > mx) & (v[c] > zero));
+        p[c] = Max(Min(p[c], mx), mn);
+        v[c] = Select(v[c], -v[c] * restitution, hit);
+        hits[c] = hit;
+    }
+    // friction slows down the axes that are tangent to the hit faces
+    v[0] = v[0] * Select(one, tangentScale, hits[1] | hits[2]);
+    v[1] = v[1] * Select(one, tangentScale, hits[0] | hits[2]);
+    v[2] = v[2] * Select(one, tangentScale, hits[0] | hits[1]);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Update                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// dense batches (every particle alive, nothing removed before) are stored back without compaction
+template<int N>
+inline int ParticleWriteStream(float* stream, int read, int write, Batch<float, N> x, BatchMask<N> alive, bool dense)
+{
+    if (dense) { x.Store(stream + read); return N; }
+    return CompressStore(stream + write, x, alive);
+}
+
+// loads, integrates, collides and writes the particles [i, end) to *write, returns the index it stopped.
+template<int N>
+inline int ParticleUpdateKernel(ParticleSoA& ps, const ParticleParams& params, float dt, int i, int end, int* write)
+{
+    typedef Batch<float, N> F;
+    const F dtv = F::Set1(dt);
+    const F invDt = F::Set1(dt > 0.0f ? 1.0f / dt : 0.0f);
+    const F dragScale = F::Set1(1.0f / (1.0f + MAX(params.drag, 0.0f) * dt));
+    const F restitution = F::Set1(params.restitution);
+    const F tangentScale = F::Set1(1.0f - params.friction);
+    const bool verlet = params.integrator == ParticleIntegrator_Verlet;
+
+    for (; i + N <= end; i += N)
+    {
+        F p[3] = { F::Load(ps.position.x + i), F::Load(ps.position.y + i), F::Load(ps.position.z + i) };
+        F v[3] = { F::Load(ps.velocity.x + i), F::Load(ps.velocity.y + i), F::Load(ps.velocity.z + i) };
+        F age  = F::Load(ps.age + i) + dtv;
+        F lifetime = F::Load(ps.lifetime + i);
+
+        F a[3];
+        ParticleAcceleration(&a[0], &a[1], &a[2], p[0], p[1], p[2], params);
+
+        switch (params.integrator)
+        {
+            case ParticleIntegrator_Euler:
+                for (int c = 0; c < 3; c++)
+                {
+                    p[c] = Fmadd(v[c], dtv, p[c]);
+                    v[c] = Fmadd(a[c], dtv, v[c]) * dragScale;
+                }
+                break;
+            case ParticleIntegrator_SemiImplicit:
+                for (int c = 0; c < 3; c++)
+                {
+                    v[c] = Fmadd(a[c], dtv, v[c]) * dragScale;
+                    p[c] = Fmadd(v[c], dtv, p[c]);
+                }
+                break;
+            case ParticleIntegrator_Verlet:
+            {
+                const float* prev[3] = { ps.prevPosition.x + i, ps.prevPosition.y + i, ps.prevPosition.z + i };
+                const F dtSq = dtv * dtv;
+                for (int c = 0; c < 3; c++)
+                {
+                    F step = (p[c] - F::Load(prev[c])) * dragScale;
+                    F next = Fmadd(a[c], dtSq, p[c] + step);
+                    v[c] = (next - p[c]) * invDt;
+                    p[c] = next;
+                }
+                break;
+            }
+        }
+
+        for (int j = 0; j < params.numPlanes; j++)
+            ParticleCollidePlane(p, v, params.planes[j], restitution, tangentScale);
+
+        if (params.useBounds)
+            ParticleCollideBounds(p, v, params.boundsMin, params.boundsMax, restitution, tangentScale);
+
+        BatchMask<N> alive = age < lifetime;
+        const bool dense = *write == i && All(alive);
+        const int w = *write;
+
+        ParticleWriteStream(ps.position.x, i, w, p[0], alive, dense);
+        ParticleWriteStream(ps.position.y, i, w, p[1], alive, dense);
+        ParticleWriteStream(ps.position.z, i, w, p[2], alive, dense);
+        ParticleWriteStream(ps.velocity.x, i, w, v[0], alive, dense);
+        ParticleWriteStream(ps.velocity.y, i, w, v[1], alive, dense);
+        ParticleWriteStream(ps.velocity.z, i, w, v[2], alive, dense);
+
+        if (verlet) // collision changes velocity, previous position has to agree with it
+        {
+            ParticleWriteStream(ps.prevPosition.x, i, w, Fmadd(v[0], -dtv, p[0]), alive, dense);
+            ParticleWriteStream(ps.prevPosition.y, i, w, Fmadd(v[1], -dtv, p[1]), alive, dense);
+            ParticleWriteStream(ps.prevPosition.z, i, w, Fmadd(v[2], -dtv, p[2]), alive, dense);
+        }
+
+        ParticleWriteStream(ps.lifetime, i, w, lifetime, alive, dense);
+        *write += ParticleWriteStream(ps.age, i, w, age, alive, dense);
+    }
+    return i;
+}
+
+// updates particles in [begin, end), alive ones are moved to the start of the range.
+// returns number of alive particles, they are at [begin, begin + result)
+// different threads can update different ranges of the same particles at the same time
+inline int ParticleUpdateRange(ParticleSoA& particles, const ParticleParams& params, float dt, int begin, int end)
+{
+    int write = begin;
+    int i = ParticleUpdateKernel<AX_BATCH_WIDTH>(particles, params, dt, begin, end, &write);
+    ParticleUpdateKernel<1>(particles, params, dt, i, end, &write);
+    return write - begin;
+}
+
+// single threaded update, returns new particle count
+inline int ParticleUpdate(ParticleSoA& particles, const ParticleParams& params, float dt, int count)
+{
+    return ParticleUpdateRange(particles, params, dt, 0, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                            Multi Threading                               */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// moves count floats to lower address, forward copy is safe when dst < src even if they overlap
+template<int N>
+inline int ParticleMoveKernel(float* dst, const float* src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        Batch<float, N>::Load(src + i).Store(dst + i);
+    return i;
+}
+
+inline void ParticleMoveStream(float* stream, int dst, int src, int count)
+{
+    if (dst == src || stream == nullptr) return;
+    int i = ParticleMoveKernel<AX_BATCH_WIDTH>(stream + dst, stream + src, 0, count);
+    ParticleMoveKernel<1>(stream + dst, stream + src, i, count);
+}
+
+// after each range is updated with ParticleUpdateRange, moves alive particles of every range next to each other.
+// ranges has to be sorted by begin and must not overlap. returns total alive particle count
+inline int ParticleCloseGaps(ParticleSoA& ps, const int* begins, const int* aliveCounts, int numRanges)
+{
+    int write = numRanges > 0 ? begins[0] : 0;
+    for (int r = 0; r < numRanges; r++)
+    {
+        const int src = begins[r], count = aliveCounts[r];
+        float* streams[] = {
+            ps.position.x, ps.position.y, ps.position.z,
+            ps.velocity.x, ps.velocity.y, ps.velocity.z,
+            ps.prevPosition.x, ps.prevPosition.y, ps.prevPosition.z,
+            ps.age, ps.lifetime
+        };
+        for (float* stream : streams)
+            ParticleMoveStream(stream, write, src, count);
+        write += count;
+    }
+    return write - (numRanges > 0 ? begins[0] : 0);
+}
+
+AX_END_NAMESPACE
@@ -0,0 +1,320 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Packs quaternions with smallest three encoding into 29,   *
+*      32 or 48 bits and positions inside of an AABB into few    *
+*      bits per axis, for network snapshots and compressed data. *
+*      array functions encodes many entities with SIMD at once.  *
+*   Be Aware:                                                    *
+*      quaternions has to be normalized, q and -q packs same.    *
+*      results are bit exact on every platform and instruction   *
+*      set (with or without FMA), rounding uses only a single    *
+*      multiply, truncation and integer math. position steps are *
+*      powers of two so dequantization is exact too.             *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Quaternion.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Helpers                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// round(x / 2), half away from zero. x is twice the value so a single multiply
+// is enough before rounding, fused or not result is same on every platform
+template<int N>
+purefn BatchMask<N> QuantizeRoundHalf(Batch<float, N> x)
+{
+    BatchMask<N> k = ToInt(x);
+    return (k + BatchMask<N>::Set1(1) + (k >> 31)) >> 1;
+}
+
+// value = top << 2B | a << B | b, split into low and high 32 bits
+template<int B, int N>
+inline void PackBitFields(BatchMask<N>& lo, BatchMask<N>& hi, BatchMask<N> top, BatchMask<N> a, BatchMask<N> b)
+{
+    lo = b | (a << B);
+    hi = ShiftRightLogical(a, 32 - B);
+    if_constexpr (2 * B < 32) {
+        lo = lo | (top << (2 * B));
+        hi = hi | ShiftRightLogical(top, 32 - 2 * B);
+    }
+    else hi = hi | (top << (2 * B - 32));
+}
+
+template<int B, int N>
+inline void UnpackBitFields(BatchMask<N>& top, BatchMask<N>& a, BatchMask<N>& b, BatchMask<N> lo, BatchMask<N> hi)
+{
+    const BatchMask<N> mask = BatchMask<N>::Set1((1 << B) - 1);
+    b = lo & mask;
+    a = (ShiftRightLogical(lo, B) | (hi << (32 - B))) & mask;
+    if_constexpr (2 * B < 32) top = ShiftRightLogical(lo, 2 * B) | (hi << (32 - 2 * B));
+    else top = ShiftRightLogical(hi, 2 * B - 32);
+}
+
+// uint32 or uint64 packed words, N lanes from/to int32 halves
+template<typename T, int N>
+inline void StorePackedWords(T* dst, BatchMask<N> lo, BatchMask<N> hi)
+{
+    if_constexpr (sizeof(T) == 4) { lo.Store((int32*)dst); return; }
+    int32 l[N], h[N];
+    lo.Store(l); hi.Store(h);
+    for (int i = 0; i < N; i++) dst[i] = T(uint64(uint32(h[i])) << 32 | uint32(l[i]));
+}
+
+template<typename T, int N>
+inline void LoadPackedWords(BatchMask<N>& lo, BatchMask<N>& hi, const T* src)
+{
+    if_constexpr (sizeof(T) == 4) { lo = BatchMask<N>::Load((const int32*)src); hi = BatchMask<N>::Zero(); return; }
+    int32 l[N], h[N];
+    for (int i = 0; i < N; i++) { l[i] = int32(uint32(src[i])); h[i] = int32(uint32(uint64(src[i]) >> 32)); }
+    lo = BatchMask<N>::Load(l); hi = BatchMask<N>::Load(h);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Smallest Three                              */
+/*//////////////////////////////////////////////////////////////////////////*/
+// largest component is dropped and made positive, other three are in [-1/sqrt2, 1/sqrt2]
+// and quantized to ComponentBits each, codes are in [0, 2^ComponentBits - 2] so zero is exact
+
+// largest component index and codes of other three components, in order
+template<int ComponentBits, int N>
+inline void QEncodeSmallestThree(BatchMask<N>& largest, BatchMask<N> codes[3], const Batch<float, N> q[4])
+{
+    typedef Batch<float, N> F;
+    typedef BatchMask<N> I;
+    const int32 M = (1 << (ComponentBits - 1)) - 1;
+
+    F best = Abs(q[0]), value = q[0];
+    largest = I::Zero();
+    for (int c = 1; c < 4; c++)
+    {
+        I greater = Abs(q[c]) > best; // first index wins when equal
+        largest = Select(largest, I::Set1(c), greater);
+        best  = Max(best, Abs(q[c]));
+        value = Select(value, q[c], greater);
+    }
+
+    I sign = AsInt(value) & I::Set1(int32(0x80000000u));
+    I is0 = largest == I::Zero(), below2 = largest < I::Set1(2), below3 = largest < I::Set1(3);
+    F c0 = Select(q[0], q[1], is0);
+    F c1 = Select(q[1], q[2], below2);
+    F c2 = Select(q[2], q[3], below3);
+
+    const F scale = F::Set1(2.0f * float(M) * Sqrt2);
+    F comps[3] = { c0, c1, c2 };
+    for (int c = 0; c < 3; c++)
+    {
+        F x = AsFloat(AsInt(comps[c]) ^ sign) * scale;
+        I r = QuantizeRoundHalf(x);
+        codes[c] = Min(Max(r, I::Set1(-M)), I::Set1(M)) + I::Set1(M);
+    }
+}
+
+template<int ComponentBits, int N>
+inline void QDecodeSmallestThree(Batch<float, N> q[4], BatchMask<N> largest, const BatchMask<N> codes[3])
+{
+    typedef Batch<float, N> F;
+    typedef BatchMask<N> I;
+    const int32 M = (1 << (ComponentBits - 1)) - 1;
+    const F scale = F::Set1(1.0f / (float(M) * Sqrt2));
+
+    // sum of squares is exact in integers (< 2^31 for 15 bits), w doesn't depend on FMA
+    I r0 = codes[0] - I::Set1(M), r1 = codes[1] - I::Set1(M), r2 = codes[2] - I::Set1(M);
+    I wSq = I::Set1(2 * M * M) - r0 * r0 - r1 * r1 - r2 * r2;
+    F w = Sqrt(ToFloat(Max(wSq, I::Zero())) * F::Set1(1.0f / float(2 * M * M)));
+    F x = ToFloat(r0) * scale, y = ToFloat(r1) * scale, z = ToFloat(r2) * scale;
+
+    I is0 = largest == I::Zero(), is1 = largest == I::Set1(1);
+    I is2 = largest == I::Set1(2), is3 = largest == I::Set1(3);
+    q[0] = Select(x, w, is0);
+    q[1] = Select(Select(y, x, is0), w, is1);
+    q[2] = Select(Select(z, y, is0 | is1), w, is2);
+    q[3] = Select(z, w, is3);
+}
+
+// packed word of 29, 32 or 48 bit encoding, 2 bit index and 9, 10 or 15 bits per component
+template<int Bits>
+using SmallestThreeType = ConditionalT<(Bits > 32), uint64, uint32>;
+
+template<int Bits, int N>
+inline int QPackSmallestThreeKernel(SmallestThreeType<Bits>* packed, const QuaternionSoA& quats, int i, int count)
+{
+    static_assert(Bits == 29 || Bits == 32 || Bits == 48, "smallest three supports 29, 32 and 48 bits");
+    constexpr int B = (Bits - 2) / 3;
+    typedef Batch<float, N> F;
+
+    for (; i + N <= count; i += N)
+    {
+        F q[4] = { F::Load(quats.x + i), F::Load(quats.y + i), F::Load(quats.z + i), F::Load(quats.w + i) };
+        BatchMask<N> largest, codes[3], lo, hi;
+        QEncodeSmallestThree<B>(largest, codes, q);
+        PackBitFields<B>(lo, hi, (largest << B) | codes[0], codes[1], codes[2]);
+        StorePackedWords(packed + i, lo, hi);
+    }
+    return i;
+}
+
+template<int Bits, int N>
+inline int QUnpackSmallestThreeKernel(const QuaternionSoA& quats, const SmallestThreeType<Bits>* packed, int i, int count)
+{
+    constexpr int B = (Bits - 2) / 3;
+    typedef Batch<float, N> F;
+
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> lo, hi, top, codes[3];
+        LoadPackedWords(lo, hi, packed + i);
+        UnpackBitFields<B>(top, codes[1], codes[2], lo, hi);
+        codes[0] = top & BatchMask<N>::Set1((1 << B) - 1);
+
+        F q[4];
+        QDecodeSmallestThree<B>(q, ShiftRightLogical(top, B), codes);
+        q[0].Store(quats.x + i); q[1].Store(quats.y + i);
+        q[2].Store(quats.z + i); q[3].Store(quats.w + i);
+    }
+    return i;
+}
+
+// Bits is 29, 32 or 48: QPackSmallestThree<32>(packed, rotations, numEntities)
+template<int Bits>
+inline void QPackSmallestThree(SmallestThreeType<Bits>* packed, const QuaternionSoA& quats, int count)
+{
+    int i = QPackSmallestThreeKernel<Bits, AX_BATCH_WIDTH>(packed, quats, 0, count);
+    QPackSmallestThreeKernel<Bits, 1>(packed, quats, i, count);
+}
+
+template<int Bits>
+inline void QUnpackSmallestThree(const QuaternionSoA& quats, const SmallestThreeType<Bits>* packed, int count)
+{
+    int i = QUnpackSmallestThreeKernel<Bits, AX_BATCH_WIDTH>(quats, packed, 0, count);
+    QUnpackSmallestThreeKernel<Bits, 1>(quats, packed, i, count);
+}
+
+template<int Bits>
+inline SmallestThreeType<Bits> QPackSmallestThree(Quaternion q)
+{
+    alignas(16) float f[4];
+    VecStore(f, q);
+    SmallestThreeType<Bits> packed;
+    QPackSmallestThreeKernel<Bits, 1>(&packed, { f, f + 1, f + 2, f + 3 }, 0, 1);
+    return packed;
+}
+
+template<int Bits>
+inline Quaternion QUnpackSmallestThree(SmallestThreeType<Bits> packed)
+{
+    float f[4];
+    QUnpackSmallestThreeKernel<Bits, 1>({ f, f + 1, f + 2, f + 3 }, &packed, 0, 1);
+    return MakeQuat(f[0], f[1], f[2], f[3]);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Positions                                 */
+/*//////////////////////////////////////////////////////////////////////////*/
+// each axis is quantized to Bits (at most 21) relative to the AABB, three axes are packed in one word.
+// steps are powers of two, precision of an axis is step / 2, positions outside of the box are clamped
+
+struct PositionQuantizer
+{
+    float min[3];
+    float step[3];    // power of two
+    float invStep[3];
+};
+
+template<int Bits>
+using PackedPositionType = ConditionalT<(Bits * 3 > 32), uint64, uint32>;
+
+// smallest power of two steps that covers the box with 2^Bits - 1 steps
+template<int Bits>
+inline PositionQuantizer MakePositionQuantizer(Vector3f min, Vector3f max)
+{
+    static_assert(Bits > 0 && Bits <= 21, "three axes has to fit in 64 bits");
+    PositionQuantizer quantizer;
+    for (int c = 0; c < 3; c++)
+    {
+        float x = MAX((max[c] - min[c]) / float((1 << Bits) - 1), 1e-30f);
+        uint32 bits = BitCast<uint32>(x);
+        if (bits & 0x7FFFFFu) bits = (bits & 0xFF800000u) + 0x800000u; // round up to power of two
+        quantizer.min[c]     = min[c];
+        quantizer.step[c]    = BitCast<float>(bits);
+        quantizer.invStep[c] = 1.0f / quantizer.step[c];
+    }
+    return quantizer;
+}
+
+template<int Bits, int N>
+inline int PackPositionsKernel(PackedPositionType<Bits>* packed, const Vector3SoA& positions, const PositionQuantizer& quantizer, int i, int count)
+{
+    typedef Batch<float, N> F;
+    const float* in[3] = { positions.x, positions.y, positions.z };
+    const F maxTwice = F::Set1(float(2 * ((1 << Bits) - 1)));
+
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> codes[3], lo, hi;
+        for (int c = 0; c < 3; c++)
+        {
+            // subtraction then one exact multiply by power of two, no fused rounding differences
+            F x = (F::Load(in[c] + i) - F::Set1(quantizer.min[c])) * F::Set1(2.0f * quantizer.invStep[c]);
+            codes[c] = QuantizeRoundHalf(Min(Max(x, F::Zero()), maxTwice));
+        }
+        PackBitFields<Bits>(lo, hi, codes[0], codes[1], codes[2]);
+        StorePackedWords(packed + i, lo, hi);
+    }
+    return i;
+}
+
+template<int Bits, int N>
+inline int UnpackPositionsKernel(const Vector3SoA& positions, const PackedPositionType<Bits>* packed, const PositionQuantizer& quantizer, int i, int count)
+{
+    typedef Batch<float, N> F;
+    float* out[3] = { positions.x, positions.y, positions.z };
+
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> codes[3], lo, hi;
+        LoadPackedWords(lo, hi, packed + i);
+        UnpackBitFields<Bits>(codes[0], codes[1], codes[2], lo, hi);
+        for (int c = 0; c < 3; c++) // code * step is exact, fused or not result is same
+            Fmadd(ToFloat(codes[c]), F::Set1(quantizer.step[c]), F::Set1(quantizer.min[c])).Store(out[c] + i);
+    }
+    return i;
+}
+
+template<int Bits>
+inline void PackPositions(PackedPositionType<Bits>* packed, const Vector3SoA& positions, const PositionQuantizer& quantizer, int count)
+{
+    int i = PackPositionsKernel<Bits, AX_BATCH_WIDTH>(packed, positions, quantizer, 0, count);
+    PackPositionsKernel<Bits, 1>(packed, positions, quantizer, i, count);
+}
+
+template<int Bits>
+inline void UnpackPositions(const Vector3SoA& positions, const PackedPositionType<Bits>* packed, const PositionQuantizer& quantizer, int count)
+{
+    int i = UnpackPositionsKernel<Bits, AX_BATCH_WIDTH>(positions, packed, quantizer, 0, count);
+    UnpackPositionsKernel<Bits, 1>(positions, packed, quantizer, i, count);
+}
+
+template<int Bits>
+inline PackedPositionType<Bits> PackPosition(Vector3f position, const PositionQuantizer& quantizer)
+{
+    PackedPositionType<Bits> packed;
+    PackPositionsKernel<Bits, 1>(&packed, { &position.x, &position.y, &position.z }, quantizer, 0, 1);
+    return packed;
+}
+
+template<int Bits>
+inline Vector3f UnpackPosition(PackedPositionType<Bits> packed, const PositionQuantizer& quantizer)
+{
+    Vector3f position;
+    UnpackPositionsKernel<Bits, 1>({ &position.x, &position.y, &position.z }, &packed, quantizer, 0, 1);
+    return position;
+}
+
+AX_END_NAMESPACE
@@ -8,6 +8,9 @@ AX_NAMESPACE
 typedef vec_t Quaternion;
 struct xyzw { float x, y, z, w; };
 
+// structure of arrays view of quaternions, used by batch functions
+struct QuaternionSoA { float* x; float* y; float* z; float* w; };
+
 #define QIdentity()  VecSetR(0.0f, 0.0f, 0.0f, 1.0f)
 #define QNorm(q)     VecNorm(q)
 #define QNormEst(q)  VecNormEst(q)
@@ -116,7 +119,7 @@ inline Quaternion VECTORCALL QSlerp(Quaternion q0, Quaternion q1, float t)
     };
 
     vec_t x = VecDot(q0, q1); // cos ( theta ) in all components
-    vec_t control = VecCmpLt(x, VecZero());
+    veci_t control = VecCmpLt(x, VecZero());
     vec_t sign = VecSelect(VecOne(), VecNegativeOne(), control);
     q1 = VecMul(sign, q1); // do mul instead of xor
 
@@ -171,35 +174,28 @@ inline Vector3f QToEulerAngles(Quaternion qu)
 
 template<int numCol = 4> // number of columns of matrix, 3 or 4
 inline void QuaternionFromMatrix(float* Orientation, const float* m) {
-    int i, j, k = 0;
-    float root, trace = m[0*numCol+0] + m[1 * numCol + 1] + m[2 * numCol + 2];
+    // same case selection with QuaternionFromMatrixSoA, all cases are selected with
+    // conditional moves instead of branching on the trace, so varying rotations doesn't mispredict
+    const float m00 = m[0 * numCol + 0], m01 = m[0 * numCol + 1], m02 = m[0 * numCol + 2];
+    const float m10 = m[1 * numCol + 0], m11 = m[1 * numCol + 1], m12 = m[1 * numCol + 2];
+    const float m20 = m[2 * numCol + 0], m21 = m[2 * numCol + 1], m22 = m[2 * numCol + 2];
+    float p01 = m01 + m10, d01 = m01 - m10;
+    float p20 = m20 + m02, d20 = m20 - m02;
+    float p12 = m12 + m21, d12 = m12 - m21;
     
-    if (trace > 0.0f)
-    {
-        root = Sqrt(trace + 1.0f);
-        Orientation[3] = 0.5f * root;
-        root = 0.5f / root;
-        Orientation[0] = root * (m[1 * numCol + 2] - m[2 * numCol + 1]);
-        Orientation[1] = root * (m[2 * numCol + 0] - m[0 * numCol + 2]);
-        Orientation[2] = root * (m[0 * numCol + 1] - m[1 * numCol + 0]);
-    }
-    else
-    {
-        static const int Next[3] = { 1, 2, 0 };
-        i = 0;
-        i += m[1 * numCol + 1] > m[0 * numCol + 0]; // if (M.m[1][1] > M.m[0][0]) i = 1
-        if (m[2 * numCol + 2] > m[i * numCol + i]) i = 2;
-        j = Next[i];
-        k = Next[j];
-        
-        root = Sqrt(m[i * numCol + i] - m[j * numCol + j] - m[k * numCol + k] + 1.0f);
-        
-        Orientation[i] = 0.5f * root;
-        root = 0.5f / root;
-        Orientation[j] = root * (m[i * numCol + j] + m[j * numCol + i]);
-        Orientation[k] = root * (m[i * numCol + k] + m[k * numCol + i]);
-        Orientation[3] = root * (m[j * numCol + k] - m[k*numCol+j]);
-    } 
+    bool neg = m22 < 0.0f, isX = m00 > m11, isZ = m00 < -m11;
+    auto Pick = [=](float x, float y, float z, float w) -> float {
+        float xy = isX ? x : y, zw = isZ ? z : w;
+        return neg ? xy : zw;
+    };
+    
+    float t = Pick(1.0f + m00 - m11 - m22, 1.0f - m00 + m11 - m22, 
+                   1.0f - m00 - m11 + m22, 1.0f + m00 + m11 + m22);
+    float s = 0.5f / Sqrt(t);
+    Orientation[0] = Pick(t, p01, p20, d12) * s;
+    Orientation[1] = Pick(p01, t, p12, d20) * s;
+    Orientation[2] = Pick(p20, p12, t, d01) * s;
+    Orientation[3] = Pick(d12, d20, d01, t) * s;
 }
 
 template<int numCol = 4> // number of columns of matrix, 3 or 4
@@ -229,6 +225,92 @@ void MatrixFromQuaternion(float* mat, Quaternion quat)
         mat[numCol * 3 + 3] = 1.0f;
 }
 
+// Structure of arrays versions of the functions above, each vec_t holds the same
+// element of 4 different matrices/quaternions. m[i][j] is row i column j.
+
+// branchless QuaternionFromMatrix, case selection from:
+// Mike Day, "Converting a Rotation Matrix to a Quaternion", Insomniac Games 2015
+// every case is computed and blended with selects, so it doesn't mispredict on varying rotations
+inline void QuaternionFromMatrixSoA(vec_t q[4], const vec_t m[3][3])
+{
+    const vec_t one = VecOne();
+    vec_t p01 = VecAdd(m[0][1], m[1][0]), d01 = VecSub(m[0][1], m[1][0]);
+    vec_t p20 = VecAdd(m[2][0], m[0][2]), d20 = VecSub(m[2][0], m[0][2]);
+    vec_t p12 = VecAdd(m[1][2], m[2][1]), d12 = VecSub(m[1][2], m[2][1]);
+    vec_t a = VecSub(m[0][0], m[1][1]); // m00 - m11
+    vec_t b = VecAdd(m[0][0], m[1][1]); // m00 + m11
+    vec_t tx = VecSub(VecAdd(one, a), m[2][2]); // 1 + m00 - m11 - m22
+    vec_t ty = VecSub(VecSub(one, a), m[2][2]); // 1 - m00 + m11 - m22
+    vec_t tz = VecAdd(VecSub(one, b), m[2][2]); // 1 - m00 - m11 + m22
+    vec_t tw = VecAdd(VecAdd(one, b), m[2][2]); // 1 + m00 + m11 + m22
+    
+    // if (m22 < 0) { if (m00 > m11) x else y } else { if (m00 < -m11) z else w }
+    veci_t neg = VecCmpLt(m[2][2], VecZero());
+    veci_t isX = VecCmpGt(m[0][0], m[1][1]);
+    veci_t isZ = VecCmpLt(m[0][0], VecNeg(m[1][1]));
+    auto Pick = [&](vec_t x, vec_t y, vec_t z, vec_t w) -> vec_t {
+        return VecSelect(VecSelect(w, z, isZ), VecSelect(y, x, isX), neg);
+    };
+    
+    vec_t t = Pick(tx, ty, tz, tw);
+    vec_t s = VecDiv(VecSet1(0.5f), VecSqrt(t));
+    q[0] = VecMul(Pick(t, p01, p20, d12), s);
+    q[1] = VecMul(Pick(p01, t, p12, d20), s);
+    q[2] = VecMul(Pick(p20, p12, t, d01), s);
+    q[3] = VecMul(Pick(d12, d20, d01, t), s);
+}
+
+// same as QuaternionFromMatrixSoA for 8 matrices, each vec8_t holds the same element of 8 matrices
+inline void QuaternionFromMatrixSoA8(vec8_t q[4], const vec8_t m[3][3])
+{
+    const vec8_t one = Vec8One();
+    vec8_t p01 = Vec8Add(m[0][1], m[1][0]), d01 = Vec8Sub(m[0][1], m[1][0]);
+    vec8_t p20 = Vec8Add(m[2][0], m[0][2]), d20 = Vec8Sub(m[2][0], m[0][2]);
+    vec8_t p12 = Vec8Add(m[1][2], m[2][1]), d12 = Vec8Sub(m[1][2], m[2][1]);
+    vec8_t a = Vec8Sub(m[0][0], m[1][1]);
+    vec8_t b = Vec8Add(m[0][0], m[1][1]);
+    vec8_t tx = Vec8Sub(Vec8Add(one, a), m[2][2]);
+    vec8_t ty = Vec8Sub(Vec8Sub(one, a), m[2][2]);
+    vec8_t tz = Vec8Add(Vec8Sub(one, b), m[2][2]);
+    vec8_t tw = Vec8Add(Vec8Add(one, b), m[2][2]);
+
+    vec8i_t neg = Vec8CmpLt(m[2][2], Vec8Zero());
+    vec8i_t isX = Vec8CmpGt(m[0][0], m[1][1]);
+    vec8i_t isZ = Vec8CmpLt(m[0][0], Vec8Neg(m[1][1]));
+    auto Pick = [&](vec8_t x, vec8_t y, vec8_t z, vec8_t w) -> vec8_t {
+        return Vec8Select(Vec8Select(w, z, isZ), Vec8Select(y, x, isX), neg);
+    };
+
+    vec8_t t = Pick(tx, ty, tz, tw);
+    vec8_t s = Vec8Div(Vec8Set1(0.5f), Vec8Sqrt(t));
+    q[0] = Vec8Mul(Pick(t, p01, p20, d12), s);
+    q[1] = Vec8Mul(Pick(p01, t, p12, d20), s);
+    q[2] = Vec8Mul(Pick(p20, p12, t, d01), s);
+    q[3] = Vec8Mul(Pick(d12, d20, d01, t), s);
+}
+
+// same layout as MatrixFromQuaternion
+inline void MatrixFromQuaternionSoA(vec_t m[3][3], const vec_t q[4])
+{
+    const vec_t one = VecOne();
+    vec_t x2 = VecAdd(q[0], q[0]), y2 = VecAdd(q[1], q[1]), z2 = VecAdd(q[2], q[2]);
+    vec_t xx = VecMul(q[0], x2), yy = VecMul(q[1], y2), zz = VecMul(q[2], z2);
+    vec_t xy = VecMul(q[0], y2), xz = VecMul(q[0], z2), yz = VecMul(q[1], z2);
+    vec_t wx = VecMul(q[3], x2), wy = VecMul(q[3], y2), wz = VecMul(q[3], z2);
+    
+    m[0][0] = VecSub(one, VecAdd(yy, zz));
+    m[0][1] = VecAdd(xy, wz);
+    m[0][2] = VecSub(xz, wy);
+    
+    m[1][0] = VecSub(xy, wz);
+    m[1][1] = VecSub(one, VecAdd(zz, xx));
+    m[1][2] = VecAdd(yz, wx);
+    
+    m[2][0] = VecAdd(xz, wy);
+    m[2][1] = VecSub(yz, wx);
+    m[2][2] = VecSub(one, VecAdd(yy, xx));
+}
+
 inline Quaternion QFromLookRotation(Vector3f direction, const Vector3f& up)
 {
     Vector3f matrix[3] = {
@@ -263,6 +345,44 @@ inline Quaternion QInverse(Quaternion q)
     }
 }
 
+enum QIntegration : int
+{
+    QIntegration_Exponential, // exact for constant angular velocity during dt
+    QIntegration_FirstOrder   // q + dt / 2 * omega * q normalized, cheaper, accurate when omega * dt is small
+};
+
+// rotates q with world space angular velocity omega (radians per second) for dt seconds
+inline Quaternion VECTORCALL QIntegrate(Quaternion q, Vector3f omega, float dt, QIntegration mode = QIntegration_Exponential)
+{
+    if (mode == QIntegration_FirstOrder)
+    {
+        vec_t delta = VecSetR(omega.x * 0.5f * dt, omega.y * 0.5f * dt, omega.z * 0.5f * dt, 1.0f);
+        return QNorm(QMul(q, delta));
+    }
+    float length = omega.Length();
+    float halfAngle = 0.5f * dt * length;
+    float s, c;
+    SinCos(halfAngle, &s, &c);
+    // sin(halfAngle) / length, taylor series when the angle is too small to divide
+    float scale = halfAngle < 1e-3f ? 0.5f * dt * (1.0f - halfAngle * halfAngle * (1.0f / 6.0f)) : s / length;
+    return QMul(q, VecSetR(omega.x * scale, omega.y * scale, omega.z * scale, c));
+}
+
+// angular velocity that rotates q0 to q1 in dt seconds over the shortest path, inverse of QIntegrate.
+// quaternions has to be normalized
+inline Vector3f VECTORCALL QAngularVelocity(Quaternion q0, Quaternion q1, float dt)
+{
+    alignas(16) xyzw d;
+    VecStore(&d.x, QMul(QConjugate(q0), q1));
+    float sign = d.w < 0.0f ? -1.0f : 1.0f;
+    float w = Abs(d.w);
+    float length = Sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+    float halfAngle = length < w ? ATan(length / w) : HalfPI - ATan(w / length);
+    float scale = length < 1e-4f ? 1.0f / w : halfAngle / length;
+    scale *= sign * 2.0f / dt;
+    return MakeVec3(d.x * scale, d.y * scale, d.z * scale);
+}
+
 inline Vector3f VECTORCALL QGetForward(Quaternion vec) {
     Vector3f res;
     Vec3Store(&res.x, QMulVec3(VecSetR( 0.0f, 0.0f, 1.0f, 0.0f), QConjugate(vec)));
@@ -0,0 +1,225 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      LSD radix sort for 32 and 64 bit keys with 8 bit digits,  *
+*      works on keys, KeyValuePair's and index permutations.     *
+*      floats and signed integers are converted to unsigned      *
+*      keys that has same order, FloatToRadixKeyArray converts   *
+*      float arrays to separate key arrays with SIMD.            *
+*   Be Aware:                                                    *
+*      caller provides temp buffer that has same size as data,   *
+*      sorted result is always written to data. elements are     *
+*      moved with memcpy, use trivially copyable types.          *
+*      sort is stable. overload RadixKey for your own types.     *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                Radix Keys                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+// keys that has the same order when compared as unsigned integers.
+// negative floats has all bits flipped, positive floats only the sign bit
+
+pureconst uint32 RadixKey(uint32 x) { return x; }
+pureconst uint64 RadixKey(uint64 x) { return x; }
+pureconst uint32 RadixKey(int32 x)  { return uint32(x) ^ 0x80000000u; }
+pureconst uint64 RadixKey(int64 x)  { return uint64(x) ^ 0x8000000000000000ull; }
+
+purefn uint32 RadixKey(float x)
+{
+    uint32 u = BitCast<uint32>(x);
+    return u ^ (uint32(int32(u) >> 31) | 0x80000000u);
+}
+
+purefn uint64 RadixKey(double x)
+{
+    uint64 u = BitCast<uint64>(x);
+    return u ^ (uint64(int64(u) >> 63) | 0x8000000000000000ull);
+}
+
+purefn float RadixKeyToFloat(uint32 key)
+{
+    return BitCast<float>(key ^ (((key >> 31u) - 1u) | 0x80000000u));
+}
+
+purefn double RadixKeyToDouble(uint64 key)
+{
+    return BitCast<double>(key ^ (((key >> 63ull) - 1ull) | 0x8000000000000000ull));
+}
+
+template<typename KeyT, typename ValueT>
+purefn auto RadixKey(const KeyValuePair<KeyT, ValueT>& pair) -> decltype(RadixKey(pair.key))
+{
+    return RadixKey(pair.key);
+}
+
+template<int N>
+purefn BatchMask<N> FloatToRadixKey(Batch<float, N> x)
+{
+    BatchMask<N> u = AsInt(x);
+    return u ^ ((u >> 31) | BatchMask<N>::Set1(int32(0x80000000u)));
+}
+
+template<int N>
+purefn Batch<float, N> RadixKeyToFloat(BatchMask<N> key)
+{
+    BatchMask<N> mask = (ShiftRightLogical(key, 31) - BatchMask<N>::Set1(1)) | BatchMask<N>::Set1(int32(0x80000000u));
+    return AsFloat(key ^ mask);
+}
+
+template<int N>
+inline int FloatToRadixKeyKernel(uint32* keys, const float* src, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        FloatToRadixKey(Batch<float, N>::Load(src + i)).Store((int32*)keys + i);
+    return i;
+}
+
+template<int N>
+inline int RadixKeyToFloatKernel(float* dst, const uint32* keys, int i, int count)
+{
+    for (; i + N <= count; i += N)
+        RadixKeyToFloat(BatchMask<N>::Load((const int32*)keys + i)).Store(dst + i);
+    return i;
+}
+
+inline void FloatToRadixKeyArray(uint32* keys, const float* src, int count)
+{
+    int i = FloatToRadixKeyKernel<AX_BATCH_WIDTH>(keys, src, 0, count);
+    FloatToRadixKeyKernel<1>(keys, src, i, count);
+}
+
+inline void RadixKeyToFloatArray(float* dst, const uint32* keys, int count)
+{
+    int i = RadixKeyToFloatKernel<AX_BATCH_WIDTH>(dst, keys, 0, count);
+    RadixKeyToFloatKernel<1>(dst, keys, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                           Histogram & Scatter                            */
+/*//////////////////////////////////////////////////////////////////////////*/
+// building blocks for multi threaded sorting, for each pass:
+// 1. every thread counts its own chunk:   RadixHistogram(histograms + thread * 256, chunk, chunkCount, pass)
+// 2. after all threads finished:          RadixOffsets(histograms, numThreads)
+// 3. every thread writes its own chunk:   RadixScatter(dst, chunk, chunkCount, histograms + thread * 256, pass)
+// 4. swap src and dst, chunks has to be in order of thread index to keep the sort stable
+
+constexpr int RadixNumBuckets = 256;
+
+template<typename T>
+inline void RadixHistogram(uint32* histogram, const T* data, int count, int pass)
+{
+    const int shift = pass * 8;
+    MemsetZero(histogram, sizeof(uint32) * RadixNumBuckets);
+    for (int i = 0; i < count; i++)
+        histogram[(RadixKey(data[i]) >> shift) & 0xFF]++;
+}
+
+// converts per thread counts into write positions, thread t writes after threads [0, t) for each digit
+inline void RadixOffsets(uint32* histograms, int numThreads)
+{
+    uint32 sum = 0;
+    for (int d = 0; d < RadixNumBuckets; d++)
+    {
+        for (int t = 0; t < numThreads; t++)
+        {
+            uint32 c = histograms[t * RadixNumBuckets + d];
+            histograms[t * RadixNumBuckets + d] = sum;
+            sum += c;
+        }
+    }
+}
+
+template<typename T>
+inline void RadixScatter(T* dst, const T* src, int count, uint32* offsets, int pass)
+{
+    const int shift = pass * 8;
+    for (int i = 0; i < count; i++)
+        dst[offsets[(RadixKey(src[i]) >> shift) & 0xFF]++] = src[i];
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                   Sort                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// counts all digits in one pass over the data, passes where every key has the same digit are skipped.
+// floats are sorted with RadixKey(float) per element, float storage is never accessed as integers
+template<typename T>
+inline void RadixSort(T* data, T* temp, int count)
+{
+    typedef decltype(RadixKey(*data)) KeyT;
+    constexpr int NumPasses = sizeof(KeyT);
+    if (count < 2) return;
+
+    uint32 histograms[NumPasses][RadixNumBuckets];
+    MemsetZero(histograms, sizeof(histograms));
+
+    for (int i = 0; i < count; i++)
+    {
+        KeyT key = RadixKey(data[i]);
+        for (int p = 0; p < NumPasses; p++)
+            histograms[p][(key >> (p * 8)) & 0xFF]++;
+    }
+
+    T* src = data, *dst = temp;
+    for (int p = 0; p < NumPasses; p++)
+    {
+        uint32* offsets = histograms[p];
+        if (offsets[(RadixKey(src[0]) >> (p * 8)) & 0xFF] == uint32(count))
+            continue;
+
+        RadixOffsets(offsets, 1);
+        RadixScatter(dst, src, count, offsets, p);
+        T* t = src; src = dst; dst = t;
+    }
+
+    if (src != data)
+        SmallMemCpy(data, src, sizeof(T) * count);
+}
+
+// writes indices that sorts keys, keys are not modified. indices and temp has count elements
+template<typename KeyT>
+inline void RadixSortIndices(uint32* indices, uint32* temp, const KeyT* keys, int count)
+{
+    typedef decltype(RadixKey(*keys)) RadixT;
+    constexpr int NumPasses = sizeof(RadixT);
+
+    for (int i = 0; i < count; i++) indices[i] = uint32(i);
+    if (count < 2) return;
+
+    uint32 histograms[NumPasses][RadixNumBuckets];
+    MemsetZero(histograms, sizeof(histograms));
+
+    for (int i = 0; i < count; i++)
+    {
+        RadixT key = RadixKey(keys[i]);
+        for (int p = 0; p < NumPasses; p++)
+            histograms[p][(key >> (p * 8)) & 0xFF]++;
+    }
+
+    uint32* src = indices, *dst = temp;
+    for (int p = 0; p < NumPasses; p++)
+    {
+        const int shift = p * 8;
+        uint32* offsets = histograms[p];
+        if (offsets[(RadixKey(keys[0]) >> shift) & 0xFF] == uint32(count))
+            continue;
+
+        RadixOffsets(offsets, 1);
+        for (int i = 0; i < count; i++)
+            dst[offsets[(RadixKey(keys[src[i]]) >> shift) & 0xFF]++] = src[i];
+
+        uint32* t = src; src = dst; dst = t;
+    }
+
+    if (src != indices)
+        SmallMemCpy(indices, src, sizeof(uint32) * count);
+}
+
+AX_END_NAMESPACE
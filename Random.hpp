@@ -0,0 +1,326 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      xoshiro128** random number generator. Xoshiro128 is the   *
+*      scalar one, RandomBatch<N> has one state per lane and     *
+*      generates 4, 8 or 16 numbers per call.                    *
+*      uniform, normal, sphere, hemisphere and disk samples      *
+*      that are written directly into arrays.                    *
+*   Be Aware:                                                    *
+*      lanes of RandomBatch are 2^64 steps apart from each       *
+*      other, call LongJump (2^96 steps) n times for n'th thread *
+*      so every thread has its own stream.                       *
+*      not cryptographically secure.                             *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Scalar                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// used for seeding, every seed gives a different well mixed value
+inline uint64 SplitMix64(uint64* state)
+{
+    uint64 z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30ull)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27ull)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31ull);
+}
+
+pureconst uint32 RandomRotl(uint32 x, int k) { return (x << k) | (x >> (32 - k)); }
+
+// jump polynomials, equivalent to 2^64 and 2^96 calls to Next
+constexpr uint32 RandomJumpTable[4]     = { 0x8764000bu, 0xf542d2d3u, 0x6fa035c3u, 0x77f2db5bu };
+constexpr uint32 RandomLongJumpTable[4] = { 0xb523952eu, 0x0b6f099fu, 0xccf5a0efu, 0x1c580662u };
+
+// https://prng.di.unimi.it/xoshiro128starstar.c
+struct Xoshiro128
+{
+    uint32 s[4];
+
+    static Xoshiro128 FromSeed(uint64 seed)
+    {
+        Xoshiro128 r;
+        uint64 a = SplitMix64(&seed), b = SplitMix64(&seed);
+        r.s[0] = uint32(a); r.s[1] = uint32(a >> 32ull);
+        r.s[2] = uint32(b); r.s[3] = uint32(b >> 32ull);
+        return r;
+    }
+
+    uint32 Next()
+    {
+        const uint32 result = RandomRotl(s[1] * 5u, 7) * 9u;
+        const uint32 t = s[1] << 9u;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = RandomRotl(s[3], 11);
+        return result;
+    }
+
+    // [0, 1) with 24 bit precision
+    float NextFloat() { return float(Next() >> 8u) * (1.0f / 16777216.0f); }
+
+    float NextFloat(float min, float max) { return min + NextFloat() * (max - min); }
+
+    // [min, max) without modulo bias
+    int NextInt(int min, int max) { return min + int((uint64(Next()) * uint64(max - min)) >> 32ull); }
+
+    void Jump()     { JumpWith(RandomJumpTable); }
+    void LongJump() { JumpWith(RandomLongJumpTable); }
+
+    void JumpWith(const uint32* table)
+    {
+        uint32 t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 32; b++)
+        {
+            if (table[i] & (1u << b))
+            {
+                t[0] ^= s[0]; t[1] ^= s[1];
+                t[2] ^= s[2]; t[3] ^= s[3];
+            }
+            Next();
+        }
+        s[0] = t[0]; s[1] = t[1]; s[2] = t[2]; s[3] = t[3];
+    }
+};
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Batch                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N>
+struct RandomBatch
+{
+    BatchMask<N> s0, s1, s2, s3;
+
+    // lane i starts from the seeded state jumped i times, lane 0 produces same sequence with Xoshiro128
+    static RandomBatch FromSeed(uint64 seed)
+    {
+        Xoshiro128 r = Xoshiro128::FromSeed(seed);
+        int32 a[N], b[N], c[N], d[N];
+        for (int i = 0; i < N; i++)
+        {
+            a[i] = int32(r.s[0]); b[i] = int32(r.s[1]);
+            c[i] = int32(r.s[2]); d[i] = int32(r.s[3]);
+            r.Jump();
+        }
+        RandomBatch rb;
+        rb.s0 = BatchMask<N>::Load(a); rb.s1 = BatchMask<N>::Load(b);
+        rb.s2 = BatchMask<N>::Load(c); rb.s3 = BatchMask<N>::Load(d);
+        return rb;
+    }
+
+    static BatchMask<N> Rotl(BatchMask<N> x, int k) { return (x << k) | ShiftRightLogical(x, 32 - k); }
+
+    BatchMask<N> NextUInt()
+    {
+        BatchMask<N> x5 = s1 + (s1 << 2); // * 5
+        BatchMask<N> r  = Rotl(x5, 7);
+        BatchMask<N> result = r + (r << 3); // * 9
+        BatchMask<N> t = s1 << 9;
+        s2 = s2 ^ s0;
+        s3 = s3 ^ s1;
+        s1 = s1 ^ s2;
+        s0 = s0 ^ s3;
+        s2 = s2 ^ t;
+        s3 = Rotl(s3, 11);
+        return result;
+    }
+
+    // [0, 1)
+    Batch<float, N> NextFloat()
+    {
+        return ToFloat(ShiftRightLogical(NextUInt(), 8)) * Batch<float, N>::Set1(1.0f / 16777216.0f);
+    }
+
+    void Jump()     { JumpWith(RandomJumpTable); }
+    void LongJump() { JumpWith(RandomLongJumpTable); }
+
+    void JumpWith(const uint32* table)
+    {
+        BatchMask<N> t0 = BatchMask<N>::Zero(), t1 = t0, t2 = t0, t3 = t0;
+        for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 32; b++)
+        {
+            if (table[i] & (1u << b))
+            {
+                t0 = t0 ^ s0; t1 = t1 ^ s1;
+                t2 = t2 ^ s2; t3 = t3 ^ s3;
+            }
+            NextUInt();
+        }
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+};
+
+typedef RandomBatch<AX_BATCH_WIDTH> RandomStream;
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Distributions                               */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// uniform angle in [-PI, PI)
+template<int N>
+inline Batch<float, N> RandomAngle(RandomBatch<N>& rng)
+{
+    typedef Batch<float, N> F;
+    return Fmadd(rng.NextFloat(), F::Set1(TwoPI), F::Set1(-PI));
+}
+
+// Box-Muller, returns two independent standard normal numbers
+template<int N>
+inline Batch<float, N> RandomNormal(RandomBatch<N>& rng, Batch<float, N>* second)
+{
+    typedef Batch<float, N> F;
+    F u = F::Set1(1.0f) - rng.NextFloat(); // (0, 1] so log is finite
+    F r = Sqrt(F::Set1(-2.0f) * Log(u));
+    F c, s = SinCos(&c, RandomAngle(rng));
+    *second = r * s;
+    return r * c;
+}
+
+template<int N>
+inline void RandomInDisk(RandomBatch<N>& rng, Batch<float, N>* x, Batch<float, N>* y)
+{
+    Batch<float, N> r = Sqrt(rng.NextFloat());
+    Batch<float, N> c, s = SinCos(&c, RandomAngle(rng));
+    *x = r * c;
+    *y = r * s;
+}
+
+template<int N>
+inline void RandomOnSphere(RandomBatch<N>& rng, Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z)
+{
+    typedef Batch<float, N> F;
+    F h = Fmadd(rng.NextFloat(), F::Set1(2.0f), F::Set1(-1.0f));
+    F r = Sqrt(Max(F::Set1(1.0f) - h * h, F::Zero()));
+    F c, s = SinCos(&c, RandomAngle(rng));
+    *x = r * c;
+    *y = r * s;
+    *z = h;
+}
+
+// uniform on the hemisphere around +Z
+template<int N>
+inline void RandomOnHemisphere(RandomBatch<N>& rng, Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z)
+{
+    typedef Batch<float, N> F;
+    F h = rng.NextFloat();
+    F r = Sqrt(Max(F::Set1(1.0f) - h * h, F::Zero()));
+    F c, s = SinCos(&c, RandomAngle(rng));
+    *x = r * c;
+    *y = r * s;
+    *z = h;
+}
+
+// cosine weighted around +Z, pdf is cos(theta) / PI. for diffuse light baking
+template<int N>
+inline void RandomCosineHemisphere(RandomBatch<N>& rng, Batch<float, N>* x, Batch<float, N>* y, Batch<float, N>* z)
+{
+    typedef Batch<float, N> F;
+    F u = rng.NextFloat();
+    F r = Sqrt(u);
+    F c, s = SinCos(&c, RandomAngle(rng));
+    *x = r * c;
+    *y = r * s;
+    *z = Sqrt(F::Set1(1.0f) - u);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Arrays                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// last iteration generates a full batch and writes only the remaining elements,
+// so the stream advances the same amount no matter what the count is
+
+template<int N>
+inline void RandomStoreTail(float* dst, Batch<float, N> x, int count)
+{
+    float tmp[N];
+    x.Store(tmp);
+    SmallMemCpy(dst, tmp, sizeof(float) * count);
+}
+
+inline void RandomUniformArray(float* dst, int count, RandomStream& rng, float min = 0.0f, float max = 1.0f)
+{
+    typedef Batch<float, AX_BATCH_WIDTH> F;
+    const F vmin = F::Set1(min), range = F::Set1(max - min);
+    for (int i = 0; i < count; i += AX_BATCH_WIDTH)
+    {
+        F x = Fmadd(rng.NextFloat(), range, vmin);
+        if (i + AX_BATCH_WIDTH <= count) x.Store(dst + i);
+        else RandomStoreTail(dst + i, x, count - i);
+    }
+}
+
+inline void RandomNormalArray(float* dst, int count, RandomStream& rng, float mean = 0.0f, float stddev = 1.0f)
+{
+    typedef Batch<float, AX_BATCH_WIDTH> F;
+    const F vmean = F::Set1(mean), vstd = F::Set1(stddev);
+    for (int i = 0; i < count; i += AX_BATCH_WIDTH * 2)
+    {
+        F b, a = RandomNormal(rng, &b);
+        a = Fmadd(a, vstd, vmean);
+        b = Fmadd(b, vstd, vmean);
+        int remaining = count - i;
+        if (remaining >= AX_BATCH_WIDTH * 2) { a.Store(dst + i); b.Store(dst + i + AX_BATCH_WIDTH); }
+        else if (remaining > AX_BATCH_WIDTH) { a.Store(dst + i); RandomStoreTail(dst + i + AX_BATCH_WIDTH, b, remaining - AX_BATCH_WIDTH); }
+        else RandomStoreTail(dst + i, a, remaining);
+    }
+}
+
+inline void RandomInDiskArray(Vector2SoA dst, int count, RandomStream& rng, float radius = 1.0f)
+{
+    typedef Batch<float, AX_BATCH_WIDTH> F;
+    for (int i = 0; i < count; i += AX_BATCH_WIDTH)
+    {
+        F x, y;
+        RandomInDisk(rng, &x, &y);
+        x = x * F::Set1(radius);
+        y = y * F::Set1(radius);
+        if (i + AX_BATCH_WIDTH <= count) { x.Store(dst.x + i); y.Store(dst.y + i); }
+        else { RandomStoreTail(dst.x + i, x, count - i); RandomStoreTail(dst.y + i, y, count - i); }
+    }
+}
+
+template<void(*SampleFn)(RandomStream&, Batch<float, AX_BATCH_WIDTH>*, Batch<float, AX_BATCH_WIDTH>*, Batch<float, AX_BATCH_WIDTH>*)>
+inline void RandomDirectionArray(Vector3SoA dst, int count, RandomStream& rng)
+{
+    typedef Batch<float, AX_BATCH_WIDTH> F;
+    for (int i = 0; i < count; i += AX_BATCH_WIDTH)
+    {
+        F x, y, z;
+        SampleFn(rng, &x, &y, &z);
+        if (i + AX_BATCH_WIDTH <= count) { x.Store(dst.x + i); y.Store(dst.y + i); z.Store(dst.z + i); }
+        else
+        {
+            RandomStoreTail(dst.x + i, x, count - i);
+            RandomStoreTail(dst.y + i, y, count - i);
+            RandomStoreTail(dst.z + i, z, count - i);
+        }
+    }
+}
+
+inline void RandomOnSphereArray(Vector3SoA dst, int count, RandomStream& rng) {
+    RandomDirectionArray<RandomOnSphere<AX_BATCH_WIDTH>>(dst, count, rng);
+}
+
+inline void RandomOnHemisphereArray(Vector3SoA dst, int count, RandomStream& rng) {
+    RandomDirectionArray<RandomOnHemisphere<AX_BATCH_WIDTH>>(dst, count, rng);
+}
+
+inline void RandomCosineHemisphereArray(Vector3SoA dst, int count, RandomStream& rng) {
+    RandomDirectionArray<RandomCosineHemisphere<AX_BATCH_WIDTH>>(dst, count, rng);
+}
+
+AX_END_NAMESPACE
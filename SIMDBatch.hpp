@@ -0,0 +1,553 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Width generic wrapper over SIMDVectorMath macros,         *
+*      Batch<float, N> and Batch<int32, N> lets you write a      *
+*      kernel once and instantiate it for 1, 4, 8, 16 lanes.     *
+*      widths that has no native register falls back to plain   *
+*      loops over arrays, compiler auto vectorizes them.         *
+*   Be Aware:                                                    *
+*      unlike Vec* macros these are functions and operators,     *
+*      in debug builds they compile down to call instructions,   *
+*      use them for array kernels that runs optimized.           *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDVectorMath.hpp"
+
+AX_NAMESPACE
+
+// widest batch that maps to single register on this target
+#if defined(AX_SUPPORT_AVX512)
+    #define AX_BATCH_WIDTH 16
+#elif defined(AX_SUPPORT_AVX2)
+    #define AX_BATCH_WIDTH 8
+#else
+    #define AX_BATCH_WIDTH 4
+#endif
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Generic                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<typename T, int N>
+struct Batch
+{
+    T v[N];
+
+    static constexpr int Width = N;
+
+    static Batch Set1(T x)
+    {
+        Batch r;
+        for (int i = 0; i < N; i++) r.v[i] = x;
+        return r;
+    }
+
+    static Batch Zero() { return Set1(T(0)); }
+
+    static Batch Load(const T* x)
+    {
+        Batch r;
+        SmallMemCpy(r.v, x, sizeof(T) * N);
+        return r;
+    }
+
+    static Batch LoadA(const T* x) { return Load(x); }
+
+    void Store(T* ptr) const { SmallMemCpy(ptr, v, sizeof(T) * N); }
+    void StoreA(T* ptr) const { Store(ptr); }
+};
+
+// lanes of the masks are all ones when true, zero otherwise
+template<int N> using BatchMask = Batch<int32, N>;
+
+#define AX_BATCH_LOOP(N, expr) for (int i = 0; i < N; i++) r.v[i] = expr
+
+template<typename T, int N> purefn Batch<T, N> operator + (Batch<T, N> a, Batch<T, N> b) { Batch<T, N> r; AX_BATCH_LOOP(N, a.v[i] + b.v[i]); return r; }
+template<typename T, int N> purefn Batch<T, N> operator - (Batch<T, N> a, Batch<T, N> b) { Batch<T, N> r; AX_BATCH_LOOP(N, a.v[i] - b.v[i]); return r; }
+template<typename T, int N> purefn Batch<T, N> operator * (Batch<T, N> a, Batch<T, N> b) { Batch<T, N> r; AX_BATCH_LOOP(N, a.v[i] * b.v[i]); return r; }
+template<int N> purefn BatchMask<N> operator * (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, int32(uint32(a.v[i]) * uint32(b.v[i]))); return r; } // wraps like mullo
+template<int N> purefn Batch<float, N> operator / (Batch<float, N> a, Batch<float, N> b) { Batch<float, N> r; AX_BATCH_LOOP(N, a.v[i] / b.v[i]); return r; }
+template<int N> purefn Batch<float, N> operator - (Batch<float, N> a) { Batch<float, N> r; AX_BATCH_LOOP(N, -a.v[i]); return r; }
+
+template<int N> purefn BatchMask<N> operator <  (Batch<float, N> a, Batch<float, N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] <  b.v[i])); return r; }
+template<int N> purefn BatchMask<N> operator <= (Batch<float, N> a, Batch<float, N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] <= b.v[i])); return r; }
+template<int N> purefn BatchMask<N> operator >  (Batch<float, N> a, Batch<float, N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] >  b.v[i])); return r; }
+template<int N> purefn BatchMask<N> operator >= (Batch<float, N> a, Batch<float, N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] >= b.v[i])); return r; }
+
+template<int N> purefn BatchMask<N> operator & (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] & b.v[i]); return r; }
+template<int N> purefn BatchMask<N> operator | (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] | b.v[i]); return r; }
+template<int N> purefn BatchMask<N> operator ^ (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] ^ b.v[i]); return r; }
+template<int N> purefn BatchMask<N> operator ~ (BatchMask<N> a) { BatchMask<N> r; AX_BATCH_LOOP(N, ~a.v[i]); return r; }
+template<int N> purefn BatchMask<N> operator << (BatchMask<N> a, int n) { BatchMask<N> r; AX_BATCH_LOOP(N, int32(uint32(a.v[i]) << n)); return r; }
+template<int N> purefn BatchMask<N> operator >> (BatchMask<N> a, int n) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] >> n); return r; } // fills with sign bit
+template<int N> purefn BatchMask<N> ShiftRightLogical(BatchMask<N> a, int n) { BatchMask<N> r; AX_BATCH_LOOP(N, int32(uint32(a.v[i]) >> n)); return r; }
+
+template<int N> purefn BatchMask<N> operator == (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] == b.v[i])); return r; }
+template<int N> purefn BatchMask<N> operator <  (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] <  b.v[i])); return r; }
+template<int N> purefn BatchMask<N> operator >  (BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, -int32(a.v[i] >  b.v[i])); return r; }
+template<int N> purefn BatchMask<N> Min(BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] < b.v[i] ? a.v[i] : b.v[i]); return r; }
+template<int N> purefn BatchMask<N> Max(BatchMask<N> a, BatchMask<N> b) { BatchMask<N> r; AX_BATCH_LOOP(N, a.v[i] > b.v[i] ? a.v[i] : b.v[i]); return r; }
+template<int N> purefn BatchMask<N> Select(BatchMask<N> a, BatchMask<N> b, BatchMask<N> mask) { BatchMask<N> r; AX_BATCH_LOOP(N, mask.v[i] ? b.v[i] : a.v[i]); return r; }
+
+// fused per lane with scalar Fmadd, so results are same with the SIMD versions
+template<int N> purefn Batch<float, N> Fmadd(Batch<float, N> a, Batch<float, N> b, Batch<float, N> c) { Batch<float, N> r; AX_BATCH_LOOP(N, Fmadd(a.v[i], b.v[i], c.v[i])); return r; }
+template<int N> purefn Batch<float, N> Fmsub(Batch<float, N> a, Batch<float, N> b, Batch<float, N> c) { Batch<float, N> r; AX_BATCH_LOOP(N, Fmadd(a.v[i], b.v[i], -c.v[i])); return r; }
+template<int N> purefn Batch<float, N> Min(Batch<float, N> a, Batch<float, N> b) { Batch<float, N> r; AX_BATCH_LOOP(N, a.v[i] < b.v[i] ? a.v[i] : b.v[i]); return r; }
+template<int N> purefn Batch<float, N> Max(Batch<float, N> a, Batch<float, N> b) { Batch<float, N> r; AX_BATCH_LOOP(N, a.v[i] > b.v[i] ? a.v[i] : b.v[i]); return r; }
+template<int N> purefn Batch<float, N> Abs(Batch<float, N> a)   { Batch<float, N> r; AX_BATCH_LOOP(N, Abs(a.v[i])); return r; }
+template<int N> purefn Batch<float, N> Sqrt(Batch<float, N> a)  { Batch<float, N> r; AX_BATCH_LOOP(N, Sqrt(a.v[i])); return r; }
+template<int N> purefn Batch<float, N> Rcp(Batch<float, N> a)   { Batch<float, N> r; AX_BATCH_LOOP(N, 1.0f / a.v[i]); return r; }
+template<int N> purefn Batch<float, N> Floor(Batch<float, N> a) { Batch<float, N> r; AX_BATCH_LOOP(N, Floor(a.v[i])); return r; }
+template<int N> purefn Batch<float, N> CopySign(Batch<float, N> a, Batch<float, N> b) { Batch<float, N> r; AX_BATCH_LOOP(N, CopySign(a.v[i], b.v[i])); return r; }
+
+// mask ? b : a same as VecSelect
+template<int N> purefn Batch<float, N> Select(Batch<float, N> a, Batch<float, N> b, BatchMask<N> mask) { Batch<float, N> r; AX_BATCH_LOOP(N, mask.v[i] ? b.v[i] : a.v[i]); return r; }
+
+template<int N> purefn BatchMask<N> AsInt(Batch<float, N> a)   { BatchMask<N> r; AX_BATCH_LOOP(N, BitCast<int32>(a.v[i])); return r; }
+template<int N> purefn Batch<float, N> AsFloat(BatchMask<N> a) { Batch<float, N> r; AX_BATCH_LOOP(N, BitCast<float>(a.v[i])); return r; }
+template<int N> purefn BatchMask<N> ToInt(Batch<float, N> a)   { BatchMask<N> r; AX_BATCH_LOOP(N, (int32)a.v[i]); return r; } // truncates
+template<int N> purefn Batch<float, N> ToFloat(BatchMask<N> a) { Batch<float, N> r; AX_BATCH_LOOP(N, (float)a.v[i]); return r; }
+
+template<int N> purefn int Movemask(BatchMask<N> a)
+{
+    int r = 0; // only first 32 lanes are represented
+    for (int i = 0; i < N && i < 32; i++) r |= int(uint32(a.v[i]) >> 31) << i;
+    return r;
+}
+
+// base[idx[i] * Stride] for each lane, Stride is in floats
+template<int Stride = 1, int N = 1>
+inline Batch<float, N> Gather(const float* base, BatchMask<N> idx)
+{
+    Batch<float, N> r;
+    for (int i = 0; i < N; i++) r.v[i] = base[idx.v[i] * Stride];
+    return r;
+}
+
+// loads N uint16 and zero extends them to int32 lanes, used for decoding quantized data
+template<int N>
+inline BatchMask<N> LoadU16(const uint16* ptr)
+{
+    BatchMask<N> r;
+    for (int i = 0; i < N; i++) r.v[i] = int32(ptr[i]);
+    return r;
+}
+
+// writes lanes that has mask set to consecutive elements of dst, returns number of written lanes.
+// wide versions may write up to N floats, only the first returned count are meaningful.
+// in place stream compaction is safe as long as dst <= source of x
+template<int N>
+inline int CompressStore(float* dst, Batch<float, N> x, BatchMask<N> mask)
+{
+    static_assert(N <= 32, "mask bits are limited to 32 lanes");
+    float lanes[N];
+    x.Store(lanes);
+    int n = 0;
+    for (uint32 bits = uint32(Movemask(mask)); bits; bits &= bits - 1)
+        dst[n++] = lanes[TrailingZeroCount32(bits)];
+    return n;
+}
+
+#undef AX_BATCH_LOOP
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 4 Wide                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// operators that has the same implementation on every register width,
+// N is width, P is prefix of the float macros (Vec, Vec8), I is prefix of integer macros (Veci, Vec8i)
+// MASK converts comparison result to integer register, CONTROL converts integer register to select control
+#define AX_BATCH_IDENTITY(x) (x)
+#define AX_BATCH_OPS(N, P, I, MASK, CONTROL)                                                                                                     \
+purefn Batch<float, N> VECTORCALL operator + (Batch<float, N> a, Batch<float, N> b) { return { P##Add(a.v, b.v) }; }                        \
+purefn Batch<float, N> VECTORCALL operator - (Batch<float, N> a, Batch<float, N> b) { return { P##Sub(a.v, b.v) }; }                        \
+purefn Batch<float, N> VECTORCALL operator * (Batch<float, N> a, Batch<float, N> b) { return { P##Mul(a.v, b.v) }; }                        \
+purefn Batch<float, N> VECTORCALL operator / (Batch<float, N> a, Batch<float, N> b) { return { P##Div(a.v, b.v) }; }                        \
+purefn Batch<float, N> VECTORCALL operator - (Batch<float, N> a) { return { P##Neg(a.v) }; }                                                \
+purefn BatchMask<N> VECTORCALL operator <  (Batch<float, N> a, Batch<float, N> b) { return { MASK(P##CmpLt(a.v, b.v)) }; }                  \
+purefn BatchMask<N> VECTORCALL operator <= (Batch<float, N> a, Batch<float, N> b) { return { MASK(P##CmpLe(a.v, b.v)) }; }                  \
+purefn BatchMask<N> VECTORCALL operator >  (Batch<float, N> a, Batch<float, N> b) { return { MASK(P##CmpGt(a.v, b.v)) }; }                  \
+purefn BatchMask<N> VECTORCALL operator >= (Batch<float, N> a, Batch<float, N> b) { return { MASK(P##CmpGe(a.v, b.v)) }; }                  \
+purefn BatchMask<N> VECTORCALL operator + (BatchMask<N> a, BatchMask<N> b) { return { I##Add(a.v, b.v) }; }                                 \
+purefn BatchMask<N> VECTORCALL operator - (BatchMask<N> a, BatchMask<N> b) { return { I##Sub(a.v, b.v) }; }                                 \
+purefn BatchMask<N> VECTORCALL operator & (BatchMask<N> a, BatchMask<N> b) { return { I##And(a.v, b.v) }; }                                 \
+purefn BatchMask<N> VECTORCALL operator | (BatchMask<N> a, BatchMask<N> b) { return { I##Or(a.v, b.v) }; }                                  \
+purefn BatchMask<N> VECTORCALL operator ^ (BatchMask<N> a, BatchMask<N> b) { return { I##Xor(a.v, b.v) }; }                                 \
+purefn BatchMask<N> VECTORCALL operator ~ (BatchMask<N> a) { return { I##Xor(a.v, I##Set1(~0)) }; }                                         \
+purefn BatchMask<N> VECTORCALL operator * (BatchMask<N> a, BatchMask<N> b) { return { I##Mul(a.v, b.v) }; }                                 \
+purefn BatchMask<N> VECTORCALL operator << (BatchMask<N> a, int n) { return { I##Sll(a.v, n) }; }                                           \
+purefn BatchMask<N> VECTORCALL operator >> (BatchMask<N> a, int n) { return { I##Sra(a.v, n) }; }                                           \
+purefn BatchMask<N> VECTORCALL ShiftRightLogical(BatchMask<N> a, int n) { return { I##Srl(a.v, n) }; }                                      \
+purefn BatchMask<N> VECTORCALL operator == (BatchMask<N> a, BatchMask<N> b) { return { MASK(I##CmpEq(a.v, b.v)) }; }                        \
+purefn BatchMask<N> VECTORCALL operator <  (BatchMask<N> a, BatchMask<N> b) { return { MASK(I##CmpLt(a.v, b.v)) }; }                        \
+purefn BatchMask<N> VECTORCALL operator >  (BatchMask<N> a, BatchMask<N> b) { return { MASK(I##CmpGt(a.v, b.v)) }; }                        \
+purefn BatchMask<N> VECTORCALL Min(BatchMask<N> a, BatchMask<N> b) { return { I##Min(a.v, b.v) }; }                                         \
+purefn BatchMask<N> VECTORCALL Max(BatchMask<N> a, BatchMask<N> b) { return { I##Max(a.v, b.v) }; }                                         \
+purefn BatchMask<N> VECTORCALL Select(BatchMask<N> a, BatchMask<N> b, BatchMask<N> mask) { return { I##Select(a.v, b.v, CONTROL(mask.v)) }; } \
+template<int Stride = 1> inline Batch<float, N> VECTORCALL Gather(const float* base, BatchMask<N> idx) {                                    \
+    return { P##Gather(base, Stride == 1 ? idx.v : I##Mul(idx.v, I##Set1(Stride))) };                                                        \
+}                                                                                                                                            \
+purefn Batch<float, N> VECTORCALL Fmadd(Batch<float, N> a, Batch<float, N> b, Batch<float, N> c) { return { P##Fmadd(a.v, b.v, c.v) }; }    \
+purefn Batch<float, N> VECTORCALL Fmsub(Batch<float, N> a, Batch<float, N> b, Batch<float, N> c) { return { P##Fmsub(a.v, b.v, c.v) }; }    \
+purefn Batch<float, N> VECTORCALL Min(Batch<float, N> a, Batch<float, N> b) { return { P##Min(a.v, b.v) }; }                                \
+purefn Batch<float, N> VECTORCALL Max(Batch<float, N> a, Batch<float, N> b) { return { P##Max(a.v, b.v) }; }                                \
+purefn Batch<float, N> VECTORCALL Sqrt(Batch<float, N> a)  { return { P##Sqrt(a.v) }; }                                                     \
+purefn Batch<float, N> VECTORCALL Rcp(Batch<float, N> a)   { return { P##Rcp(a.v) }; } /* approximate on x86 */                             \
+purefn Batch<float, N> VECTORCALL Floor(Batch<float, N> a) { return { P##Floor(a.v) }; }                                                    \
+purefn Batch<float, N> VECTORCALL Select(Batch<float, N> a, Batch<float, N> b, BatchMask<N> mask) { return { P##Select(a.v, b.v, CONTROL(mask.v)) }; } \
+purefn BatchMask<N> VECTORCALL ToInt(Batch<float, N> a)   { return { P##CvtF32I32(a.v) }; }                                                 \
+purefn Batch<float, N> VECTORCALL ToFloat(BatchMask<N> a) { return { P##CvtI32F32(a.v) }; }                                                 \
+purefn int VECTORCALL Movemask(BatchMask<N> a) { return P##Movemask(CONTROL(a.v)); }                                                        \
+purefn Batch<float, N> VECTORCALL Abs(Batch<float, N> a) { return AsFloat(AsInt(a) & BatchMask<N>::Set1(0x7fffffff)); }                     \
+purefn Batch<float, N> VECTORCALL CopySign(Batch<float, N> a, Batch<float, N> b) {                                                          \
+    return AsFloat((AsInt(a) & BatchMask<N>::Set1(0x7fffffff)) | (AsInt(b) & BatchMask<N>::Set1(int32(0x80000000u))));                        \
+}
+
+#if defined(AX_SUPPORT_SSE) || defined(AX_ARM)
+
+template<>
+struct Batch<float, 4>
+{
+    vec_t v;
+
+    static constexpr int Width = 4;
+
+    static Batch Set1(float x)        { return { VecSet1(x) }; }
+    static Batch Zero()               { return { VecZero() }; }
+    static Batch Load(const float* x)  { return { VecLoad(x) }; }
+    static Batch LoadA(const float* x) { return { VecLoadA(x) }; }
+
+    void Store(float* ptr) const  { VecStoreU(ptr, v); }
+    void StoreA(float* ptr) const { VecStore(ptr, v); }
+};
+
+template<>
+struct Batch<int32, 4>
+{
+    veci_t v;
+
+    static constexpr int Width = 4;
+
+    static Batch Set1(int32 x)        { return { VeciSet1(x) }; }
+    static Batch Zero()               { return { VeciSet1(0) }; }
+    static Batch Load(const int32* x)  { return { VeciLoad(x) }; }
+    static Batch LoadA(const int32* x) { return { VeciLoad(x) }; }
+
+    void Store(int32* ptr) const  { VeciStore(ptr, v); }
+    void StoreA(int32* ptr) const { VeciStore(ptr, v); }
+};
+
+purefn BatchMask<4> VECTORCALL AsInt(Batch<float, 4> a) { return { VeciFromVec(a.v) }; }
+purefn Batch<float, 4> VECTORCALL AsFloat(BatchMask<4> a) { return { VecFromVeci(a.v) }; }
+
+AX_BATCH_OPS(4, Vec, Veci, AX_BATCH_IDENTITY, AX_BATCH_IDENTITY)
+
+template<>
+inline BatchMask<4> LoadU16<4>(const uint16* ptr)
+{
+#if defined(AX_ARM)
+    return { vmovl_u16(vld1_u16(ptr)) };
+#else
+    return { _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)ptr), _mm_setzero_si128()) };
+#endif
+}
+
+#endif // AX_SUPPORT_SSE || AX_ARM
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 8 Wide                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+#if defined(AX_SUPPORT_AVX2)
+
+template<>
+struct Batch<float, 8>
+{
+    vec8_t v;
+
+    static constexpr int Width = 8;
+
+    static Batch Set1(float x)        { return { Vec8Set1(x) }; }
+    static Batch Zero()               { return { Vec8Zero() }; }
+    static Batch Load(const float* x)  { return { Vec8Load(x) }; }
+    static Batch LoadA(const float* x) { return { Vec8LoadA(x) }; }
+
+    void Store(float* ptr) const  { Vec8StoreU(ptr, v); }
+    void StoreA(float* ptr) const { Vec8Store(ptr, v); }
+};
+
+template<>
+struct Batch<int32, 8>
+{
+    vec8i_t v;
+
+    static constexpr int Width = 8;
+
+    static Batch Set1(int32 x)        { return { Vec8iSet1(x) }; }
+    static Batch Zero()               { return { Vec8iSet1(0) }; }
+    static Batch Load(const int32* x)  { return { Vec8iLoad(x) }; }
+    static Batch LoadA(const int32* x) { return { Vec8iLoad(x) }; }
+
+    void Store(int32* ptr) const  { Vec8iStore(ptr, v); }
+    void StoreA(int32* ptr) const { Vec8iStore(ptr, v); }
+};
+
+purefn BatchMask<8> VECTORCALL AsInt(Batch<float, 8> a) { return { Vec8iFromVec8(a.v) }; }
+purefn Batch<float, 8> VECTORCALL AsFloat(BatchMask<8> a) { return { Vec8FromVec8i(a.v) }; }
+
+AX_BATCH_OPS(8, Vec8, Vec8i, AX_BATCH_IDENTITY, AX_BATCH_IDENTITY)
+
+template<>
+inline BatchMask<8> LoadU16<8>(const uint16* ptr)
+{
+    return { _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)ptr)) };
+}
+
+// for each 8 bit mask, indices of set bits packed into nibbles (lowest nibble is first set bit)
+constexpr uint32 CompressPermute8[256] = {
+    0x00000000u, 0x00000000u, 0x00000001u, 0x00000010u, 0x00000002u, 0x00000020u, 0x00000021u, 0x00000210u,
+    0x00000003u, 0x00000030u, 0x00000031u, 0x00000310u, 0x00000032u, 0x00000320u, 0x00000321u, 0x00003210u,
+    0x00000004u, 0x00000040u, 0x00000041u, 0x00000410u, 0x00000042u, 0x00000420u, 0x00000421u, 0x00004210u,
+    0x00000043u, 0x00000430u, 0x00000431u, 0x00004310u, 0x00000432u, 0x00004320u, 0x00004321u, 0x00043210u,
+    0x00000005u, 0x00000050u, 0x00000051u, 0x00000510u, 0x00000052u, 0x00000520u, 0x00000521u, 0x00005210u,
+    0x00000053u, 0x00000530u, 0x00000531u, 0x00005310u, 0x00000532u, 0x00005320u, 0x00005321u, 0x00053210u,
+    0x00000054u, 0x00000540u, 0x00000541u, 0x00005410u, 0x00000542u, 0x00005420u, 0x00005421u, 0x00054210u,
+    0x00000543u, 0x00005430u, 0x00005431u, 0x00054310u, 0x00005432u, 0x00054320u, 0x00054321u, 0x00543210u,
+    0x00000006u, 0x00000060u, 0x00000061u, 0x00000610u, 0x00000062u, 0x00000620u, 0x00000621u, 0x00006210u,
+    0x00000063u, 0x00000630u, 0x00000631u, 0x00006310u, 0x00000632u, 0x00006320u, 0x00006321u, 0x00063210u,
+    0x00000064u, 0x00000640u, 0x00000641u, 0x00006410u, 0x00000642u, 0x00006420u, 0x00006421u, 0x00064210u,
+    0x00000643u, 0x00006430u, 0x00006431u, 0x00064310u, 0x00006432u, 0x00064320u, 0x00064321u, 0x00643210u,
+    0x00000065u, 0x00000650u, 0x00000651u, 0x00006510u, 0x00000652u, 0x00006520u, 0x00006521u, 0x00065210u,
+    0x00000653u, 0x00006530u, 0x00006531u, 0x00065310u, 0x00006532u, 0x00065320u, 0x00065321u, 0x00653210u,
+    0x00000654u, 0x00006540u, 0x00006541u, 0x00065410u, 0x00006542u, 0x00065420u, 0x00065421u, 0x00654210u,
+    0x00006543u, 0x00065430u, 0x00065431u, 0x00654310u, 0x00065432u, 0x00654320u, 0x00654321u, 0x06543210u,
+    0x00000007u, 0x00000070u, 0x00000071u, 0x00000710u, 0x00000072u, 0x00000720u, 0x00000721u, 0x00007210u,
+    0x00000073u, 0x00000730u, 0x00000731u, 0x00007310u, 0x00000732u, 0x00007320u, 0x00007321u, 0x00073210u,
+    0x00000074u, 0x00000740u, 0x00000741u, 0x00007410u, 0x00000742u, 0x00007420u, 0x00007421u, 0x00074210u,
+    0x00000743u, 0x00007430u, 0x00007431u, 0x00074310u, 0x00007432u, 0x00074320u, 0x00074321u, 0x00743210u,
+    0x00000075u, 0x00000750u, 0x00000751u, 0x00007510u, 0x00000752u, 0x00007520u, 0x00007521u, 0x00075210u,
+    0x00000753u, 0x00007530u, 0x00007531u, 0x00075310u, 0x00007532u, 0x00075320u, 0x00075321u, 0x00753210u,
+    0x00000754u, 0x00007540u, 0x00007541u, 0x00075410u, 0x00007542u, 0x00075420u, 0x00075421u, 0x00754210u,
+    0x00007543u, 0x00075430u, 0x00075431u, 0x00754310u, 0x00075432u, 0x00754320u, 0x00754321u, 0x07543210u,
+    0x00000076u, 0x00000760u, 0x00000761u, 0x00007610u, 0x00000762u, 0x00007620u, 0x00007621u, 0x00076210u,
+    0x00000763u, 0x00007630u, 0x00007631u, 0x00076310u, 0x00007632u, 0x00076320u, 0x00076321u, 0x00763210u,
+    0x00000764u, 0x00007640u, 0x00007641u, 0x00076410u, 0x00007642u, 0x00076420u, 0x00076421u, 0x00764210u,
+    0x00007643u, 0x00076430u, 0x00076431u, 0x00764310u, 0x00076432u, 0x00764320u, 0x00764321u, 0x07643210u,
+    0x00000765u, 0x00007650u, 0x00007651u, 0x00076510u, 0x00007652u, 0x00076520u, 0x00076521u, 0x00765210u,
+    0x00007653u, 0x00076530u, 0x00076531u, 0x00765310u, 0x00076532u, 0x00765320u, 0x00765321u, 0x07653210u,
+    0x00007654u, 0x00076540u, 0x00076541u, 0x00765410u, 0x00076542u, 0x00765420u, 0x00765421u, 0x07654210u,
+    0x00076543u, 0x00765430u, 0x00765431u, 0x07654310u, 0x00765432u, 0x07654320u, 0x07654321u, 0x76543210u,
+};
+
+inline int VECTORCALL CompressStore(float* dst, Batch<float, 8> x, BatchMask<8> mask)
+{
+    int bits = Movemask(mask);
+    __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    __m256i perm = _mm256_srlv_epi32(_mm256_set1_epi32(int(CompressPermute8[bits])), shifts);
+    _mm256_storeu_ps(dst, _mm256_permutevar8x32_ps(x.v, _mm256_and_si256(perm, _mm256_set1_epi32(7))));
+    return int(PopCount32(uint32(bits)));
+}
+
+#endif // AX_SUPPORT_AVX2
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 16 Wide                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// only when whole program is compiled with AVX-512, for runtime dispatch see AX_TARGET_AVX512 
+#if defined(AX_SUPPORT_AVX512)
+
+template<>
+struct Batch<float, 16>
+{
+    vec16_t v;
+
+    static constexpr int Width = 16;
+
+    static Batch Set1(float x)        { return { Vec16Set1(x) }; }
+    static Batch Zero()               { return { Vec16Zero() }; }
+    static Batch Load(const float* x)  { return { Vec16Load(x) }; }
+    static Batch LoadA(const float* x) { return { Vec16LoadA(x) }; }
+
+    void Store(float* ptr) const  { Vec16StoreU(ptr, v); }
+    void StoreA(float* ptr) const { Vec16Store(ptr, v); }
+};
+
+template<>
+struct Batch<int32, 16>
+{
+    vec16i_t v;
+
+    static constexpr int Width = 16;
+
+    static Batch Set1(int32 x)        { return { Vec16iSet1(x) }; }
+    static Batch Zero()               { return { Vec16iSet1(0) }; }
+    static Batch Load(const int32* x)  { return { Vec16iLoad(x) }; }
+    static Batch LoadA(const int32* x) { return { Vec16iLoad(x) }; }
+
+    void Store(int32* ptr) const  { Vec16iStore(ptr, v); }
+    void StoreA(int32* ptr) const { Vec16iStore(ptr, v); }
+};
+
+purefn BatchMask<16> VECTORCALL AsInt(Batch<float, 16> a) { return { Vec16iFromVec16(a.v) }; }
+purefn Batch<float, 16> VECTORCALL AsFloat(BatchMask<16> a) { return { Vec16FromVec16i(a.v) }; }
+
+// comparisons returns mask registers, BatchMask keeps them as integer lanes 
+AX_BATCH_OPS(16, Vec16, Vec16i, Vec16iFromMask, Vec16MaskFromVec16i)
+
+template<>
+inline BatchMask<16> LoadU16<16>(const uint16* ptr)
+{
+    return { _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)ptr)) };
+}
+
+// compress to register and plain store, vcompressps with memory operand is microcoded on some cpus
+inline int VECTORCALL CompressStore(float* dst, Batch<float, 16> x, BatchMask<16> mask)
+{
+    __mmask16 m = Vec16MaskFromVec16i(mask.v);
+    _mm512_storeu_ps(dst, _mm512_maskz_compress_ps(m, x.v));
+    return int(PopCount32(uint32(m)));
+}
+
+#endif // AX_SUPPORT_AVX512
+
+#undef AX_BATCH_OPS
+#undef AX_BATCH_IDENTITY
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 Common                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+template<int N> purefn bool Any(BatchMask<N> a) { return Movemask(a) != 0; }
+template<int N> purefn bool All(BatchMask<N> a) { return Movemask(a) == int((1ull << (N < 32 ? N : 32)) - 1ull); }
+
+// same approximations with VecSin, VecCos, VecSinCos, VecAtan, VecAtan2, results are identical to vec_t versions
+template<int N>
+inline Batch<float, N> Sin(Batch<float, N> x)
+{
+    typedef Batch<float, N> B;
+    B vpi = B::Set1(PI);
+    BatchMask<N> lz = x < B::Zero();
+    x = Abs(x);
+    BatchMask<N> gtpi = x > vpi;
+
+    x = Select(x, x - vpi, gtpi);
+    x = x * B::Set1(0.63655f);
+    x = x * (B::Set1(2.0f) - x);
+    x = x * Fmadd(x, B::Set1(0.225f), B::Set1(0.775f));
+
+    x = Select(x, -x, gtpi);
+    x = Select(x, -x, lz);
+    return x;
+}
+
+template<int N>
+inline Batch<float, N> Cos(Batch<float, N> x)
+{
+    typedef Batch<float, N> B;
+    B vpi = B::Set1(PI);
+    x = Abs(x);
+    BatchMask<N> gtpi = x > vpi;
+    x = Select(x, x - vpi, gtpi);
+    x = x * B::Set1(0.159f);
+    B a = B::Set1(32.0f) * x * x;
+    x = B::Set1(1.0f) - a * (B::Set1(0.75f) - x);
+    return Select(x, -x, gtpi);
+}
+
+// not an approximation of Sin and Cos, same Cody-Waite reduction and polynomials with VecSinCos
+template<int N>
+inline Batch<float, N> SinCos(Batch<float, N>* cv, Batch<float, N> x)
+{
+    typedef Batch<float, N> B;
+    const B magic = B::Set1(12582912.0f); // 1.5 * 2^23
+    B j = Min(Max(x * B::Set1(2.0f / PI), B::Set1(-SinCosMaxQuadrant)), B::Set1(SinCosMaxQuadrant));
+    j = (j + magic) - magic;
+    B r = Fmadd(j, B::Set1(-HalfPIPart1), x);
+    r = Fmadd(j, B::Set1(-HalfPIPart2), r);
+    r = Fmadd(j, B::Set1(-HalfPIPart3), r);
+    r = Min(Max(r, B::Set1(-HalfPI)), B::Set1(HalfPI));
+
+    B r2 = r * r;
+    B s = Fmadd(B::Set1(-1.9515295891e-4f), r2, B::Set1(8.3321608736e-3f));
+    s = Fmadd(s, r2, B::Set1(-1.6666654611e-1f));
+    s = Fmadd(s * r2, r, r);
+    B c = Fmadd(B::Set1(2.443315711809948e-5f), r2, B::Set1(-1.388731625493765e-3f));
+    c = Fmadd(c, r2, B::Set1(4.166664568298827e-2f));
+    c = Fmadd(c * r2, r2, Fmadd(B::Set1(-0.5f), r2, B::Set1(1.0f)));
+
+    const BatchMask<N> one = BatchMask<N>::Set1(1), two = BatchMask<N>::Set1(2);
+    BatchMask<N> quadrant = ToInt(j);
+    BatchMask<N> swap = (quadrant & one) == one;
+    BatchMask<N> sinSign = (quadrant & two) << 30;
+    BatchMask<N> cosSign = ((quadrant + one) & two) << 30;
+    *cv = AsFloat(AsInt(Select(c, s, swap)) ^ cosSign);
+    return AsFloat(AsInt(Select(s, c, swap)) ^ sinSign);
+}
+
+template<int N>
+inline Batch<float, N> Atan(Batch<float, N> x)
+{
+    typedef Batch<float, N> B;
+    const B xx = x * x;
+    B res = B::Set1(-0.01172120f);
+    res = Fmadd(xx, res, B::Set1( 0.05265332f));
+    res = Fmadd(xx, res, B::Set1(-0.11643287f));
+    res = Fmadd(xx, res, B::Set1( 0.19354346f));
+    res = Fmadd(xx, res, B::Set1(-0.33262347f));
+    res = Fmadd(xx, res, B::Set1( 0.99997726f));
+    return x * res;
+}
+
+template<int N>
+inline Batch<float, N> Atan2(Batch<float, N> y, Batch<float, N> x)
+{
+    typedef Batch<float, N> B;
+    B ay = Abs(y), ax = Abs(x);
+    BatchMask<N> swapMask = ay > ax;
+    B z  = Select(ay, ax, swapMask) / Select(ax, ay, swapMask);
+    B th = Atan(z);
+    th = Select(th, B::Set1(HalfPI) - th, swapMask);
+    th = Select(th, B::Set1(PI) - th, x < B::Zero());
+    return CopySign(th, y);
+}
+
+// natural logarithm, cephes logf polynomial. ~1ulp for positive normal numbers,
+// zero and denormals are treated as FLT_MIN. scalar Log in Math.hpp is a much rougher approximation
+template<int N>
+inline Batch<float, N> Log(Batch<float, N> x)
+{
+    typedef Batch<float, N> B; typedef BatchMask<N> I;
+    x = Max(x, B::Set1(FLT_MIN));
+    I xi = AsInt(x);
+    I e  = ShiftRightLogical(xi, 23) - I::Set1(126);
+    B m  = AsFloat((xi & I::Set1(0x007FFFFF)) | I::Set1(0x3F000000)); // [0.5, 1)
+
+    // m < sqrt(0.5) ? 2m - 1 : m - 1, so m is in [sqrt(0.5) - 1, sqrt(2) - 1)
+    I small = m < B::Set1(0.707106781186547524f);
+    e = e + small;
+    m = m - B::Set1(1.0f) + Select(B::Zero(), m, small);
+
+    B z = m * m;
+    B y = B::Set1(7.0376836292E-2f);
+    y = Fmadd(y, m, B::Set1(-1.1514610310E-1f));
+    y = Fmadd(y, m, B::Set1( 1.1676998740E-1f));
+    y = Fmadd(y, m, B::Set1(-1.2420140846E-1f));
+    y = Fmadd(y, m, B::Set1( 1.4249322787E-1f));
+    y = Fmadd(y, m, B::Set1(-1.6668057665E-1f));
+    y = Fmadd(y, m, B::Set1( 2.0000714765E-1f));
+    y = Fmadd(y, m, B::Set1(-2.4999993993E-1f));
+    y = Fmadd(y, m, B::Set1( 3.3333331174E-1f));
+    y = y * m * z;
+
+    B fe = ToFloat(e);
+    y = Fmadd(fe, B::Set1(-2.12194440e-4f), y);
+    y = Fmadd(z, B::Set1(-0.5f), y);
+    return Fmadd(fe, B::Set1(0.693359375f), m + y);
+}
+
+AX_END_NAMESPACE
@@ -23,12 +23,25 @@ enum CPUIDBits : int
     CPUIDBits_AVX512 = (1 << 16),
 };
 
+// extended control register, tells which registers operating system saves on context switch.
+// cpu might support AVX or AVX-512 but we can't use them if os doesn't save ymm or zmm registers.
+inline uint64 AX_XGETBV()
+{
+#if (defined(__clang__) || defined(__GNUC__)) && (defined(__x86_64__) || defined(__i386__))
+    uint eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64)edx << 32) | eax;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return _xgetbv(0);
+#else
+    return 0;
+#endif
+}
+
 // for runtime SIMD extension detection.
 // sometimes you might need runtime extension detection.
-// recommended using global variable like this in a cpp file:
-// int g_ax_simd_bits = 0; or inline int g_ax_simd_bits = 0; in here.
-// then call AX_InitSIMD_CPUID only once in program lifetime
-// then use !!(g_ax_simd_bits & CPUIDBits_SSE2) to get the support value
+// use AX_SIMDBits() it calls AX_InitSIMD_CPUID only once in program lifetime
+// then use !!(AX_SIMDBits() & CPUIDBits_SSE2) to get the support value
 inline int AX_InitSIMD_CPUID()
 {
     int info[4];
@@ -36,18 +49,39 @@ inline int AX_InitSIMD_CPUID()
     int mask = 1;
     mask |= info[3] & (CPUIDBits_SSE | CPUIDBits_SSE2);
     mask |= info[2] & (CPUIDBits_SSE3 | CPUIDBits_SSE4_1 | CPUIDBits_SSE4_2);
-    AX_CPUID(7, info);
-    mask |= info[1] & (CPUIDBits_AVX2 | CPUIDBits_AVX512);
+    bool osxsave = !!(info[2] & (1 << 27));
+    uint64 xcr0  = osxsave ? AX_XGETBV() : 0ull;
+    AX_CPUID2(7, 0, info);
+    if ((xcr0 & 0x06) == 0x06) mask |= info[1] & CPUIDBits_AVX2;   // xmm and ymm state
+    if ((xcr0 & 0xE6) == 0xE6) mask |= info[1] & CPUIDBits_AVX512; // opmask and zmm state
     return mask;
 }
 
+inline int AX_SIMDBits()
+{
+    static const int bits = AX_InitSIMD_CPUID(); // thread safe initialization
+    return bits;
+}
+
+// true if functions marked with AX_TARGET_AVX512 can run on this machine
+inline bool AX_HasAVX512()
+{
+#if defined(AX_SUPPORT_AVX512)
+    return true;
+#elif defined(AX_TARGET_AVX512)
+    return !!(AX_SIMDBits() & CPUIDBits_AVX512);
+#else
+    return false;
+#endif
+}
+
 #if defined(AX_SUPPORT_SSE) && !defined(AX_ARM)
 /*//////////////////////////////////////////////////////////////////////////*/
 /*                                 SSE                                      */
 /*//////////////////////////////////////////////////////////////////////////*/
 
 typedef __m128  vec_t;
-typedef __m128  veci_t;
+typedef __m128i veci_t;
 typedef __m128i vecu_t;
 
 #define VecZero()           _mm_setzero_ps()
@@ -62,15 +96,21 @@ typedef __m128i vecu_t;
 // #define Vec3Load(x)         VecSetW(_mm_loadu_ps(x), 0.0f)
 
 #define VecStore(ptr, x)       _mm_store_ps(ptr, x)
+#define VecStoreU(ptr, x)      _mm_storeu_ps(ptr, x)
 #define VecFromInt(x, y, z, w) _mm_castsi128_ps(_mm_setr_epi32(x, y, z, w))
 #define VecFromInt1(x)         _mm_castsi128_ps(_mm_set1_epi32(x))
-#define VecToInt(x) x
+#define VecToInt(x) _mm_castps_si128(x)
 
 #define VecFromVeci(x) _mm_castsi128_ps(x)
 #define VeciFromVec(x) _mm_castps_si128(x)
 
 #define VecCvtF32U32(x) _mm_cvtps_epi32(x)
 #define VecCvtU32F32(x) _mm_cvtepi32_ps(x)
+#define VecCvtF32I32(x) _mm_cvttps_epi32(x) /* truncates towards zero */
+#define VecCvtI32F32(x) _mm_cvtepi32_ps(x)
+
+#define VeciLoad(x)         _mm_loadu_si128((const __m128i*)(x))
+#define VeciStore(ptr, x)   _mm_storeu_si128((__m128i*)(ptr), x)
 
 // Get Set
 #define VecSplatX(v) _mm_permute_ps(v, MakeShuffleMask(0, 0, 0, 0)) /* { v.x, v.x, v.x, v.x} */
@@ -98,11 +138,10 @@ purefn vec_t VECTORCALL Vec3Load(void const* x) {
 #define VecMul(a, b) _mm_mul_ps(a, b)
 #define VecDiv(a, b) _mm_div_ps(a, b)
 
-// int 
+// int, lower 32 bit of the multiplication is same for signed and unsigned
 #define VeciAdd(a, b) _mm_add_epi32(a, b)
 #define VeciSub(a, b) _mm_sub_epi32(a, b)
-#define VeciMul(a, b) _mm_mul_epi32(a, b)
-#define VeciDiv(a, b) _mm_div_epi32(a, b)
+#define VeciMul(a, b) _mm_mullo_epi32(a, b)
 
 #define VecAddf(a, b) _mm_add_ps(a, VecSet1(b))
 #define VecSubf(a, b) _mm_sub_ps(a, VecSet1(b))
@@ -136,10 +175,10 @@ purefn vec_t VECTORCALL Vec3Load(void const* x) {
 #define Vec3Len(v)     _mm_sqrt_ps(_mm_dp_ps(v, v, 0x7f))
 
 // Swizzling Masking
-#define VecSelect1000 _mm_castsi128_ps(_mm_setr_epi32(0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000))
-#define VecSelect1100 _mm_castsi128_ps(_mm_setr_epi32(0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000))
-#define VecSelect1110 _mm_castsi128_ps(_mm_setr_epi32(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000))
-#define VecSelect1011 _mm_castsi128_ps(_mm_setr_epi32(0xFFFFFFFF, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF))
+#define VecSelect1000 _mm_setr_epi32(0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000)
+#define VecSelect1100 _mm_setr_epi32(0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000)
+#define VecSelect1110 _mm_setr_epi32(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000)
+#define VecSelect1011 _mm_setr_epi32(0xFFFFFFFF, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF)
 
 #define VecIdentityR0 _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f)
 #define VecIdentityR1 _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f)
@@ -177,19 +216,33 @@ purefn vec_t VECTORCALL Vec3Load(void const* x) {
 #define VeciOr(a, b)     _mm_or_si128(a, b)
 #define VeciXor(a, b)    _mm_xor_si128(a, b)
 
+#define VeciSetR(x, y, z, w) _mm_setr_epi32(x, y, z, w)
+#define VeciGetX(v)     _mm_cvtsi128_si32(v)
+#define VeciSll(a, n)   _mm_slli_epi32(a, n) /* shift left */
+#define VeciSrl(a, n)   _mm_srli_epi32(a, n) /* shift right, fills with zero */
+#define VeciSra(a, n)   _mm_srai_epi32(a, n) /* shift right, fills with sign bit */
+#define VeciMin(a, b)   _mm_min_epi32(a, b)  /* signed */
+#define VeciMax(a, b)   _mm_max_epi32(a, b)  /* signed */
+#define VeciMinU(a, b)  _mm_min_epu32(a, b)  /* unsigned */
+#define VeciMaxU(a, b)  _mm_max_epu32(a, b)  /* unsigned */
+#define VeciCmpEq(a, b) _mm_cmpeq_epi32(a, b)
+#define VeciCmpGt(a, b) _mm_cmpgt_epi32(a, b) /* signed */
+#define VeciCmpLt(a, b) _mm_cmplt_epi32(a, b) /* signed */
+#define VeciSelect(V1, V2, Control) _mm_blendv_epi8(V1, V2, Control)
+#define VeciBlend(a, b, c) _mm_blendv_epi8(a, b, c)
+
 #define VecMax(a, b) _mm_max_ps(a, b)
 #define VecMin(a, b) _mm_min_ps(a, b)
 #define VecFloor(a)  _mm_floor_ps(a)
 
-#define VecCmpGt(a, b) _mm_cmpgt_ps(a, b) /* greater than */
-#define VecCmpGe(a, b) _mm_cmpge_ps(a, b) /* greater or equal */
-#define VecCmpLt(a, b) _mm_cmplt_ps(a, b) /* less than */
-#define VecCmpLe(a, b) _mm_cmple_ps(a, b) /* less or equal */
-#define VecMovemask(a) _mm_movemask_ps(a)
+#define VecCmpGt(a, b) _mm_castps_si128(_mm_cmpgt_ps(a, b)) /* greater than */
+#define VecCmpGe(a, b) _mm_castps_si128(_mm_cmpge_ps(a, b)) /* greater or equal */
+#define VecCmpLt(a, b) _mm_castps_si128(_mm_cmplt_ps(a, b)) /* less than */
+#define VecCmpLe(a, b) _mm_castps_si128(_mm_cmple_ps(a, b)) /* less or equal */
+#define VecMovemask(a) _mm_movemask_ps(_mm_castsi128_ps(a))
 
-#define VecSelect(V1, V2, Control)  _mm_blendv_ps(V1, V2, Control);
-#define VecBlend(a, b, c) _mm_blendv_ps(a, b, c)
-#define VeciBlend(a, b, c) _mm_blendv_ps(a, b, _mm_cvtepi32_ps(c))
+#define VecSelect(V1, V2, Control)  _mm_blendv_ps(V1, V2, _mm_castsi128_ps(Control))
+#define VecBlend(a, b, c) _mm_blendv_ps(a, b, _mm_castsi128_ps(c))
 
 #elif defined(AX_ARM)
 /*//////////////////////////////////////////////////////////////////////////*/
@@ -212,11 +265,17 @@ typedef uint32x4_t vecu_t;
 #define Vec3Load(x)         ARMVector3Load(x)
 
 #define VecStore(ptr, x)        vst1q_f32(ptr, x)
-#define VecFromInt1(x)          vdupq_n_s32(x)
-#define VecFromInt(x, y, z, w)  ARMCreateVecI(x, y, z, w)
+#define VecStoreU(ptr, x)       vst1q_f32(ptr, x)
+#define VecFromInt1(x)          vreinterpretq_f32_u32(vdupq_n_u32(x))
+#define VecFromInt(x, y, z, w)  vreinterpretq_f32_u32(ARMCreateVecI(x, y, z, w))
 #define VecToInt(x) vreinterpretq_u32_f32(x)
 #define VecCvtF32U32(x) vcvtq_u32_f32(x)
 #define VecCvtU32F32(x) vcvtq_f32_u32(x)
+#define VecCvtF32I32(x) vreinterpretq_u32_s32(vcvtq_s32_f32(x)) /* truncates towards zero */
+#define VecCvtI32F32(x) vcvtq_f32_s32(vreinterpretq_s32_u32(x))
+
+#define VeciLoad(x)         vld1q_u32((const uint32_t*)(x))
+#define VeciStore(ptr, x)   vst1q_u32((uint32_t*)(ptr), x)
 
 #define VecFromVeci(x) vreinterpretq_f32_u32(x)
 #define VeciFromVec(x) vreinterpretq_u32_f32(x)
@@ -255,7 +314,7 @@ typedef uint32x4_t vecu_t;
 // a * b[l] + c
 #define VecFmaddLane(a, b, c, l) vfmaq_laneq_f32(c, a, b, l)
 #define VecFmadd(a, b, c)  vfmaq_f32(c, a, b)
-#define VecFmsub(a, b, c) vfmsq_f32(c, a, b)
+#define VecFmsub(a, b, c) vnegq_f32(vfmsq_f32(c, a, b)) /* a * b - c same as SSE */
 #define VecHadd(a, b)    vpaddq_f32(a, b)
 #define VecSqrt(a)       vsqrtq_f32(a)
 #define VecRcp(a)        vrecpeq_f32(a)
@@ -314,6 +373,20 @@ typedef uint32x4_t vecu_t;
 #define VeciOr(a, b)   vorrq_u32(a, b)
 #define VeciXor(a, b)  veorq_u32(a, b)
 
+#define VeciSetR(x, y, z, w) ARMCreateVecI(x, y, z, w)
+#define VeciGetX(v)     vgetq_lane_u32(v, 0)
+#define VeciSll(a, n)   vshlq_u32(a, vdupq_n_s32(n))    /* shift left */
+#define VeciSrl(a, n)   vshlq_u32(a, vdupq_n_s32(-(n))) /* shift right, fills with zero */
+#define VeciSra(a, n)   vreinterpretq_u32_s32(vshlq_s32(vreinterpretq_s32_u32(a), vdupq_n_s32(-(n)))) /* fills with sign bit */
+#define VeciMin(a, b)   vreinterpretq_u32_s32(vminq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b))) /* signed */
+#define VeciMax(a, b)   vreinterpretq_u32_s32(vmaxq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b))) /* signed */
+#define VeciMinU(a, b)  vminq_u32(a, b) /* unsigned */
+#define VeciMaxU(a, b)  vmaxq_u32(a, b) /* unsigned */
+#define VeciCmpEq(a, b) vceqq_u32(a, b)
+#define VeciCmpGt(a, b) vcgtq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b)) /* signed */
+#define VeciCmpLt(a, b) vcltq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b)) /* signed */
+#define VeciSelect(V1, V2, Control) vbslq_u32(Control, V2, V1)
+
 #define VecMask(a, msk) VecSelect(vdupq_n_f32(0.0f), a, msk)
 
 #define VecMax(a, b) vmaxq_f32(a, b)
@@ -324,7 +397,7 @@ typedef uint32x4_t vecu_t;
 #define VecCmpGe(a, b) vcgeq_f32(a, b) // greater or equal
 #define VecCmpLt(a, b) vcltq_f32(a, b) // less than
 #define VecCmpLe(a, b) vcleq_f32(a, b) // less or equal
-#define VecMovemask(a) ARMVecMovemask(a) /* not done */
+#define VecMovemask(a) ARMVecMovemask(a)
 
 #define VecSelect(V1, V2, Control) vbslq_f32(Control, V2, V1)
 #define VecBlend(a, b, Control)    vbslq_f32(Control, b, a)
@@ -480,8 +553,8 @@ purefn vec_t ARMVectorNorm(vec_t v)
 }
 
 purefn int ARMVecMovemask(veci_t v) {
-    int32x4_t shift = ARMCreateVec(0, 1, 2, 3);
-    return vaddvq_u32(vshlq_u32(vshrq_n_u32(v, 31), shift));
+    const int32_t shiftArr[4] = { 0, 1, 2, 3 };
+    return vaddvq_u32(vshlq_u32(vshrq_n_u32(v, 31), vld1q_s32(shiftArr)));
 }
 
 template<int E0, int E1, int E2, int E3>
@@ -529,6 +602,10 @@ purefn vec_t MakeVec4(const float* x) { return vec_t { x[0], x[1], x[2], x[3] };
 
 purefn veci_t MakeVec4i(uint x, uint y, uint z, uint w) { return veci_t { x, y, z, w }; }
 purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
+purefn veci_t MakeVec4i(const uint* x) { return veci_t { x[0], x[1], x[2], x[3] }; }
+
+inline void NoVectorStore(void* ptr, vec_t a) { SmallMemCpy(ptr, &a.x, 4 * 4); }
+inline void NoVectoriStore(void* ptr, veci_t a) { SmallMemCpy(ptr, &a.x, 4 * 4); }
 
 #define VecZero()           MakeVec4(0.0f)
 #define VecOne()            MakeVec4(1.0f)
@@ -539,16 +616,23 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VecLoad(x)          MakeVec4(x)
 #define VecLoadA(x)         MakeVec4(x)
 
-#define VecStore(ptr, a)       SmallMemCpy(ptr, &a.x, 4 * 4);
-#define VecFromInt1(x)         MakeVec4i(x)
-#define VecFromInt(x, y, z, w) MakeVec4i(x, y, z, w)
+#define VecStore(ptr, a)       NoVectorStore(ptr, a)
+#define VecStoreU(ptr, a)      NoVectorStore(ptr, a)
+#define VecFromInt1(x)         BitCast<vec_t>(MakeVec4i(x))
+#define VecFromInt(x, y, z, w) BitCast<vec_t>(MakeVec4i(x, y, z, w))
 #define VecToInt(x)    BitCast<veci_t>(x)
+#define VeciSet1(x)    MakeVec4i(x)
 
 #define VecFromVeci(x) BitCast<vec_t>(x)
 #define VeciFromVec(x) BitCast<veci_t>(x)
 
 #define VecCvtF32U32(v) MakeVec4i((uint)v.x, (uint)v.y, (uint)v.z, (uint)v.w)
 #define VecCvtU32F32(v) MakeVec4((float)v.x, (float)v.y, (float)v.z, (float)v.w)
+#define VecCvtF32I32(v) MakeVec4i((uint)(int)v.x, (uint)(int)v.y, (uint)(int)v.z, (uint)(int)v.w)
+#define VecCvtI32F32(v) MakeVec4((float)(int)v.x, (float)(int)v.y, (float)(int)v.z, (float)(int)v.w)
+
+#define VeciLoad(x)         MakeVec4i((const uint*)(x))
+#define VeciStore(ptr, a)   NoVectoriStore(ptr, a)
 
 // Getters setters
 #define VecGetX(v) v.x
@@ -566,6 +650,11 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VecSetZ(v, val) v.z = val
 #define VecSetW(v, val) v.w = val
 
+purefn vec_t Vec3Load(void const* x) {
+    const float* f = (const float*)x;
+    return MakeVec4(f[0], f[1], f[2], 0.0f);
+}
+
 #define VecSelect1000 MakeVec4i(0xFFFFFFFFu, 0x00000000u, 0x00000000u, 0x00000000u)
 #define VecSelect1100 MakeVec4i(0xFFFFFFFFu, 0xFFFFFFFFu, 0x00000000u, 0x00000000u)
 #define VecSelect1110 MakeVec4i(0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu, 0x00000000u)
@@ -590,9 +679,9 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VecShuffleR(vec1, vec2, x, y, z, w) MakeVec4(vec1[w], vec1[z], vec2[y], vec2[x])
 
 // special shuffle
-#define VecShuffle_0101(vec1, vec2)  MakeVec4(vec1.x, vec1.x, vec2.y, vec2.y) 
-#define VecShuffle_2323(vec1, vec2)  MakeVec4(vec1.z, vec1.z, vec2.w, vec2.w) 
-#define VecRev(v)  MakeVec4(v.w, v.z, v.y, vec2.x)
+#define VecShuffle_0101(vec1, vec2)  MakeVec4(vec1.x, vec1.y, vec2.x, vec2.y) 
+#define VecShuffle_2323(vec1, vec2)  MakeVec4(vec1.z, vec1.w, vec2.z, vec2.w) 
+#define VecRev(v)  MakeVec4(v.w, v.z, v.y, v.x)
 
 #define VecAdd(a, b) MakeVec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w)
 #define VecSub(a, b) MakeVec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w)
@@ -604,10 +693,15 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VecMulf(a, b) MakeVec4(a.x * (b), a.y * (b), a.z * (b), a.w * (b))
 #define VecDivf(a, b) MakeVec4(a.x / (b), a.y / (b), a.z / (b), a.w / (b))
 
-#define VecHadd(a, b)     MakeVec4(a.x + b.y, a.z + a.w, b.x + b.y, b.z + b.w)
-#define VecFmadd(a, b, c) MakeVec4(a.x * b.x + c.x, a.y * b.y + c.y, a.z * b.z + c.z, a.w * b.w + c.w)
-#define VecFmsub(a, b, c) MakeVec4(a.x * b.x - c.x, a.y * b.y - c.y, a.z * b.z - c.z, a.w * b.w - c.w)
-#define VecFmaddLane(a, b, c, l) MakeVec4(a.x * b[l] + c.x, a.y * b[l] + c.y, a.z * b[l] + c.z, a.w * b[l] + c.w)
+#define VecHadd(a, b)     MakeVec4(a.x + a.y, a.z + a.w, b.x + b.y, b.z + b.w)
+// fused like the hardware versions, SinCos range reduction depends on the single rounding
+#define VecFmadd(a, b, c) MakeVec4(Fmadd(a.x, b.x, c.x), Fmadd(a.y, b.y, c.y), Fmadd(a.z, b.z, c.z), Fmadd(a.w, b.w, c.w))
+#define VecFmsub(a, b, c) MakeVec4(Fmadd(a.x, b.x, -c.x), Fmadd(a.y, b.y, -c.y), Fmadd(a.z, b.z, -c.z), Fmadd(a.w, b.w, -c.w))
+#define VecFmaddLane(a, b, c, l) MakeVec4(Fmadd(a.x, b[l], c.x), Fmadd(a.y, b[l], c.y), Fmadd(a.z, b[l], c.z), Fmadd(a.w, b[l], c.w))
+
+#define VeciAdd(a, b) MakeVec4i(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w)
+#define VeciSub(a, b) MakeVec4i(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w)
+#define VeciMul(a, b) MakeVec4i(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w)
 
 #define VecRcp(a) MakeVec4(1.0f / a.x, 1.0f / a.y, 1.0f / a.z, 1.0f / a.w)
 #define VecNeg(a) MakeVec4(-a.x, -a.y, -a.z, -a.w)
@@ -622,28 +716,44 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VeciOr(a, b)     MakeVec4i(a.x | b.x, a.y | b.y, a.z | b.z, a.w | b.w)
 #define VeciXor(a, b)    MakeVec4i(a.x ^ b.x, a.y ^ b.y, a.z ^ b.z, a.w ^ b.w)
 
+#define VeciSetR(x, y, z, w) MakeVec4i(x, y, z, w)
+#define VeciGetX(v)     (v).x
+#define VeciSll(a, n)   NoVectoriSll(a, n) /* shift left */
+#define VeciSrl(a, n)   NoVectoriSrl(a, n) /* shift right, fills with zero */
+#define VeciSra(a, n)   NoVectoriSra(a, n) /* shift right, fills with sign bit */
+#define VeciMin(a, b)   NoVectoriMin(a, b) /* signed */
+#define VeciMax(a, b)   NoVectoriMax(a, b) /* signed */
+#define VeciMinU(a, b)  NoVectoriMinU(a, b) /* unsigned */
+#define VeciMaxU(a, b)  NoVectoriMaxU(a, b) /* unsigned */
+#define VeciCmpEq(a, b) NoVectoriCmpEq(a, b)
+#define VeciCmpGt(a, b) NoVectoriCmpGt(a, b) /* signed */
+#define VeciCmpLt(a, b) NoVectoriCmpGt(b, a) /* signed */
+#define VeciSelect(V1, V2, Control) VeciOr(VeciAnd(V2, Control), VeciAnd(V1, VeciXor(Control, MakeVec4i(~0u))))
+
 #define VecMax(a, b)   MakeVec4(MAX(a.x, b.x), MAX(a.y, b.y), MAX(a.z, b.z), MAX(a.w, b.w))
 #define VecMin(a, b)   MakeVec4(MIN(a.x, b.x), MIN(a.y, b.y), MIN(a.z, b.z), MIN(a.w, b.w))
 #define VecFloor(a)    MakeVec4(Floor(a.x), Floor(a.y), Floor(a.z), Floor(a.w))
 
-#define VecCmpGt(a, b) MakeVec4i(a.x > b.x, a.y > b.y, a.z > b.z, a.w > b.w)     /* greater or equal */
-#define VecCmpGe(a, b) MakeVec4i(a.x >= b.x, a.y >= b.y, a.z >= b.z, a.w >= b.w) /* greater or equal */
-#define VecCmpLt(a, b) MakeVec4i(a.x <  b.x, a.y <  b.y, a.z <  b.z, a.w <  b.w) /* less than */
-#define VecCmpLe(a, b) MakeVec4i(a.x <= b.x, a.y <= b.y, a.z <= b.z, a.w <= b.w) /* less or equal */
+// comparisons returns all bits set for true lanes same as SSE and NEON, so results can be used as bitmask
+#define VecCmpGt(a, b) MakeVec4i(0u - (a.x >  b.x), 0u - (a.y >  b.y), 0u - (a.z >  b.z), 0u - (a.w >  b.w)) /* greater than */
+#define VecCmpGe(a, b) MakeVec4i(0u - (a.x >= b.x), 0u - (a.y >= b.y), 0u - (a.z >= b.z), 0u - (a.w >= b.w)) /* greater or equal */
+#define VecCmpLt(a, b) MakeVec4i(0u - (a.x <  b.x), 0u - (a.y <  b.y), 0u - (a.z <  b.z), 0u - (a.w <  b.w)) /* less than */
+#define VecCmpLe(a, b) MakeVec4i(0u - (a.x <= b.x), 0u - (a.y <= b.y), 0u - (a.z <= b.z), 0u - (a.w <= b.w)) /* less or equal */
+#define VecMovemask(a) int((a.x >> 31) | ((a.y >> 31) << 1) | ((a.z >> 31) << 2) | ((a.w >> 31) << 3))
 
 #define VecDotf(a, b)  (a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w)
 #define VecDot(a, b)   MakeVec4(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w)
-#define VecNorm(v)     VecDiv(v, Vec3Len(v))
+#define VecNorm(v)     VecDiv(v, VecLen(v))
 #define VecNormEst(v)  NoVectorNormEst(v)
-#define VecLenf(v)     Sqrt(VecDot(v, v))
-#define VecLen(v)      MakeVec4(Sqrt(VecDot(v, v)))
+#define VecLenf(v)     Sqrt(VecDotf(v, v))
+#define VecLen(v)      MakeVec4(Sqrt(VecDotf(v, v)))
 
 #define Vec3Dot(a, b)  MakeVec4(a.x * b.x + a.y * b.y + a.z * b.z)
 #define Vec3Dotf(a, b) (a.x * b.x + a.y * b.y + a.z * b.z)
 #define Vec3Norm(v)    VecDiv(v, Vec3Len(v))
 #define Vec3NormEst(v) NoVec3NormEst(v)
-#define Vec3Lenf(v)    Sqrt(Vec3Dot(v, v))
-#define Vec3Len(v)     MakeVec4(Sqrt(Vec3Dot(v, v)))
+#define Vec3Lenf(v)    Sqrt(Vec3Dotf(v, v))
+#define Vec3Len(v)     MakeVec4(Sqrt(Vec3Dotf(v, v)))
 
 #define VecSqrt(a)     MakeVec4(Sqrt(a.x), Sqrt(a.y), Sqrt(a.z), Sqrt(a.w))
 
@@ -652,12 +762,12 @@ purefn veci_t MakeVec4i(uint x) { return veci_t { x, x, x, x }; }
 #define VecBlend(a, b, c)           NoVectorSelect(a, b, c)
 
 purefn vec_t NoVectorNormEst(vec_t v) {
-    float invLen = RSqrt(VecDotf(v));
+    float invLen = RSqrt(VecDotf(v, v));
     return {v.x * invLen, v.y * invLen, v.z * invLen, v.w * invLen};
 }
 
 purefn vec_t NoVec3NormEst(vec_t v) {
-    float invLen = RSqrt(Vec3Dotf(v));
+    float invLen = RSqrt(Vec3Dotf(v, v));
     return {v.x * invLen, v.y * invLen, v.z * invLen, v.w * invLen};
 }
 
@@ -679,16 +789,43 @@ purefn vec_t NoVectorXor(vec_t a, vec_t b) {
     return BitCast<vec_t>(aa);
 }
 
+#define AX_NOVECI_OP(name, expr) purefn veci_t name(veci_t a, veci_t b) { \
+    veci_t r; for (uint i = 0; i < 4; i++) { uint x = a[i], y = b[i]; r[i] = expr; } return r; }
+
+AX_NOVECI_OP(NoVectoriMin,   uint(MIN(int(x), int(y))))
+AX_NOVECI_OP(NoVectoriMax,   uint(MAX(int(x), int(y))))
+AX_NOVECI_OP(NoVectoriMinU,  MIN(x, y))
+AX_NOVECI_OP(NoVectoriMaxU,  MAX(x, y))
+AX_NOVECI_OP(NoVectoriCmpEq, 0u - uint(x == y))
+AX_NOVECI_OP(NoVectoriCmpGt, 0u - uint(int(x) > int(y)))
+#undef AX_NOVECI_OP
+
+purefn veci_t NoVectoriSll(veci_t a, int n) { return MakeVec4i(a.x << n, a.y << n, a.z << n, a.w << n); }
+purefn veci_t NoVectoriSrl(veci_t a, int n) { return MakeVec4i(a.x >> n, a.y >> n, a.z >> n, a.w >> n); }
+purefn veci_t NoVectoriSra(veci_t a, int n) { return MakeVec4i(uint(int(a.x) >> n), uint(int(a.y) >> n), uint(int(a.z) >> n), uint(int(a.w) >> n)); }
+
 purefn vec_t NoVectorSelect(vec_t a, vec_t b, veci_t c) {
     veci_t ab = BitCast<veci_t>(a);
     veci_t bb = BitCast<veci_t>(b);
     bb.x &=  c.x; bb.y &=  c.y; bb.z &=  c.z; bb.w &=  c.w;
     ab.x &= ~c.x; ab.y &= ~c.y; ab.z &= ~c.z; ab.w &= ~c.w;
-    veci_t resb = VecSetR(bb.x | ab.x, bb.y | ab.y, bb.z | ab.z, bb.w | ab.w);
+    veci_t resb = MakeVec4i(bb.x | ab.x, bb.y | ab.y, bb.z | ab.z, bb.w | ab.w);
     return BitCast<vec_t>(resb);
 }
 #endif
 
+// base[idx[i]] for each lane, indices are signed 32 bit
+#if defined(AX_SUPPORT_AVX2)
+    #define VecGather(base, idx) _mm_i32gather_ps(base, idx, 4)
+#else
+inline vec_t VECTORCALL VecGather(const float* base, veci_t idx)
+{
+    int32 i[4];
+    VeciStore(i, idx);
+    return VecSetR(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+}
+#endif
+
 purefn float VECTORCALL Min3(vec_t ab)
 {
     vec_t xy = VecMin(VecSplatX(ab), VecSplatY(ab));
@@ -746,6 +883,29 @@ purefn vec_t VECTORCALL VecHSum(vec_t v) {
     return VecHadd(v, v);
 }
 
+// transposes 4x4 matrix that is represented with 4 vectors, 
+// useful for converting array of structures to structure of arrays and back
+inline void VECTORCALL VecTranspose(vec_t& r0, vec_t& r1, vec_t& r2, vec_t& r3)
+{
+    #if defined(AX_ARM)
+    float32x4x2_t P0 = vzipq_f32(r0, r2);
+    float32x4x2_t P1 = vzipq_f32(r1, r3);
+    float32x4x2_t T0 = vzipq_f32(P0.val[0], P1.val[0]);
+    float32x4x2_t T1 = vzipq_f32(P0.val[1], P1.val[1]);
+    r0 = T0.val[0]; r1 = T0.val[1];
+    r2 = T1.val[0]; r3 = T1.val[1];
+    #else
+    vec_t t0 = VecShuffleR(r0, r1, 1, 0, 1, 0);
+    vec_t t2 = VecShuffleR(r0, r1, 3, 2, 3, 2);
+    vec_t t1 = VecShuffleR(r2, r3, 1, 0, 1, 0);
+    vec_t t3 = VecShuffleR(r2, r3, 3, 2, 3, 2);
+    r0 = VecShuffleR(t0, t1, 2, 0, 2, 0);
+    r1 = VecShuffleR(t0, t1, 3, 1, 3, 1);
+    r2 = VecShuffleR(t2, t3, 2, 0, 2, 0);
+    r3 = VecShuffleR(t2, t3, 3, 1, 3, 1);
+    #endif
+}
+
 #if defined(AX_ARM)
     #define VecFabs(x) vabsq_f32(x)
 #else
@@ -788,7 +948,7 @@ inline vec_t VECTORCALL VecSin(vec_t x)
     x = VecSelect(x, VecSub(x, vpi), gtpi);
     x = VecMul(x, VecSet1(0.63655f));
     x = VecMul(x, VecSub(VecSet1(2.0f), x));
-    x = VecFmadd(x, VecSet1(0.225f), VecSet1(0.775f));
+    x = VecMul(x, VecFmadd(x, VecSet1(0.225f), VecSet1(0.775f)));
     
     x = VecSelect(x, VecNeg(x), gtpi);
     x = VecSelect(x, VecNeg(x), lz);
@@ -837,11 +997,34 @@ inline vec_t VECTORCALL VecAtan2(vec_t y, vec_t x)
     return VecCopySign(th, y);
 }
 
+// same as scalar SinCos, one Cody-Waite range reduction for both. accepts any float,
+// more precise than VecSin and VecCos
 inline vec_t VECTORCALL VecSinCos(vec_t* cv, vec_t x)
 {
-    vec_t s = VecSin(x);
-    *cv = VecCos(x);
-    return s;
+    const vec_t magic = VecSet1(12582912.0f); // 1.5 * 2^23
+    vec_t j = VecMul(x, VecSet1(2.0f / PI));
+    j = VecMin(VecMax(j, VecSet1(-SinCosMaxQuadrant)), VecSet1(SinCosMaxQuadrant));
+    j = VecSub(VecAdd(j, magic), magic); // round to nearest integer
+    vec_t r = VecFmadd(j, VecSet1(-HalfPIPart1), x);
+    r = VecFmadd(j, VecSet1(-HalfPIPart2), r);
+    r = VecFmadd(j, VecSet1(-HalfPIPart3), r);
+    r = VecMin(VecMax(r, VecSet1(-HalfPI)), VecSet1(HalfPI));
+    
+    vec_t r2 = VecMul(r, r);
+    vec_t s = VecFmadd(VecSet1(-1.9515295891e-4f), r2, VecSet1(8.3321608736e-3f));
+    s = VecFmadd(s, r2, VecSet1(-1.6666654611e-1f));
+    s = VecFmadd(VecMul(s, r2), r, r);
+    vec_t c = VecFmadd(VecSet1(2.443315711809948e-5f), r2, VecSet1(-1.388731625493765e-3f));
+    c = VecFmadd(c, r2, VecSet1(4.166664568298827e-2f));
+    c = VecFmadd(VecMul(c, r2), r2, VecFmadd(VecSet1(-0.5f), r2, VecOne()));
+    
+    // swap sin and cos on odd quadrants, negate sin on quadrant 2, 3 and cos on quadrant 1, 2
+    veci_t quadrant = VecCvtF32I32(j);
+    veci_t swap = VeciCmpEq(VeciAnd(quadrant, VeciSet1(1)), VeciSet1(1));
+    veci_t sinSign = VeciSll(VeciAnd(quadrant, VeciSet1(2)), 30);
+    veci_t cosSign = VeciSll(VeciAnd(VeciAdd(quadrant, VeciSet1(1)), VeciSet1(2)), 30);
+    *cv = VecFromVeci(VeciXor(VeciFromVec(VecSelect(c, s, swap)), cosSign));
+    return VecFromVeci(VeciXor(VeciFromVec(VecSelect(s, c, swap)), sinSign));
 }
 
 #else //__clang__ || __gnu
@@ -891,6 +1074,376 @@ purefn __m256i VECTORCALL popcnt256si(__m256i v) // returns 4 64 bit integer tha
 
 #endif // AX_SUPPORT_AVX2
 
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 8 Wide                                   */
+/*//////////////////////////////////////////////////////////////////////////*/
+// used for working on structure of arrays, 8 elements at a time.
+// with AVX2 it maps to ymm registers, otherwise it is two vec_t (lo, hi) 
+// so the same code runs on SSE, NEON and scalar.
+// vec8i_t is used for integer operations and masks that are returned from comparisons
+
+#ifdef AX_SUPPORT_AVX2
+
+typedef __m256  vec8_t;
+typedef __m256i vec8i_t;
+
+#define Vec8Zero()        _mm256_setzero_ps()
+#define Vec8One()         _mm256_set1_ps(1.0f)
+#define Vec8Set1(x)       _mm256_set1_ps(x)
+#define Vec8Load(x)       _mm256_loadu_ps(x)
+#define Vec8LoadA(x)      _mm256_load_ps(x)
+#define Vec8Store(ptr, x)  _mm256_store_ps(ptr, x)
+#define Vec8StoreU(ptr, x) _mm256_storeu_ps(ptr, x)
+
+#define Vec8FromVec4(lo, hi) _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1)
+#define Vec8Low(v)           _mm256_castps256_ps128(v)
+#define Vec8High(v)          _mm256_extractf128_ps(v, 1)
+
+#define Vec8Add(a, b) _mm256_add_ps(a, b)
+#define Vec8Sub(a, b) _mm256_sub_ps(a, b)
+#define Vec8Mul(a, b) _mm256_mul_ps(a, b)
+#define Vec8Div(a, b) _mm256_div_ps(a, b)
+#define Vec8Fmadd(a, b, c) _mm256_fmadd_ps(a, b, c) /* a * b + c */
+#define Vec8Fmsub(a, b, c) _mm256_fmsub_ps(a, b, c) /* a * b - c */
+
+#define Vec8Neg(a)    _mm256_sub_ps(_mm256_setzero_ps(), a)
+#define Vec8Rcp(a)    _mm256_rcp_ps(a)
+#define Vec8Sqrt(a)   _mm256_sqrt_ps(a)
+#define Vec8Min(a, b) _mm256_min_ps(a, b)
+#define Vec8Max(a, b) _mm256_max_ps(a, b)
+#define Vec8Floor(a)  _mm256_floor_ps(a)
+
+#define Vec8And(a, b) _mm256_and_ps(a, b)
+#define Vec8Or(a, b)  _mm256_or_ps(a, b)
+#define Vec8Xor(a, b) _mm256_xor_ps(a, b)
+
+#define Vec8CmpGt(a, b) _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ))
+#define Vec8CmpGe(a, b) _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GE_OQ))
+#define Vec8CmpLt(a, b) _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ))
+#define Vec8CmpLe(a, b) _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LE_OQ))
+#define Vec8Movemask(a) _mm256_movemask_ps(_mm256_castsi256_ps(a))
+
+// Control ? V2 : V1
+#define Vec8Select(V1, V2, Control) _mm256_blendv_ps(V1, V2, _mm256_castsi256_ps(Control))
+
+// Int
+#define Vec8iSet1(x)        _mm256_set1_epi32(x)
+#define Vec8iLoad(x)        _mm256_loadu_si256((const __m256i*)(x))
+#define Vec8iStore(ptr, x)  _mm256_storeu_si256((__m256i*)(ptr), x)
+#define Vec8iAdd(a, b)      _mm256_add_epi32(a, b)
+#define Vec8iSub(a, b)      _mm256_sub_epi32(a, b)
+#define Vec8iAnd(a, b)      _mm256_and_si256(a, b)
+#define Vec8iOr(a, b)       _mm256_or_si256(a, b)
+#define Vec8iXor(a, b)      _mm256_xor_si256(a, b)
+
+#define Vec8iMul(a, b)      _mm256_mullo_epi32(a, b)
+#define Vec8iSll(a, n)      _mm256_slli_epi32(a, n)
+#define Vec8iSrl(a, n)      _mm256_srli_epi32(a, n)
+#define Vec8iSra(a, n)      _mm256_srai_epi32(a, n)
+#define Vec8iMin(a, b)      _mm256_min_epi32(a, b)
+#define Vec8iMax(a, b)      _mm256_max_epi32(a, b)
+#define Vec8iMinU(a, b)     _mm256_min_epu32(a, b)
+#define Vec8iMaxU(a, b)     _mm256_max_epu32(a, b)
+#define Vec8iCmpEq(a, b)    _mm256_cmpeq_epi32(a, b)
+#define Vec8iCmpGt(a, b)    _mm256_cmpgt_epi32(a, b)
+#define Vec8iCmpLt(a, b)    _mm256_cmpgt_epi32(b, a)
+#define Vec8iSelect(V1, V2, Control) _mm256_blendv_epi8(V1, V2, Control)
+
+#define Vec8FromVec8i(x)    _mm256_castsi256_ps(x)
+#define Vec8iFromVec8(x)    _mm256_castps_si256(x)
+#define Vec8CvtF32I32(x)    _mm256_cvttps_epi32(x) /* truncates towards zero */
+#define Vec8CvtI32F32(x)    _mm256_cvtepi32_ps(x)
+#define Vec8Gather(base, idx) _mm256_i32gather_ps(base, idx, 4)
+
+#else
+
+struct vec8_t  { vec_t  lo, hi; };
+struct vec8i_t { veci_t lo, hi; };
+
+#define AX_VEC8_OP1(name, op) purefn vec8_t VECTORCALL name(vec8_t a) { return { op(a.lo), op(a.hi) }; }
+#define AX_VEC8_OP2(name, op) purefn vec8_t VECTORCALL name(vec8_t a, vec8_t b) { return { op(a.lo, b.lo), op(a.hi, b.hi) }; }
+#define AX_VEC8_OP3(name, op) purefn vec8_t VECTORCALL name(vec8_t a, vec8_t b, vec8_t c) { return { op(a.lo, b.lo, c.lo), op(a.hi, b.hi, c.hi) }; }
+#define AX_VEC8_CMP(name, op) purefn vec8i_t VECTORCALL name(vec8_t a, vec8_t b) { return { op(a.lo, b.lo), op(a.hi, b.hi) }; }
+
+purefn vec8_t Vec8Set1(float x) { return { VecSet1(x), VecSet1(x) }; }
+purefn vec8_t Vec8Load(const float* x) { return { VecLoad(x), VecLoad(x + 4) }; }
+purefn vec8_t Vec8LoadA(const float* x) { return { VecLoadA(x), VecLoadA(x + 4) }; }
+inline void VECTORCALL Vec8Store(float* ptr, vec8_t x) { VecStore(ptr, x.lo); VecStore(ptr + 4, x.hi); }
+inline void VECTORCALL Vec8StoreU(float* ptr, vec8_t x) { VecStoreU(ptr, x.lo); VecStoreU(ptr + 4, x.hi); }
+
+#define Vec8Zero()           Vec8Set1(0.0f)
+#define Vec8One()            Vec8Set1(1.0f)
+#define Vec8FromVec4(lo, hi) vec8_t{ lo, hi }
+#define Vec8Low(v)           (v).lo
+#define Vec8High(v)          (v).hi
+
+AX_VEC8_OP2(Vec8Add, VecAdd)
+AX_VEC8_OP2(Vec8Sub, VecSub)
+AX_VEC8_OP2(Vec8Mul, VecMul)
+AX_VEC8_OP2(Vec8Div, VecDiv)
+AX_VEC8_OP3(Vec8Fmadd, VecFmadd)
+AX_VEC8_OP3(Vec8Fmsub, VecFmsub)
+
+AX_VEC8_OP1(Vec8Neg, VecNeg)
+AX_VEC8_OP1(Vec8Rcp, VecRcp)
+AX_VEC8_OP1(Vec8Sqrt, VecSqrt)
+AX_VEC8_OP2(Vec8Min, VecMin)
+AX_VEC8_OP2(Vec8Max, VecMax)
+AX_VEC8_OP1(Vec8Floor, VecFloor)
+
+AX_VEC8_OP2(Vec8And, VecAnd)
+AX_VEC8_OP2(Vec8Or, VecOr)
+AX_VEC8_OP2(Vec8Xor, VecXor)
+
+AX_VEC8_CMP(Vec8CmpGt, VecCmpGt)
+AX_VEC8_CMP(Vec8CmpGe, VecCmpGe)
+AX_VEC8_CMP(Vec8CmpLt, VecCmpLt)
+AX_VEC8_CMP(Vec8CmpLe, VecCmpLe)
+
+purefn int VECTORCALL Vec8Movemask(vec8i_t a) { return VecMovemask(a.lo) | (VecMovemask(a.hi) << 4); }
+
+// Control ? V2 : V1
+purefn vec8_t VECTORCALL Vec8Select(vec8_t V1, vec8_t V2, vec8i_t Control) {
+    return { VecSelect(V1.lo, V2.lo, Control.lo), VecSelect(V1.hi, V2.hi, Control.hi) };
+}
+
+// Int
+#define AX_VEC8I_OP2(name, op) purefn vec8i_t VECTORCALL name(vec8i_t a, vec8i_t b) { return { op(a.lo, b.lo), op(a.hi, b.hi) }; }
+#define AX_VEC8I_SHIFT(name, op) purefn vec8i_t VECTORCALL name(vec8i_t a, int n) { return { op(a.lo, n), op(a.hi, n) }; }
+
+purefn vec8i_t Vec8iSet1(int x) { return { VeciSet1(x), VeciSet1(x) }; }
+purefn vec8i_t Vec8iLoad(const void* x) { return { VeciLoad(x), VeciLoad((const int*)x + 4) }; }
+inline void VECTORCALL Vec8iStore(void* ptr, vec8i_t x) { VeciStore(ptr, x.lo); VeciStore((int*)ptr + 4, x.hi); }
+
+AX_VEC8I_OP2(Vec8iAdd, VeciAdd)
+AX_VEC8I_OP2(Vec8iSub, VeciSub)
+AX_VEC8I_OP2(Vec8iMul, VeciMul)
+AX_VEC8I_OP2(Vec8iAnd, VeciAnd)
+AX_VEC8I_OP2(Vec8iOr, VeciOr)
+AX_VEC8I_OP2(Vec8iXor, VeciXor)
+AX_VEC8I_SHIFT(Vec8iSll, VeciSll)
+AX_VEC8I_SHIFT(Vec8iSrl, VeciSrl)
+AX_VEC8I_SHIFT(Vec8iSra, VeciSra)
+AX_VEC8I_OP2(Vec8iMin, VeciMin)
+AX_VEC8I_OP2(Vec8iMax, VeciMax)
+AX_VEC8I_OP2(Vec8iMinU, VeciMinU)
+AX_VEC8I_OP2(Vec8iMaxU, VeciMaxU)
+AX_VEC8I_OP2(Vec8iCmpEq, VeciCmpEq)
+AX_VEC8I_OP2(Vec8iCmpGt, VeciCmpGt)
+AX_VEC8I_OP2(Vec8iCmpLt, VeciCmpLt)
+
+purefn vec8i_t VECTORCALL Vec8iSelect(vec8i_t V1, vec8i_t V2, vec8i_t Control) {
+    return { VeciSelect(V1.lo, V2.lo, Control.lo), VeciSelect(V1.hi, V2.hi, Control.hi) };
+}
+
+purefn vec8_t  VECTORCALL Vec8FromVec8i(vec8i_t x) { return { VecFromVeci(x.lo), VecFromVeci(x.hi) }; }
+purefn vec8i_t VECTORCALL Vec8iFromVec8(vec8_t x)  { return { VeciFromVec(x.lo), VeciFromVec(x.hi) }; }
+purefn vec8i_t VECTORCALL Vec8CvtF32I32(vec8_t x)  { return { VecCvtF32I32(x.lo), VecCvtF32I32(x.hi) }; }
+purefn vec8_t  VECTORCALL Vec8CvtI32F32(vec8i_t x) { return { VecCvtI32F32(x.lo), VecCvtI32F32(x.hi) }; }
+inline vec8_t VECTORCALL Vec8Gather(const float* base, vec8i_t idx) { return { VecGather(base, idx.lo), VecGather(base, idx.hi) }; }
+
+#undef AX_VEC8_OP1
+#undef AX_VEC8_OP2
+#undef AX_VEC8_OP3
+#undef AX_VEC8_CMP
+#undef AX_VEC8I_OP2
+#undef AX_VEC8I_SHIFT
+
+#endif // AX_SUPPORT_AVX2
+
+// same as VecSinCos, 8 elements at a time
+inline vec8_t VECTORCALL Vec8SinCos(vec8_t* cv, vec8_t x)
+{
+    const vec8_t magic = Vec8Set1(12582912.0f); // 1.5 * 2^23
+    vec8_t j = Vec8Mul(x, Vec8Set1(2.0f / PI));
+    j = Vec8Min(Vec8Max(j, Vec8Set1(-SinCosMaxQuadrant)), Vec8Set1(SinCosMaxQuadrant));
+    j = Vec8Sub(Vec8Add(j, magic), magic);
+    vec8_t r = Vec8Fmadd(j, Vec8Set1(-HalfPIPart1), x);
+    r = Vec8Fmadd(j, Vec8Set1(-HalfPIPart2), r);
+    r = Vec8Fmadd(j, Vec8Set1(-HalfPIPart3), r);
+    r = Vec8Min(Vec8Max(r, Vec8Set1(-HalfPI)), Vec8Set1(HalfPI));
+    
+    vec8_t r2 = Vec8Mul(r, r);
+    vec8_t s = Vec8Fmadd(Vec8Set1(-1.9515295891e-4f), r2, Vec8Set1(8.3321608736e-3f));
+    s = Vec8Fmadd(s, r2, Vec8Set1(-1.6666654611e-1f));
+    s = Vec8Fmadd(Vec8Mul(s, r2), r, r);
+    vec8_t c = Vec8Fmadd(Vec8Set1(2.443315711809948e-5f), r2, Vec8Set1(-1.388731625493765e-3f));
+    c = Vec8Fmadd(c, r2, Vec8Set1(4.166664568298827e-2f));
+    c = Vec8Fmadd(Vec8Mul(c, r2), r2, Vec8Fmadd(Vec8Set1(-0.5f), r2, Vec8One()));
+    
+    vec8i_t quadrant = Vec8CvtF32I32(j);
+    vec8i_t swap = Vec8iCmpEq(Vec8iAnd(quadrant, Vec8iSet1(1)), Vec8iSet1(1));
+    vec8i_t sinSign = Vec8iSll(Vec8iAnd(quadrant, Vec8iSet1(2)), 30);
+    vec8i_t cosSign = Vec8iSll(Vec8iAnd(Vec8iAdd(quadrant, Vec8iSet1(1)), Vec8iSet1(2)), 30);
+    *cv = Vec8FromVec8i(Vec8iXor(Vec8iFromVec8(Vec8Select(c, s, swap)), cosSign));
+    return Vec8FromVec8i(Vec8iXor(Vec8iFromVec8(Vec8Select(s, c, swap)), sinSign));
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                 16 Wide                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// AVX-512, 16 elements at a time. comparisons returns __mmask16 predicates,
+// array tails are handled with masked loads and stores instead of scalar loops.
+// usable when compiled with AVX-512 (AX_SUPPORT_AVX512) or inside of the
+// functions that marked with AX_TARGET_AVX512, after checking AX_HasAVX512()
+
+#ifdef AX_TARGET_AVX512
+
+typedef __m512    vec16_t;
+typedef __m512i   vec16i_t;
+typedef __mmask16 vecmask16_t;
+
+#define Vec16Zero()         _mm512_setzero_ps()
+#define Vec16One()          _mm512_set1_ps(1.0f)
+#define Vec16Set1(x)        _mm512_set1_ps(x)
+#define Vec16Load(x)        _mm512_loadu_ps(x)
+#define Vec16LoadA(x)       _mm512_load_ps(x)
+#define Vec16Store(ptr, x)  _mm512_store_ps(ptr, x)
+#define Vec16StoreU(ptr, x) _mm512_storeu_ps(ptr, x)
+
+// first n lanes are active, masked loads returns zero for inactive lanes and stores doesn't touch their memory
+#define Vec16TailMask(n)              ((__mmask16)((n) >= 16 ? 0xFFFFu : (1u << (n)) - 1u))
+#define Vec16LoadMasked(x, msk)       _mm512_maskz_loadu_ps(msk, x)
+#define Vec16StoreMasked(ptr, msk, x) _mm512_mask_storeu_ps(ptr, msk, x)
+
+#define Vec16Add(a, b) _mm512_add_ps(a, b)
+#define Vec16Sub(a, b) _mm512_sub_ps(a, b)
+#define Vec16Mul(a, b) _mm512_mul_ps(a, b)
+#define Vec16Div(a, b) _mm512_div_ps(a, b)
+#define Vec16Fmadd(a, b, c) _mm512_fmadd_ps(a, b, c) /* a * b + c */
+#define Vec16Fmsub(a, b, c) _mm512_fmsub_ps(a, b, c) /* a * b - c */
+
+#define Vec16Neg(a)    _mm512_sub_ps(_mm512_setzero_ps(), a)
+#define Vec16Rcp(a)    _mm512_rcp14_ps(a)
+#define Vec16Sqrt(a)   _mm512_sqrt_ps(a)
+#define Vec16Min(a, b) _mm512_min_ps(a, b)
+#define Vec16Max(a, b) _mm512_max_ps(a, b)
+#define Vec16Floor(a)  _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF)
+#define Vec16Fabs(a)   _mm512_abs_ps(a)
+
+// float logical instructions requires AVX512DQ, integer versions are same
+#define Vec16And(a, b) _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)))
+#define Vec16Or(a, b)  _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)))
+#define Vec16Xor(a, b) _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)))
+
+#define Vec16CmpGt(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)
+#define Vec16CmpGe(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ)
+#define Vec16CmpLt(a, b) _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ)
+#define Vec16CmpLe(a, b) _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ)
+#define Vec16Movemask(msk) ((int)(msk))
+
+// Control ? V2 : V1
+#define Vec16Select(V1, V2, Control) _mm512_mask_blend_ps(Control, V1, V2)
+
+// Int
+#define Vec16iSet1(x)        _mm512_set1_epi32(x)
+#define Vec16iLoad(x)        _mm512_loadu_si512((const void*)(x))
+#define Vec16iStore(ptr, x)  _mm512_storeu_si512((void*)(ptr), x)
+#define Vec16iAdd(a, b)      _mm512_add_epi32(a, b)
+#define Vec16iSub(a, b)      _mm512_sub_epi32(a, b)
+#define Vec16iAnd(a, b)      _mm512_and_si512(a, b)
+#define Vec16iOr(a, b)       _mm512_or_si512(a, b)
+#define Vec16iXor(a, b)      _mm512_xor_si512(a, b)
+
+#define Vec16iMul(a, b)      _mm512_mullo_epi32(a, b)
+#define Vec16iSll(a, n)      _mm512_slli_epi32(a, n)
+#define Vec16iSrl(a, n)      _mm512_srli_epi32(a, n)
+#define Vec16iSra(a, n)      _mm512_srai_epi32(a, n)
+#define Vec16iMin(a, b)      _mm512_min_epi32(a, b)
+#define Vec16iMax(a, b)      _mm512_max_epi32(a, b)
+#define Vec16iMinU(a, b)     _mm512_min_epu32(a, b)
+#define Vec16iMaxU(a, b)     _mm512_max_epu32(a, b)
+#define Vec16iCmpEq(a, b)    _mm512_cmpeq_epi32_mask(a, b) /* returns mask register */
+#define Vec16iCmpGt(a, b)    _mm512_cmpgt_epi32_mask(a, b)
+#define Vec16iCmpLt(a, b)    _mm512_cmplt_epi32_mask(a, b)
+#define Vec16iSelect(V1, V2, Control) _mm512_mask_blend_epi32(Control, V1, V2)
+#define Vec16Gather(base, idx) _mm512_i32gather_ps(idx, base, 4)
+
+#define Vec16FromVec16i(x)   _mm512_castsi512_ps(x)
+#define Vec16iFromVec16(x)   _mm512_castps_si512(x)
+#define Vec16CvtF32I32(x)    _mm512_cvttps_epi32(x) /* truncates towards zero */
+#define Vec16CvtI32F32(x)    _mm512_cvtepi32_ps(x)
+
+// mask register <-> integer register that has all bits set for true lanes
+#define Vec16iFromMask(msk)  _mm512_maskz_set1_epi32(msk, -1)
+#define Vec16MaskFromVec16i(x) _mm512_test_epi32_mask(x, x)
+
+// same approximations with VecSin, VecCos, VecAtan2
+AX_TARGET_AVX512 inline vec16_t VECTORCALL Vec16Sin(vec16_t x)
+{
+    vec16_t vpi = Vec16Set1(PI);
+    vecmask16_t lz = Vec16CmpLt(x, Vec16Zero());
+    x = Vec16Fabs(x);
+    vecmask16_t gtpi = Vec16CmpGt(x, vpi);
+
+    x = _mm512_mask_sub_ps(x, gtpi, x, vpi);
+    x = Vec16Mul(x, Vec16Set1(0.63655f));
+    x = Vec16Mul(x, Vec16Sub(Vec16Set1(2.0f), x));
+    x = Vec16Mul(x, Vec16Fmadd(x, Vec16Set1(0.225f), Vec16Set1(0.775f)));
+    return Vec16Select(x, Vec16Neg(x), (vecmask16_t)(gtpi ^ lz)); // negated twice if both true
+}
+
+AX_TARGET_AVX512 inline vec16_t VECTORCALL Vec16Cos(vec16_t x)
+{
+    vec16_t vpi = Vec16Set1(PI);
+    x = Vec16Fabs(x);
+    vecmask16_t gtpi = Vec16CmpGt(x, vpi);
+    x = _mm512_mask_sub_ps(x, gtpi, x, vpi);
+    x = Vec16Mul(x, Vec16Set1(0.159f));
+    vec16_t a = Vec16Mul(Vec16Mul(Vec16Set1(32.0f), x), x);
+    x = Vec16Sub(Vec16Set1(1.0f), Vec16Mul(a, Vec16Sub(Vec16Set1(0.75f), x)));
+    return Vec16Select(x, Vec16Neg(x), gtpi);
+}
+
+// same as VecSinCos
+AX_TARGET_AVX512 inline vec16_t VECTORCALL Vec16SinCos(vec16_t* cv, vec16_t x)
+{
+    const vec16_t magic = Vec16Set1(12582912.0f); // 1.5 * 2^23
+    vec16_t j = Vec16Mul(x, Vec16Set1(2.0f / PI));
+    j = Vec16Min(Vec16Max(j, Vec16Set1(-SinCosMaxQuadrant)), Vec16Set1(SinCosMaxQuadrant));
+    j = Vec16Sub(Vec16Add(j, magic), magic);
+    vec16_t r = Vec16Fmadd(j, Vec16Set1(-HalfPIPart1), x);
+    r = Vec16Fmadd(j, Vec16Set1(-HalfPIPart2), r);
+    r = Vec16Fmadd(j, Vec16Set1(-HalfPIPart3), r);
+    r = Vec16Min(Vec16Max(r, Vec16Set1(-HalfPI)), Vec16Set1(HalfPI));
+
+    vec16_t r2 = Vec16Mul(r, r);
+    vec16_t s = Vec16Fmadd(Vec16Set1(-1.9515295891e-4f), r2, Vec16Set1(8.3321608736e-3f));
+    s = Vec16Fmadd(s, r2, Vec16Set1(-1.6666654611e-1f));
+    s = Vec16Fmadd(Vec16Mul(s, r2), r, r);
+    vec16_t c = Vec16Fmadd(Vec16Set1(2.443315711809948e-5f), r2, Vec16Set1(-1.388731625493765e-3f));
+    c = Vec16Fmadd(c, r2, Vec16Set1(4.166664568298827e-2f));
+    c = Vec16Fmadd(Vec16Mul(c, r2), r2, Vec16Fmadd(Vec16Set1(-0.5f), r2, Vec16Set1(1.0f)));
+
+    vec16i_t quadrant = Vec16CvtF32I32(j);
+    vecmask16_t swap = Vec16iCmpEq(Vec16iAnd(quadrant, Vec16iSet1(1)), Vec16iSet1(1));
+    vec16i_t sinSign = Vec16iSll(Vec16iAnd(quadrant, Vec16iSet1(2)), 30);
+    vec16i_t cosSign = Vec16iSll(Vec16iAnd(Vec16iAdd(quadrant, Vec16iSet1(1)), Vec16iSet1(2)), 30);
+    *cv = Vec16FromVec16i(Vec16iXor(Vec16iFromVec16(Vec16Select(c, s, swap)), cosSign));
+    return Vec16FromVec16i(Vec16iXor(Vec16iFromVec16(Vec16Select(s, c, swap)), sinSign));
+}
+
+AX_TARGET_AVX512 inline vec16_t VECTORCALL Vec16Atan2(vec16_t y, vec16_t x)
+{
+    vec16_t ay = Vec16Fabs(y), ax = Vec16Fabs(x);
+    vecmask16_t swapMask = Vec16CmpGt(ay, ax);
+    vec16_t z  = Vec16Div(Vec16Select(ay, ax, swapMask), Vec16Select(ax, ay, swapMask));
+    vec16_t zz = Vec16Mul(z, z);
+    vec16_t th = Vec16Set1(-0.01172120f);
+    th = Vec16Fmadd(zz, th, Vec16Set1( 0.05265332f));
+    th = Vec16Fmadd(zz, th, Vec16Set1(-0.11643287f));
+    th = Vec16Fmadd(zz, th, Vec16Set1( 0.19354346f));
+    th = Vec16Fmadd(zz, th, Vec16Set1(-0.33262347f));
+    th = Vec16Fmadd(zz, th, Vec16Set1( 0.99997726f));
+    th = Vec16Mul(z, th);
+    th = Vec16Select(th, Vec16Sub(Vec16Set1(HalfPI), th), swapMask);
+    th = Vec16Select(th, Vec16Sub(Vec16Set1(PI), th), Vec16CmpLt(x, Vec16Zero()));
+    vec16i_t sign = Vec16iAnd(Vec16iFromVec16(y), Vec16iSet1(0x80000000));
+    return Vec16FromVec16i(Vec16iOr(Vec16iFromVec16(th), sign)); // th is positive, copy sign of y
+}
+
+#endif // AX_TARGET_AVX512
+
 struct Ray
 {
     vec_t origin;
@@ -0,0 +1,284 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      Cell hashing for broad phase and neighbour queries.       *
+*      HashCell has scalar and Batch<int32, N> versions that     *
+*      produces same keys, so you can hash 4, 8 or 16 points     *
+*      at once and probe the grid with precomputed hashes.       *
+*      SpatialHashGrid is open addressing hash map keyed by      *
+*      Vector3i cells, linear probing over flat arrays.          *
+*   Be Aware:                                                    *
+*      grid stores one value per cell, store index of first      *
+*      element of a list or bucket if you need more per cell.    *
+*      capacity is power of two and load factor is under 0.75    *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Vector.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Cell Hashing                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// large primes from Teschner et al. 2003, Optimized Spatial Hashing for Collision Detection
+// result is mixed with MurmurHash32 because we index the table with low bits
+pureconst uint32 HashCell(int x, int y, int z)
+{
+    return MurmurHash32((uint32(x) * 73856093u) ^ (uint32(y) * 19349663u) ^ (uint32(z) * 83492791u));
+}
+
+pureconst uint32 HashCell(Vector3i cell) { return HashCell(cell.x, cell.y, cell.z); }
+
+purefn Vector3i CellOf(Vector3f position, float invCellSize)
+{
+    return { (int)Floor(position.x * invCellSize), (int)Floor(position.y * invCellSize), (int)Floor(position.z * invCellSize) };
+}
+
+template<int N>
+purefn BatchMask<N> HashCell(BatchMask<N> x, BatchMask<N> y, BatchMask<N> z)
+{
+    BatchMask<N> h = (x * BatchMask<N>::Set1(73856093)) ^
+                     (y * BatchMask<N>::Set1(19349663)) ^
+                     (z * BatchMask<N>::Set1(83492791));
+    // MurmurHash32
+    h = h ^ ShiftRightLogical(h, 16);
+    h = h * BatchMask<N>::Set1(int32(0x85ebca6bu));
+    h = h ^ ShiftRightLogical(h, 13);
+    h = h * BatchMask<N>::Set1(int32(0xc2b2ae35u));
+    return h ^ ShiftRightLogical(h, 16);
+}
+
+template<int N>
+purefn BatchMask<N> CellOf(Batch<float, N> x, Batch<float, N> invCellSize)
+{
+    return ToInt(Floor(x * invCellSize));
+}
+
+template<int N>
+inline int HashPointsKernel(uint32* hashes, const Vector3SoA& points, float invCellSize, int i, int count)
+{
+    const Batch<float, N> invSize = Batch<float, N>::Set1(invCellSize);
+    for (; i + N <= count; i += N)
+    {
+        BatchMask<N> cx = CellOf(Batch<float, N>::Load(points.x + i), invSize);
+        BatchMask<N> cy = CellOf(Batch<float, N>::Load(points.y + i), invSize);
+        BatchMask<N> cz = CellOf(Batch<float, N>::Load(points.z + i), invSize);
+        HashCell(cx, cy, cz).Store((int32*)hashes + i);
+    }
+    return i;
+}
+
+// writes HashCell(CellOf(point)) for each point, use with SpatialHashGrid::FindHashed
+inline void HashPointsArray(uint32* hashes, const Vector3SoA& points, float invCellSize, int count)
+{
+    int i = HashPointsKernel<AX_BATCH_WIDTH>(hashes, points, invCellSize, 0, count);
+    HashPointsKernel<1>(hashes, points, invCellSize, i, count);
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                            Spatial Hash Grid                             */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// keys, values and hashes are separate arrays, probing only touches hashes
+// until it finds a match, zero hash marks the empty slot.
+template<typename ValueT>
+struct SpatialHashGrid
+{
+    uint32*   hashes   = nullptr;
+    Vector3i* keys     = nullptr;
+    ValueT*   values   = nullptr;
+    int       count    = 0;
+    int       capacity = 0;
+
+    SpatialHashGrid() {}
+
+    explicit SpatialHashGrid(int initialCapacity) { Reserve(initialCapacity); }
+
+    ~SpatialHashGrid() { Destroy(); }
+
+    SpatialHashGrid(const SpatialHashGrid&) = delete;
+    SpatialHashGrid& operator = (const SpatialHashGrid&) = delete;
+
+    SpatialHashGrid(SpatialHashGrid&& other) { *this = (SpatialHashGrid&&)other; }
+
+    SpatialHashGrid& operator = (SpatialHashGrid&& other)
+    {
+        if (this == &other) return *this;
+        Destroy();
+        hashes = other.hashes; keys = other.keys; values = other.values;
+        count  = other.count;  capacity = other.capacity;
+        other.hashes = nullptr; other.keys = nullptr; other.values = nullptr;
+        other.count  = 0;       other.capacity = 0;
+        return *this;
+    }
+
+    int  Size()    const { return count; }
+    bool Empty()   const { return count == 0; }
+
+    // top bit is always set so hash of a used slot is never zero, low bits are used for indexing
+    static uint32 StoredHash(uint32 hash) { return hash | 0x80000000u; }
+
+    ValueT* FindHashed(Vector3i cell, uint32 hash)
+    {
+        if (capacity == 0) return nullptr;
+        const uint32 mask = capacity - 1, stored = StoredHash(hash);
+
+        for (uint32 i = hash & mask; hashes[i] != 0; i = (i + 1) & mask)
+        {
+            if (hashes[i] == stored && keys[i].x == cell.x && keys[i].y == cell.y && keys[i].z == cell.z)
+                return values + i;
+        }
+        return nullptr;
+    }
+
+    ValueT* Find(Vector3i cell) { return FindHashed(cell, HashCell(cell)); }
+
+    const ValueT* Find(Vector3i cell) const { return const_cast<SpatialHashGrid*>(this)->Find(cell); }
+
+    bool Contains(Vector3i cell) const { return Find(cell) != nullptr; }
+
+    // returns value of the cell, default constructs it if cell is not exist
+    ValueT& InsertHashed(Vector3i cell, uint32 hash)
+    {
+        if ((count + 1) * 4 > capacity * 3)
+            Rehash(capacity == 0 ? 16 : capacity * 2);
+
+        const uint32 mask = capacity - 1, stored = StoredHash(hash);
+        uint32 i = hash & mask;
+
+        for (; hashes[i] != 0; i = (i + 1) & mask)
+        {
+            if (hashes[i] == stored && keys[i].x == cell.x && keys[i].y == cell.y && keys[i].z == cell.z)
+                return values[i];
+        }
+
+        hashes[i] = stored;
+        keys[i]   = cell;
+        values[i] = ValueT{};
+        count++;
+        return values[i];
+    }
+
+    ValueT& Insert(Vector3i cell) { return InsertHashed(cell, HashCell(cell)); }
+
+    ValueT& Insert(Vector3i cell, const ValueT& value)
+    {
+        ValueT& v = Insert(cell);
+        v = value;
+        return v;
+    }
+
+    ValueT& operator[](Vector3i cell) { return Insert(cell); }
+
+    // backward shift deletion, no tombstones so probe lengths doesn't grow over time
+    bool Erase(Vector3i cell)
+    {
+        ValueT* found = Find(cell);
+        if (!found) return false;
+
+        const uint32 mask = capacity - 1;
+        uint32 hole = uint32(found - values);
+
+        for (uint32 j = (hole + 1) & mask; hashes[j] != 0; j = (j + 1) & mask)
+        {
+            uint32 home = hashes[j] & mask;
+            // move j into the hole if its home slot is not in the cyclic range (hole, j]
+            bool inRange = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+            if (inRange) continue;
+
+            hashes[hole] = hashes[j];
+            keys[hole]   = keys[j];
+            values[hole] = (ValueT&&)values[j];
+            hole = j;
+        }
+
+        hashes[hole] = 0;
+        values[hole] = ValueT{};
+        count--;
+        return true;
+    }
+
+    void Clear()
+    {
+        if (capacity == 0) return;
+        MemsetZero(hashes, sizeof(uint32) * capacity);
+        for (int i = 0; i < capacity; i++) values[i] = ValueT{};
+        count = 0;
+    }
+
+    // makes sure size elements fits without rehashing
+    void Reserve(int size)
+    {
+        int required = NextPowerOf2(MAX((size * 4 + 2) / 3, 16));
+        if (required > capacity)
+            Rehash(required);
+    }
+
+    void Rehash(int newCapacity)
+    {
+        ASSERT(IsPowerOfTwo(newCapacity) && newCapacity * 3 >= count * 4);
+        uint32*   oldHashes   = hashes;
+        Vector3i* oldKeys     = keys;
+        ValueT*   oldValues   = values;
+        int       oldCapacity = capacity;
+
+        hashes   = new uint32[newCapacity];
+        keys     = new Vector3i[newCapacity];
+        values   = new ValueT[newCapacity];
+        capacity = newCapacity;
+        MemsetZero(hashes, sizeof(uint32) * newCapacity);
+
+        const uint32 mask = newCapacity - 1;
+        for (int i = 0; i < oldCapacity; i++)
+        {
+            if (oldHashes[i] == 0) continue;
+            uint32 j = oldHashes[i] & mask;
+            while (hashes[j] != 0) j = (j + 1) & mask;
+            hashes[j] = oldHashes[i];
+            keys[j]   = oldKeys[i];
+            values[j] = (ValueT&&)oldValues[i];
+        }
+
+        delete[] oldHashes;
+        delete[] oldKeys;
+        delete[] oldValues;
+    }
+
+    void Destroy()
+    {
+        delete[] hashes;
+        delete[] keys;
+        delete[] values;
+        hashes = nullptr; keys = nullptr; values = nullptr;
+        count  = 0; capacity = 0;
+    }
+
+    // calls fn(const Vector3i& cell, ValueT& value) for every used slot
+    template<typename FnT>
+    void ForEach(FnT fn)
+    {
+        for (int i = 0; i < capacity; i++)
+            if (hashes[i] != 0) fn(keys[i], values[i]);
+    }
+
+    // calls fn(const Vector3i& cell, ValueT& value) for the cell and its 26 neighbours that exist
+    template<typename FnT>
+    void ForEachNeighbour(Vector3i cell, FnT fn)
+    {
+        for (int z = -1; z <= 1; z++)
+        for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+        {
+            Vector3i neighbour = { cell.x + x, cell.y + y, cell.z + z };
+            if (ValueT* value = Find(neighbour))
+                fn((const Vector3i&)neighbour, *value);
+        }
+    }
+};
+
+AX_END_NAMESPACE
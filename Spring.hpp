@@ -0,0 +1,410 @@
+
+/*****************************************************************
+*   Purpose:                                                     *
+*      SmoothDamp and damped springs for floats, vectors and     *
+*      quaternions. Array versions updates thousands of springs  *
+*      in one pass, overshoot check is branchless.               *
+*      SpringDamper is exact solution of the damped harmonic     *
+*      oscillator, it is stable for any delta time.              *
+*   Be Aware:                                                    *
+*      vector SmoothDamp clamps length of the change instead of  *
+*      each component, same as float version for 1 component.    *
+*      quaternion versions keeps the velocity tangent to the     *
+*      rotation and normalizes the result.                       *
+*   Author : Anilcan Gulkaya 2023 anilcangulkaya7@gmail.com      *
+*****************************************************************/
+
+#pragma once
+
+#include "SIMDBatch.hpp"
+#include "Quaternion.hpp"
+
+AX_NAMESPACE
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                               Smooth Damp                                */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// values that are same for every spring in the same update
+struct SmoothDampFactors
+{
+    float omega, exp, maxChange, deltaTime;
+};
+
+purefn SmoothDampFactors MakeSmoothDampFactors(float smoothTime, float maxSpeed, float deltaTime)
+{
+    // Based on Game Programming Gems 4 Chapter 1.10
+    smoothTime = MAX(0.0001f, smoothTime);
+    float omega = 2.0f / smoothTime;
+    float x = omega * deltaTime;
+    float exp = 1.0f / (1.0f + x + 0.48f * x * x + 0.235f * x * x * x);
+    return { omega, exp, maxSpeed * smoothTime, deltaTime };
+}
+
+// C is number of components, current and velocity are updated in place
+template<int N, int C>
+inline void SmoothDamp(Batch<float, N>* current, const Batch<float, N>* target, Batch<float, N>* velocity, const SmoothDampFactors& f)
+{
+    typedef Batch<float, N> F;
+    const F omega = F::Set1(f.omega), exp = F::Set1(f.exp), dt = F::Set1(f.deltaTime);
+    const F maxChange = F::Set1(f.maxChange);
+
+    F change[C], lengthSq = F::Zero();
+    for (int c = 0; c < C; c++)
+    {
+        change[c] = current[c] - target[c];
+        lengthSq = Fmadd(change[c], change[c], lengthSq);
+    }
+
+    // clamp maximum speed, infinite maxSpeed never clamps
+    BatchMask<N> clamp = lengthSq > maxChange * maxChange;
+    F scale = Select(F::Set1(1.0f), maxChange / Sqrt(Max(lengthSq, F::Set1(1e-30f))), clamp);
+
+    F overshoot = F::Zero();
+    F output[C];
+    for (int c = 0; c < C; c++)
+    {
+        change[c] = change[c] * scale;
+        F temp = Fmadd(omega, change[c], velocity[c]) * dt;
+        velocity[c] = (velocity[c] - omega * temp) * exp;
+        output[c] = Fmadd(change[c] + temp, exp, current[c] - change[c]);
+        // moving towards the target and passed it
+        overshoot = Fmadd(target[c] - current[c], output[c] - target[c], overshoot);
+    }
+
+    BatchMask<N> passed = overshoot > F::Zero();
+    for (int c = 0; c < C; c++)
+    {
+        current[c]  = Select(output[c], target[c], passed);
+        velocity[c] = Select(velocity[c], F::Zero(), passed);
+    }
+}
+
+// target is flipped to the same hemisphere, velocity is projected to be tangent to the result
+template<int N>
+inline void QSmoothDamp(Batch<float, N> current[4], const Batch<float, N> target[4], Batch<float, N> velocity[4], const SmoothDampFactors& f)
+{
+    typedef Batch<float, N> F;
+    F cosAngle = F::Zero();
+    for (int c = 0; c < 4; c++) cosAngle = Fmadd(current[c], target[c], cosAngle);
+
+    BatchMask<N> sign = AsInt(cosAngle) & BatchMask<N>::Set1(int32(0x80000000u));
+    F flipped[4];
+    for (int c = 0; c < 4; c++) flipped[c] = AsFloat(AsInt(target[c]) ^ sign);
+
+    SmoothDamp<N, 4>(current, flipped, velocity, f);
+
+    F lengthSq = F::Zero();
+    for (int c = 0; c < 4; c++) lengthSq = Fmadd(current[c], current[c], lengthSq);
+    F invLength = F::Set1(1.0f) / Sqrt(lengthSq);
+
+    F tangent = F::Zero();
+    for (int c = 0; c < 4; c++)
+    {
+        current[c] = current[c] * invLength;
+        tangent = Fmadd(velocity[c], current[c], tangent);
+    }
+    for (int c = 0; c < 4; c++) velocity[c] = velocity[c] - current[c] * tangent;
+}
+
+inline Vector3f SmoothDamp(Vector3f current, Vector3f target, Vector3f& velocity, float smoothTime, float maxSpeed, float deltaTime)
+{
+    typedef Batch<float, 1> F;
+    F c[3] = { F::Set1(current.x), F::Set1(current.y), F::Set1(current.z) };
+    F t[3] = { F::Set1(target.x), F::Set1(target.y), F::Set1(target.z) };
+    F v[3] = { F::Set1(velocity.x), F::Set1(velocity.y), F::Set1(velocity.z) };
+    SmoothDamp<1, 3>(c, t, v, MakeSmoothDampFactors(smoothTime, maxSpeed, deltaTime));
+    velocity = { v[0].v[0], v[1].v[0], v[2].v[0] };
+    return { c[0].v[0], c[1].v[0], c[2].v[0] };
+}
+
+// all 4 lanes are treated as one vector, set w to zero for 3d vectors
+inline vec_t VECTORCALL SmoothDamp(vec_t current, vec_t target, vec_t& velocity, float smoothTime, float maxSpeed, float deltaTime)
+{
+    SmoothDampFactors f = MakeSmoothDampFactors(smoothTime, maxSpeed, deltaTime);
+    vec_t omega = VecSet1(f.omega), exp = VecSet1(f.exp), dt = VecSet1(f.deltaTime);
+
+    vec_t change = VecSub(current, target);
+    vec_t lengthSq = VecDot(change, change);
+    vec_t maxChange = VecSet1(f.maxChange);
+    vec_t scale = VecDiv(maxChange, VecSqrt(VecMax(lengthSq, VecSet1(1e-30f))));
+    change = VecMul(change, VecSelect(VecOne(), scale, VecCmpGt(lengthSq, VecMul(maxChange, maxChange))));
+
+    vec_t temp = VecMul(VecFmadd(omega, change, velocity), dt);
+    velocity = VecMul(VecSub(velocity, VecMul(omega, temp)), exp);
+    vec_t output = VecFmadd(VecAdd(change, temp), exp, VecSub(current, change));
+
+    vec_t overshoot = VecDot(VecSub(target, current), VecSub(output, target));
+    veci_t passed = VecCmpGt(overshoot, VecZero());
+    velocity = VecSelect(velocity, VecZero(), passed);
+    return VecSelect(output, target, passed);
+}
+
+inline Quaternion VECTORCALL QSmoothDamp(Quaternion current, Quaternion target, Quaternion& velocity, float smoothTime, float deltaTime)
+{
+    target = VecSelect(target, VecNeg(target), VecCmpLt(VecDot(current, target), VecZero()));
+    vec_t result = SmoothDamp(current, target, velocity, smoothTime, FLT_MAX, deltaTime);
+    result = QNorm(result); // macro, argument is evaluated multiple times
+    velocity = VecSub(velocity, VecMul(result, VecDot(velocity, result)));
+    return result;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                              Spring Damper                               */
+/*//////////////////////////////////////////////////////////////////////////*/
+
+// step of the spring is a linear function of offset from target and velocity,
+// x' = target + xx * (x - target) + xv * v,  v' = vx * (x - target) + vv * v
+struct SpringCoefficients
+{
+    float xx, xv, vx, vv;
+};
+
+// angularFrequency is stiffness in radians per second (2 * PI * hz)
+// dampingRatio: 1 critically damped, below 1 oscillates, above 1 slower without oscillation
+inline SpringCoefficients MakeSpringCoefficients(float angularFrequency, float dampingRatio, float deltaTime)
+{
+    const float w = MAX(angularFrequency, 0.0f), z = MAX(dampingRatio, 0.0f), t = deltaTime;
+    if (w <= 0.0f) // no spring, keeps moving with same velocity
+        return { 1.0f, t, 0.0f, 1.0f };
+
+    if (Abs(z - 1.0f) < 1e-4f) // critically damped
+    {
+        float decay = Exp(-w * t);
+        return { decay * (1.0f + w * t), decay * t, decay * -w * w * t, decay * (1.0f - w * t) };
+    }
+    if (z < 1.0f) // under damped
+    {
+        float wd = w * Sqrt(1.0f - z * z);
+        float decay = Exp(-z * w * t), s, c;
+        SinCos(wd * t, &s, &c);
+        float sd = s / wd;
+        return { decay * (c + z * w * sd), decay * sd, decay * -w * w * sd, decay * (c - z * w * sd) };
+    }
+    // over damped
+    float d = w * Sqrt(z * z - 1.0f);
+    float r1 = -z * w + d, r2 = -z * w - d;
+    float e1 = Exp(r1 * t), e2 = Exp(r2 * t);
+    float inv = 1.0f / (r1 - r2);
+    return { (r1 * e2 - r2 * e1) * inv, (e1 - e2) * inv, r1 * r2 * (e2 - e1) * inv, (r1 * e1 - r2 * e2) * inv };
+}
+
+template<int N>
+inline void SpringDamper(Batch<float, N>* x, Batch<float, N>* v, Batch<float, N> target, const SpringCoefficients& k)
+{
+    typedef Batch<float, N> F;
+    F offset = *x - target;
+    F vel = *v;
+    *x = Fmadd(F::Set1(k.xx), offset, Fmadd(F::Set1(k.xv), vel, target));
+    *v = Fmadd(F::Set1(k.vx), offset, F::Set1(k.vv) * vel);
+}
+
+inline float SpringDamper(float current, float target, float& velocity, float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    float offset = current - target;
+    float output = target + k.xx * offset + k.xv * velocity;
+    velocity = k.vx * offset + k.vv * velocity;
+    return output;
+}
+
+inline Vector3f SpringDamper(Vector3f current, Vector3f target, Vector3f& velocity, float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    Vector3f offset = current - target;
+    Vector3f output = target + offset * k.xx + velocity * k.xv;
+    velocity = offset * k.vx + velocity * k.vv;
+    return output;
+}
+
+inline vec_t VECTORCALL SpringDamper(vec_t current, vec_t target, vec_t& velocity, float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    vec_t offset = VecSub(current, target);
+    vec_t output = VecFmadd(VecSet1(k.xx), offset, VecFmadd(VecSet1(k.xv), velocity, target));
+    velocity = VecFmadd(VecSet1(k.vx), offset, VecMulf(velocity, k.vv));
+    return output;
+}
+
+inline Quaternion VECTORCALL QSpringDamper(Quaternion current, Quaternion target, Quaternion& velocity, float angularFrequency, float dampingRatio, float deltaTime)
+{
+    target = VecSelect(target, VecNeg(target), VecCmpLt(VecDot(current, target), VecZero()));
+    vec_t result = SpringDamper(current, target, velocity, angularFrequency, dampingRatio, deltaTime);
+    result = QNorm(result);
+    velocity = VecSub(velocity, VecMul(result, VecDot(velocity, result)));
+    return result;
+}
+
+/*//////////////////////////////////////////////////////////////////////////*/
+/*                                  Arrays                                  */
+/*//////////////////////////////////////////////////////////////////////////*/
+// current and velocity are updated in place, components are separate streams
+
+template<int N, int C>
+inline int SmoothDampKernel(float* const current[C], float* const velocity[C], const float* const target[C],
+                            const SmoothDampFactors& f, int i, int count)
+{
+    typedef Batch<float, N> F;
+    for (; i + N <= count; i += N)
+    {
+        F x[C], v[C], t[C];
+        for (int c = 0; c < C; c++)
+        {
+            x[c] = F::Load(current[c] + i);
+            v[c] = F::Load(velocity[c] + i);
+            t[c] = F::Load(target[c] + i);
+        }
+        SmoothDamp<N, C>(x, t, v, f);
+
+        for (int c = 0; c < C; c++)
+        {
+            x[c].Store(current[c] + i);
+            v[c].Store(velocity[c] + i);
+        }
+    }
+    return i;
+}
+
+template<int N>
+inline int QSmoothDampKernel(const QuaternionSoA& current, const QuaternionSoA& velocity, const QuaternionSoA& target,
+                             const SmoothDampFactors& f, int i, int count)
+{
+    typedef Batch<float, N> F;
+    float* const cs[4] = { current.x, current.y, current.z, current.w };
+    float* const vs[4] = { velocity.x, velocity.y, velocity.z, velocity.w };
+    const float* const ts[4] = { target.x, target.y, target.z, target.w };
+    for (; i + N <= count; i += N)
+    {
+        F x[4], v[4], t[4];
+        for (int c = 0; c < 4; c++)
+        {
+            x[c] = F::Load(cs[c] + i);
+            v[c] = F::Load(vs[c] + i);
+            t[c] = F::Load(ts[c] + i);
+        }
+        QSmoothDamp<N>(x, t, v, f);
+        for (int c = 0; c < 4; c++)
+        {
+            x[c].Store(cs[c] + i);
+            v[c].Store(vs[c] + i);
+        }
+    }
+    return i;
+}
+
+template<int N, int C>
+inline int SpringDamperKernel(float* const current[C], float* const velocity[C], const float* const target[C],
+                              const SpringCoefficients& k, int i, int count)
+{
+    typedef Batch<float, N> F;
+    for (; i + N <= count; i += N)
+    {
+        for (int c = 0; c < C; c++)
+        {
+            F x = F::Load(current[c] + i), v = F::Load(velocity[c] + i);
+            SpringDamper(&x, &v, F::Load(target[c] + i), k);
+            x.Store(current[c] + i);
+            v.Store(velocity[c] + i);
+        }
+    }
+    return i;
+}
+
+// spring on each quaternion, result is normalized and velocity is kept tangent
+template<int N>
+inline int QSpringDamperKernel(const QuaternionSoA& current, const QuaternionSoA& velocity, const QuaternionSoA& target,
+                               const SpringCoefficients& k, int i, int count)
+{
+    typedef Batch<float, N> F;
+    float* const cs[4] = { current.x, current.y, current.z, current.w };
+    float* const vs[4] = { velocity.x, velocity.y, velocity.z, velocity.w };
+    const float* const ts[4] = { target.x, target.y, target.z, target.w };
+    for (; i + N <= count; i += N)
+    {
+        F x[4], v[4], t[4], cosAngle = F::Zero();
+        for (int c = 0; c < 4; c++)
+        {
+            x[c] = F::Load(cs[c] + i);
+            v[c] = F::Load(vs[c] + i);
+            t[c] = F::Load(ts[c] + i);
+            cosAngle = Fmadd(x[c], t[c], cosAngle);
+        }
+        BatchMask<N> sign = AsInt(cosAngle) & BatchMask<N>::Set1(int32(0x80000000u));
+
+        F lengthSq = F::Zero();
+        for (int c = 0; c < 4; c++)
+        {
+            SpringDamper(&x[c], &v[c], AsFloat(AsInt(t[c]) ^ sign), k);
+            lengthSq = Fmadd(x[c], x[c], lengthSq);
+        }
+
+        F invLength = F::Set1(1.0f) / Sqrt(lengthSq), tangent = F::Zero();
+        for (int c = 0; c < 4; c++)
+        {
+            x[c] = x[c] * invLength;
+            tangent = Fmadd(v[c], x[c], tangent);
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            x[c].Store(cs[c] + i);
+            (v[c] - x[c] * tangent).Store(vs[c] + i);
+        }
+    }
+    return i;
+}
+
+inline void SmoothDampArray(float* current, float* velocity, const float* target, int count,
+                            float smoothTime, float maxSpeed, float deltaTime)
+{
+    SmoothDampFactors f = MakeSmoothDampFactors(smoothTime, maxSpeed, deltaTime);
+    int i = SmoothDampKernel<AX_BATCH_WIDTH, 1>(&current, &velocity, &target, f, 0, count);
+    SmoothDampKernel<1, 1>(&current, &velocity, &target, f, i, count);
+}
+
+inline void SmoothDampArray(const Vector3SoA& current, const Vector3SoA& velocity, const Vector3SoA& target, int count,
+                            float smoothTime, float maxSpeed, float deltaTime)
+{
+    SmoothDampFactors f = MakeSmoothDampFactors(smoothTime, maxSpeed, deltaTime);
+    float* const cs[3] = { current.x, current.y, current.z };
+    float* const vs[3] = { velocity.x, velocity.y, velocity.z };
+    const float* const ts[3] = { target.x, target.y, target.z };
+    int i = SmoothDampKernel<AX_BATCH_WIDTH, 3>(cs, vs, ts, f, 0, count);
+    SmoothDampKernel<1, 3>(cs, vs, ts, f, i, count);
+}
+
+inline void QSmoothDampArray(const QuaternionSoA& current, const QuaternionSoA& velocity, const QuaternionSoA& target, int count,
+                             float smoothTime, float deltaTime)
+{
+    SmoothDampFactors f = MakeSmoothDampFactors(smoothTime, FLT_MAX, deltaTime);
+    int i = QSmoothDampKernel<AX_BATCH_WIDTH>(current, velocity, target, f, 0, count);
+    QSmoothDampKernel<1>(current, velocity, target, f, i, count);
+}
+
+inline void SpringDamperArray(float* current, float* velocity, const float* target, int count,
+                              float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    int i = SpringDamperKernel<AX_BATCH_WIDTH, 1>(&current, &velocity, &target, k, 0, count);
+    SpringDamperKernel<1, 1>(&current, &velocity, &target, k, i, count);
+}
+
+inline void SpringDamperArray(const Vector3SoA& current, const Vector3SoA& velocity, const Vector3SoA& target, int count,
+                              float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    float* const cs[3] = { current.x, current.y, current.z };
+    float* const vs[3] = { velocity.x, velocity.y, velocity.z };
+    const float* const ts[3] = { target.x, target.y, target.z };
+    int i = SpringDamperKernel<AX_BATCH_WIDTH, 3>(cs, vs, ts, k, 0, count);
+    SpringDamperKernel<1, 3>(cs, vs, ts, k, i, count);
+}
+
+inline void QSpringDamperArray(const QuaternionSoA& current, const QuaternionSoA& velocity, const QuaternionSoA& target, int count,
+                               float angularFrequency, float dampingRatio, float deltaTime)
+{
+    SpringCoefficients k = MakeSpringCoefficients(angularFrequency, dampingRatio, deltaTime);
+    int i = QSpringDamperKernel<AX_BATCH_WIDTH>(current, velocity, target, k, 0, count);
+    QSpringDamperKernel<1>(current, velocity, target, k, i, count);
+}
+
+AX_END_NAMESPACE
@@ -241,6 +241,11 @@ struct Rect2D
     Vector2f size;
 };
 
+// structure of arrays view over float streams, batch functions read and write
+// 4 or 8 elements of each stream at a time. streams doesn't have to be aligned
+struct Vector2SoA { float* x; float* y; };
+struct Vector3SoA { float* x; float* y; float* z; };
+
 typedef uint half2;
 constexpr half2 Half2Up    = OneFP16 << 16u;
 constexpr half2 Half2Down  = MinusOneFP16 << 16u;
@@ -343,15 +348,16 @@ pureconst uint32 All3(uint32 msk) { return msk == 0x111u; }
 pureconst uint32 Any2(uint32 msk) { return msk > 0; }
 pureconst uint32 Any3(uint32 msk) { return msk > 0; }
 
-// purefn uint64 VecToHash(Vector2s vec) { return (uint64)WangHash(uint64(vec.x) | (uint64(vec.y) << 16ull)); }
-// purefn uint64 VecToHash(Vector2i vec) { return MurmurHash(uint64(vec.x) | (uint64(vec.y) << 32ull)); }
-// 
-// purefn uint64 VecToHash(Vector3s vec){
-// 	return WangHash(uint64(vec.x) | (uint64(vec.y) << 16ull) | (uint64(vec.z) << 24ull));
-// }
-// 
-// purefn uint64 VecToHash(Vector3i vec) {
-// 	return MurmurHash(uint64(vec.x) | (uint64(vec.y) << 32ull)) + WangHash(vec.z);
-// }
+// unsigned casts prevents sign extension of negative coordinates from overwriting other components
+purefn uint64 VecToHash(Vector2s vec) { return WangHash(uint64(uint16(vec.x)) | (uint64(uint16(vec.y)) << 16ull)); }
+purefn uint64 VecToHash(Vector2i vec) { return MurmurHash(uint64(uint32(vec.x)) | (uint64(uint32(vec.y)) << 32ull)); }
+
+purefn uint64 VecToHash(Vector3s vec) {
+	return WangHash(uint64(uint16(vec.x)) | (uint64(uint16(vec.y)) << 16ull) | (uint64(uint16(vec.z)) << 32ull));
+}
+
+purefn uint64 VecToHash(Vector3i vec) {
+	return MurmurHash(uint64(uint32(vec.x)) | (uint64(uint32(vec.y)) << 32ull)) + WangHash(uint64(uint32(vec.z)));
+}
 
 AX_END_NAMESPACE 